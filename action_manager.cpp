@@ -290,6 +290,12 @@ const Action& ActionManager::getAction(const VAL::operator_& val_operator) const
 	return *(*ci).second;
 }
 
+void ActionManager::setIrrelevant(const Action& action)
+{
+	irrelevant_actions_.resize(getManagableObjects().size(), false);
+	irrelevant_actions_[action.getId()] = true;
+}
+
 void ActionManager::ground(Bindings& bindings, std::vector<const Step*>& grounded_actions, const Action& action) const
 {
 //	std::cout << "ground " << action << std::endl;
@@ -106,6 +106,13 @@ public:
 	// not be called again. It retrieves the constructed action based on the given VAL::operator_.
 	const Action& getAction(const VAL::operator_& val_operator) const;
 
+	/**
+	 * Irrelevant actions are ignored when the successors of a state are generated.
+	 */
+	void setIrrelevant(const Action& action);
+
+	bool isRelevant(const Action& action) const { return action.getId() >= irrelevant_actions_.size() || !irrelevant_actions_[action.getId()]; }
+
 	// Do the unthinkable! Ground an action. A grounded action will only have a single object
 	// assigned to each of its variable domains.
 	void ground(Bindings& bindings, std::vector<const Step*>& grounded_actions, const Action& action) const;
@@ -120,6 +127,8 @@ private:
 	// For preprocess purposes we map the instances of VAL::operator to the Action objects
 	// LolliPOP uses for planning.
 	std::map<const VAL::operator_*, const Action*> action_indexing_;
+	
+	std::vector<bool> irrelevant_actions_;
 };
 
 };
@@ -1,5 +1,13 @@
 #include "coloured_graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <boost/functional/hash.hpp>
+
 #include "predicate_manager.h"
+#include "type_manager.h"
+#include "formula.h"
+#include "parser_utils.h"
 #include "term_manager.h"
 #include "fc_planner.h"
 
@@ -345,4 +353,211 @@ std::ostream& operator<<(std::ostream& os, const ColouredGraph& coloured_graph)
 	return os;
 }
 
+CanonicalColouredGraph::CanonicalColouredGraph(const ActionManager& action_manager, const std::vector<const GroundedAtom*>& goal_facts)
+	: goal_facts_(&goal_facts)
+{
+	// Objects which are part of the action schemas can never be swapped with other objects.
+	for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ++ci)
+	{
+		const Action* action = *ci;
+		std::vector<const Atom*> atoms;
+		Utility::convertFormula(atoms, &action->getPrecondition());
+		atoms.insert(atoms.end(), action->getEffects().begin(), action->getEffects().end());
+		
+		for (std::vector<const Atom*>::const_iterator ci = atoms.begin(); ci != atoms.end(); ++ci)
+		{
+			const Atom* atom = *ci;
+			for (unsigned int i = 0; i < atom->getArity(); ++i)
+			{
+				const Object* object = dynamic_cast<const Object*>(atom->getTerms()[i]);
+				if (object != NULL)
+				{
+					constants_.insert(object);
+				}
+			}
+		}
+	}
+}
+
+void CanonicalColouredGraph::getCanonicalForm(std::vector<unsigned int>& canonical_form, const std::vector<const GroundedAtom*>& facts) const
+{
+	// Create a node for every fact and every object.
+	std::map<const Object*, unsigned int> object_indexes;
+	std::vector<const Object*> objects;
+	std::vector<std::vector<unsigned int> > fact_nodes;
+	fact_nodes.reserve(facts.size() + goal_facts_->size());
+	for (unsigned int i = 0; i < facts.size() + goal_facts_->size(); ++i)
+	{
+		bool is_goal = i >= facts.size();
+		const GroundedAtom* fact = is_goal ? (*goal_facts_)[i - facts.size()] : facts[i];
+		
+		fact_nodes.push_back(std::vector<unsigned int>());
+		std::vector<unsigned int>& fact_node = fact_nodes.back();
+		fact_node.push_back(getPredicateId(fact->getPredicate()));
+		fact_node.push_back(is_goal ? 1 : 0);
+		for (unsigned int j = 0; j < fact->getPredicate().getArity(); ++j)
+		{
+			const Object* object = &fact->getObject(j);
+			std::map<const Object*, unsigned int>::const_iterator object_i = object_indexes.find(object);
+			if (object_i == object_indexes.end())
+			{
+				object_i = object_indexes.insert(std::make_pair(object, objects.size())).first;
+				objects.push_back(object);
+			}
+			fact_node.push_back((*object_i).second);
+		}
+	}
+	
+	// The initial colour of an object is determined by its type, constants get a colour of their own.
+	std::vector<unsigned int> initial_colours(objects.size() * 2);
+	std::vector<std::size_t> object_colours(objects.size(), 0);
+	for (unsigned int i = 0; i < objects.size(); ++i)
+	{
+		initial_colours[i * 2] = objects[i]->getType()->getId();
+		initial_colours[i * 2 + 1] = constants_.count(objects[i]) != 0 ? objects[i]->getId() + 1 : 0;
+		boost::hash_combine(object_colours[i], initial_colours[i * 2]);
+		boost::hash_combine(object_colours[i], initial_colours[i * 2 + 1]);
+	}
+	
+	// Give a new colour to an object of the smallest colour class until all objects have a different colour. Every object
+	// gets a new colour at most once, unless colours collide.
+	unsigned int nr_colours = refineColours(object_colours, fact_nodes);
+	for (unsigned int iteration = 0; nr_colours < objects.size() && iteration < objects.size(); ++iteration)
+	{
+		std::vector<std::pair<std::size_t, unsigned int> > sorted_colours;
+		for (unsigned int i = 0; i < objects.size(); ++i)
+		{
+			sorted_colours.push_back(std::make_pair(object_colours[i], objects[i]->getId()));
+		}
+		std::sort(sorted_colours.begin(), sorted_colours.end());
+		
+		unsigned int object_id = std::numeric_limits<unsigned int>::max();
+		for (unsigned int i = 0; i + 1 < sorted_colours.size(); ++i)
+		{
+			if (sorted_colours[i].first == sorted_colours[i + 1].first)
+			{
+				object_id = sorted_colours[i].second;
+				break;
+			}
+		}
+		
+		for (unsigned int i = 0; i < objects.size(); ++i)
+		{
+			if (objects[i]->getId() == object_id)
+			{
+				boost::hash_combine(object_colours[i], objects.size());
+				break;
+			}
+		}
+		nr_colours = refineColours(object_colours, fact_nodes);
+	}
+	
+	// The canonical labels are given by the order of the colours.
+	std::vector<std::pair<std::pair<std::size_t, unsigned int>, unsigned int> > sorted_objects;
+	for (unsigned int i = 0; i < objects.size(); ++i)
+	{
+		sorted_objects.push_back(std::make_pair(std::make_pair(object_colours[i], objects[i]->getId()), i));
+	}
+	std::sort(sorted_objects.begin(), sorted_objects.end());
+	
+	std::vector<unsigned int> labels(objects.size());
+	canonical_form.push_back(objects.size());
+	for (unsigned int i = 0; i < sorted_objects.size(); ++i)
+	{
+		unsigned int object_index = sorted_objects[i].second;
+		labels[object_index] = i;
+		canonical_form.push_back(initial_colours[object_index * 2]);
+		canonical_form.push_back(initial_colours[object_index * 2 + 1]);
+	}
+	
+	for (std::vector<std::vector<unsigned int> >::iterator i = fact_nodes.begin(); i != fact_nodes.end(); ++i)
+	{
+		std::vector<unsigned int>& fact_node = *i;
+		for (unsigned int j = 2; j < fact_node.size(); ++j)
+		{
+			fact_node[j] = labels[fact_node[j]];
+		}
+	}
+	std::sort(fact_nodes.begin(), fact_nodes.end());
+	
+	// The arity of the facts is determined by the predicate, so we do not need to store it.
+	for (std::vector<std::vector<unsigned int> >::const_iterator ci = fact_nodes.begin(); ci != fact_nodes.end(); ++ci)
+	{
+		canonical_form.insert(canonical_form.end(), (*ci).begin(), (*ci).end());
+	}
+}
+
+std::size_t CanonicalColouredGraph::getCanonicalHash(const std::vector<const GroundedAtom*>& facts) const
+{
+	std::vector<unsigned int> canonical_form;
+	getCanonicalForm(canonical_form, facts);
+	return boost::hash_range(canonical_form.begin(), canonical_form.end());
+}
+
+unsigned int CanonicalColouredGraph::refineColours(std::vector<std::size_t>& object_colours, const std::vector<std::vector<unsigned int> >& fact_nodes) const
+{
+	std::vector<std::size_t> sorted_colours(object_colours);
+	std::sort(sorted_colours.begin(), sorted_colours.end());
+	unsigned int nr_colours = std::unique(sorted_colours.begin(), sorted_colours.end()) - sorted_colours.begin();
+	
+	std::vector<std::vector<std::size_t> > object_edges(object_colours.size());
+	while (true)
+	{
+		for (std::vector<std::vector<std::size_t> >::iterator i = object_edges.begin(); i != object_edges.end(); ++i)
+		{
+			(*i).clear();
+		}
+		
+		// The colour of a fact is determined by its predicate and the colours of its objects, an object is connected to a fact
+		// by an edge coloured by the colour of the fact and the index of the object.
+		for (std::vector<std::vector<unsigned int> >::const_iterator ci = fact_nodes.begin(); ci != fact_nodes.end(); ++ci)
+		{
+			const std::vector<unsigned int>& fact_node = *ci;
+			std::size_t fact_colour = 0;
+			boost::hash_combine(fact_colour, fact_node[0]);
+			boost::hash_combine(fact_colour, fact_node[1]);
+			for (unsigned int j = 2; j < fact_node.size(); ++j)
+			{
+				boost::hash_combine(fact_colour, object_colours[fact_node[j]]);
+			}
+			
+			for (unsigned int j = 2; j < fact_node.size(); ++j)
+			{
+				std::size_t edge_colour = fact_colour;
+				boost::hash_combine(edge_colour, j);
+				object_edges[fact_node[j]].push_back(edge_colour);
+			}
+		}
+		
+		for (unsigned int i = 0; i < object_colours.size(); ++i)
+		{
+			std::vector<std::size_t>& edges = object_edges[i];
+			std::sort(edges.begin(), edges.end());
+			boost::hash_range(object_colours[i], edges.begin(), edges.end());
+		}
+		
+		sorted_colours = object_colours;
+		std::sort(sorted_colours.begin(), sorted_colours.end());
+		unsigned int new_nr_colours = std::unique(sorted_colours.begin(), sorted_colours.end()) - sorted_colours.begin();
+		if (new_nr_colours <= nr_colours)
+		{
+			return new_nr_colours;
+		}
+		nr_colours = new_nr_colours;
+	}
+}
+
+unsigned int CanonicalColouredGraph::getPredicateId(const Predicate& predicate) const
+{
+	std::map<std::string, unsigned int>::const_iterator ci = predicate_ids_.find(predicate.getName());
+	if (ci != predicate_ids_.end())
+	{
+		return (*ci).second;
+	}
+	
+	unsigned int id = predicate_ids_.size();
+	predicate_ids_[predicate.getName()] = id;
+	return id;
+}
+
 };
@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <string>
 #include "action_manager.h"
 
 namespace MyPOP
@@ -117,6 +118,53 @@ private:
 
 std::ostream& operator<<(std::ostream& os, const ColouredGraph& coloured_graph);
 
+/**
+ * Computes a canonical form of a state, states which are symmetrical have the same canonical form. The state is represented as
+ * a coloured graph where every object and every fact is a node and every fact is connected to the objects it contains. The
+ * goal facts are part of this graph and the objects which are constants of the domain are given a unique colour, so the goals
+ * and the actions are preserved under the symmetries we detect.
+ *
+ * The canonical labelling of the objects is found by colour refinement: the colour of every object is refined by the colours
+ * of the facts it is part of until the colours become stable. If some objects still share the same colour, one of them is 
+ * given a new colour and the colours are refined again. The canonical form is the state expressed in the canonical labels.
+ * Objects with the same colour are symmetrical in most cases, but if they are not we might choose a different object for 
+ * states which are symmetrical. In that case the symmetry is not detected, but states with the same canonical form are 
+ * always symmetrical.
+ */
+class CanonicalColouredGraph
+{
+public:
+	CanonicalColouredGraph(const ActionManager& action_manager, const std::vector<const GroundedAtom*>& goal_facts);
+	
+	/**
+	 * Get the canonical form of the state with the given facts.
+	 */
+	void getCanonicalForm(std::vector<unsigned int>& canonical_form, const std::vector<const GroundedAtom*>& facts) const;
+	
+	/**
+	 * Get the hash of the canonical form of the state with the given facts.
+	 */
+	std::size_t getCanonicalHash(const std::vector<const GroundedAtom*>& facts) const;
+	
+private:
+	
+	/**
+	 * Refine the colours of the objects until the number of different colours no longer increases.
+	 * @param fact_nodes For every fact: the id of its predicate, 1 if it is a goal and 0 otherwise, and the indexes of its objects.
+	 * @return The number of different colours.
+	 */
+	unsigned int refineColours(std::vector<std::size_t>& object_colours, const std::vector<std::vector<unsigned int> >& fact_nodes) const;
+	
+	unsigned int getPredicateId(const Predicate& predicate) const;
+	
+	// The objects which are constants of the domain.
+	std::set<const Object*> constants_;
+	const std::vector<const GroundedAtom*>* goal_facts_;
+	
+	// The ids of the predicates, indexed by their names.
+	mutable std::map<std::string, unsigned int> predicate_ids_;
+};
+
 };
 
 #endif
@@ -0,0 +1,381 @@
+#include "external_closed_list.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <queue>
+#include <cstdlib>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+//#define MYPOP_EXTERNAL_CLOSED_LIST_COMMENTS
+
+namespace MyPOP {
+
+namespace {
+
+// The number of keys stored in a single block of a run.
+const unsigned int KEYS_PER_BLOCK = 256;
+
+// The number of runs we keep before they are merged into a single run.
+const unsigned int MAX_RUNS = 8;
+
+// The memory used by a key in memory on top of its values.
+const std::size_t KEY_OVERHEAD = 64;
+
+void writeNumber(std::vector<unsigned char>& buffer, unsigned int number)
+{
+	while (number >= 0x80)
+	{
+		buffer.push_back((number & 0x7F) | 0x80);
+		number >>= 7;
+	}
+	buffer.push_back(number);
+}
+
+unsigned int readNumber(const unsigned char*& data)
+{
+	unsigned int number = 0;
+	unsigned int shift = 0;
+	while (*data & 0x80)
+	{
+		number |= (*data & 0x7F) << shift;
+		shift += 7;
+		++data;
+	}
+	number |= *data << shift;
+	++data;
+	return number;
+}
+
+void writeBuffer(int fd, const std::vector<unsigned char>& buffer)
+{
+	const unsigned char* data = buffer.empty() ? NULL : &buffer[0];
+	std::size_t bytes_left = buffer.size();
+	while (bytes_left > 0)
+	{
+		ssize_t bytes_written = write(fd, data, bytes_left);
+		if (bytes_written == -1)
+		{
+			if (errno == EINTR) continue;
+			std::cerr << "Could not spill the closed list to disk: " << strerror(errno) << std::endl;
+			exit(1);
+		}
+		data += bytes_written;
+		bytes_left -= bytes_written;
+	}
+}
+
+/**
+ * Order pointers to keys by the keys they point to.
+ */
+struct KeyOrdering
+{
+	bool operator()(const std::vector<unsigned int>* lhs, const std::vector<unsigned int>* rhs) const
+	{
+		return *lhs < *rhs;
+	}
+};
+
+/**
+ * Order the heads of the runs which are merged such that the smallest key is at the top of the priority queue.
+ */
+struct RunOrdering
+{
+	bool operator()(const std::pair<const std::vector<unsigned int>*, unsigned int>& lhs, const std::pair<const std::vector<unsigned int>*, unsigned int>& rhs) const
+	{
+		return *rhs.first < *lhs.first;
+	}
+};
+
+/**
+ * Read the next block of a run.
+ * @return False if all the blocks of the run have been read.
+ */
+bool readNextBlock(const SpilledRun& run, std::vector<std::vector<unsigned int> >& keys, unsigned int& next_block)
+{
+	if (next_block == run.getNumberOfBlocks())
+	{
+		keys.clear();
+		return false;
+	}
+	run.readBlock(keys, next_block);
+	++next_block;
+	return !keys.empty();
+}
+
+};
+
+/*************************
+ * The SpilledRun class
+ *************************/
+
+SpilledRun::SpilledRun(const std::string& directory, const std::vector<const std::vector<unsigned int>*>& sorted_keys)
+	: fd_(-1), nr_keys_(0), file_size_(0)
+{
+	createFile(directory);
+	for (std::vector<const std::vector<unsigned int>*>::const_iterator ci = sorted_keys.begin(); ci != sorted_keys.end(); ++ci)
+	{
+		append(**ci);
+	}
+	finish();
+}
+
+SpilledRun::SpilledRun(const std::string& directory)
+	: fd_(-1), nr_keys_(0), file_size_(0)
+{
+	createFile(directory);
+}
+
+void SpilledRun::createFile(const std::string& directory)
+{
+	std::string file_name_template = directory + "/mypop_closed_list_XXXXXX";
+	std::vector<char> file_name(file_name_template.begin(), file_name_template.end());
+	file_name.push_back('\0');
+	fd_ = mkstemp(&file_name[0]);
+	if (fd_ == -1)
+	{
+		std::cerr << "Could not create a file in " << directory << " to spill the closed list to: " << strerror(errno) << std::endl;
+		exit(1);
+	}
+
+	// The file is only accessed through the file descriptor, it is removed by the OS once it is closed.
+	unlink(&file_name[0]);
+}
+
+void SpilledRun::append(const std::vector<unsigned int>& key)
+{
+	if (nr_keys_ % KEYS_PER_BLOCK == 0)
+	{
+		// Write the previous block to bound the memory used.
+		finish();
+		block_first_keys_.push_back(key);
+		block_offsets_.push_back(file_size_);
+	}
+
+	writeNumber(buffer_, key.size());
+	for (std::vector<unsigned int>::const_iterator ci = key.begin(); ci != key.end(); ++ci)
+	{
+		writeNumber(buffer_, *ci);
+	}
+	++nr_keys_;
+}
+
+void SpilledRun::finish()
+{
+	writeBuffer(fd_, buffer_);
+	file_size_ += buffer_.size();
+	buffer_.clear();
+}
+
+SpilledRun::~SpilledRun()
+{
+	if (fd_ != -1)
+	{
+		close(fd_);
+	}
+}
+
+void SpilledRun::readBlock(std::vector<std::vector<unsigned int> >& keys, unsigned int block) const
+{
+	std::size_t begin = block_offsets_[block];
+	std::size_t end = block + 1 < block_offsets_.size() ? block_offsets_[block + 1] : file_size_;
+	std::vector<unsigned char> buffer(end - begin);
+
+	std::size_t bytes_read = 0;
+	while (bytes_read < buffer.size())
+	{
+		ssize_t result = pread(fd_, &buffer[bytes_read], buffer.size() - bytes_read, begin + bytes_read);
+		if (result == -1 && errno == EINTR) continue;
+		if (result <= 0)
+		{
+			std::cerr << "Could not read the closed list from disk: " << strerror(errno) << std::endl;
+			exit(1);
+		}
+		bytes_read += result;
+	}
+
+	keys.clear();
+	const unsigned char* data = buffer.empty() ? NULL : &buffer[0];
+	const unsigned char* data_end = data + buffer.size();
+	while (data != data_end)
+	{
+		keys.push_back(std::vector<unsigned int>(readNumber(data)));
+		std::vector<unsigned int>& key = keys.back();
+		for (unsigned int i = 0; i < key.size(); ++i)
+		{
+			key[i] = readNumber(data);
+		}
+	}
+}
+
+void SpilledRun::lookup(const std::vector<const std::vector<unsigned int>*>& keys, std::vector<bool>& is_spilled) const
+{
+	std::vector<std::vector<unsigned int> > block_keys;
+	unsigned int loaded_block = block_first_keys_.size();
+	for (unsigned int i = 0; i < keys.size(); ++i)
+	{
+		const std::vector<unsigned int>& key = *keys[i];
+
+		// The key can only be part of the last block whose first key is not larger.
+		std::vector<std::vector<unsigned int> >::const_iterator block_ci = std::upper_bound(block_first_keys_.begin(), block_first_keys_.end(), key);
+		if (block_ci == block_first_keys_.begin())
+		{
+			continue;
+		}
+		unsigned int block = std::distance(block_first_keys_.begin(), block_ci) - 1;
+
+		// The keys are sorted, so every block is read at most once.
+		if (block != loaded_block)
+		{
+			readBlock(block_keys, block);
+			loaded_block = block;
+		}
+
+		if (std::binary_search(block_keys.begin(), block_keys.end(), key))
+		{
+			is_spilled[i] = true;
+		}
+	}
+}
+
+/*************************
+ * The ExternalClosedList class
+ *************************/
+
+ExternalClosedList::ExternalClosedList(const std::string& directory, std::size_t memory_budget)
+	: directory_(directory), memory_budget_(memory_budget), memory_used_(0)
+{
+
+}
+
+ExternalClosedList::~ExternalClosedList()
+{
+	clear();
+}
+
+bool ExternalClosedList::insert(const std::vector<unsigned int>& key)
+{
+	if (!keys_in_memory_.insert(key).second)
+	{
+		return false;
+	}
+
+	memory_used_ += key.size() * sizeof(unsigned int) + KEY_OVERHEAD;
+	if (memory_used_ > memory_budget_)
+	{
+		spill();
+	}
+	return true;
+}
+
+void ExternalClosedList::findSpilled(const std::vector<const std::vector<unsigned int>*>& keys, std::vector<bool>& is_spilled) const
+{
+	is_spilled.assign(keys.size(), false);
+	if (runs_.empty())
+	{
+		return;
+	}
+
+	// Sort the batch so every run is read sequentially.
+	std::vector<const std::vector<unsigned int>*> sorted_keys(keys);
+	std::sort(sorted_keys.begin(), sorted_keys.end(), KeyOrdering());
+
+	std::vector<bool> is_sorted_key_spilled(sorted_keys.size(), false);
+	for (std::vector<SpilledRun*>::const_iterator ci = runs_.begin(); ci != runs_.end(); ++ci)
+	{
+		(*ci)->lookup(sorted_keys, is_sorted_key_spilled);
+	}
+
+	for (unsigned int i = 0; i < keys.size(); ++i)
+	{
+		const std::vector<unsigned int>* key = keys[i];
+		std::vector<const std::vector<unsigned int>*>::iterator ci = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), key, KeyOrdering());
+		is_spilled[i] = is_sorted_key_spilled[std::distance(sorted_keys.begin(), ci)];
+	}
+}
+
+void ExternalClosedList::spill()
+{
+	std::vector<const std::vector<unsigned int>*> sorted_keys;
+	for (boost::unordered_set<std::vector<unsigned int> >::const_iterator ci = keys_in_memory_.begin(); ci != keys_in_memory_.end(); ++ci)
+	{
+		sorted_keys.push_back(&*ci);
+	}
+	std::sort(sorted_keys.begin(), sorted_keys.end(), KeyOrdering());
+
+	runs_.push_back(new SpilledRun(directory_, sorted_keys));
+	std::cerr << "\tSpilled " << sorted_keys.size() << " closed states to disk (" << runs_.back()->getFileSize() << " bytes)." << std::endl;
+
+	keys_in_memory_.clear();
+	memory_used_ = 0;
+
+	if (runs_.size() <= MAX_RUNS)
+	{
+		return;
+	}
+
+	// Merge all the runs into a single run. Only the current block of every run is kept in memory and the merged keys are
+	// written to the new run as soon as they are known.
+	std::vector<std::vector<std::vector<unsigned int> > > run_blocks(runs_.size());
+	std::vector<unsigned int> next_block(runs_.size(), 0);
+	std::vector<unsigned int> next_key(runs_.size(), 0);
+	std::priority_queue<std::pair<const std::vector<unsigned int>*, unsigned int>, std::vector<std::pair<const std::vector<unsigned int>*, unsigned int> >, RunOrdering> queue;
+	for (unsigned int run = 0; run < runs_.size(); ++run)
+	{
+		if (readNextBlock(*runs_[run], run_blocks[run], next_block[run]))
+		{
+			queue.push(std::make_pair(&run_blocks[run][0], run));
+		}
+	}
+
+	SpilledRun* merged_run = new SpilledRun(directory_);
+	std::vector<unsigned int> last_key;
+	while (!queue.empty())
+	{
+		unsigned int run = queue.top().second;
+		queue.pop();
+
+		// The same key can be part of multiple runs, the copies are popped one after the other.
+		const std::vector<unsigned int>& key = run_blocks[run][next_key[run]];
+		if (merged_run->getNumberOfKeys() == 0 || key != last_key)
+		{
+			merged_run->append(key);
+			last_key = key;
+		}
+
+		++next_key[run];
+		if (next_key[run] == run_blocks[run].size())
+		{
+			next_key[run] = 0;
+			if (!readNextBlock(*runs_[run], run_blocks[run], next_block[run]))
+			{
+				continue;
+			}
+		}
+		queue.push(std::make_pair(&run_blocks[run][next_key[run]], run));
+	}
+	merged_run->finish();
+
+	for (std::vector<SpilledRun*>::const_iterator ci = runs_.begin(); ci != runs_.end(); ++ci)
+	{
+		delete *ci;
+	}
+	runs_.clear();
+	runs_.push_back(merged_run);
+}
+
+void ExternalClosedList::clear()
+{
+	keys_in_memory_.clear();
+	memory_used_ = 0;
+	for (std::vector<SpilledRun*>::const_iterator ci = runs_.begin(); ci != runs_.end(); ++ci)
+	{
+		delete *ci;
+	}
+	runs_.clear();
+}
+
+};
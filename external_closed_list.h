@@ -0,0 +1,130 @@
+#ifndef MYPOP_EXTERNAL_CLOSED_LIST_H
+#define MYPOP_EXTERNAL_CLOSED_LIST_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <boost/unordered_set.hpp>
+
+namespace MyPOP
+{
+
+/**
+ * A run of keys which has been spilled to disk. The keys are sorted and stored in blocks, every key is stored as its length
+ * followed by its values and every number is stored as a variable length integer. The first key of every block is kept in
+ * memory so only the blocks which might contain a key have to be read.
+ */
+class SpilledRun
+{
+public:
+	/**
+	 * Write the given keys, which must be sorted and unique, to a new file in the given directory.
+	 */
+	SpilledRun(const std::string& directory, const std::vector<const std::vector<unsigned int>*>& sorted_keys);
+
+	/**
+	 * Create an empty run in the given directory, keys are added with append.
+	 */
+	SpilledRun(const std::string& directory);
+
+	~SpilledRun();
+
+	/**
+	 * Add a key to the end of this run, only the current block is kept in memory.
+	 * @param key The key to add, it must be larger than all the keys added before.
+	 */
+	void append(const std::vector<unsigned int>& key);
+
+	/**
+	 * Write the last block to disk, no keys can be added after this.
+	 */
+	void finish();
+
+	/**
+	 * Mark the keys which are part of this run, the keys must be sorted.
+	 * @param keys The keys to look up, sorted.
+	 * @param is_spilled Set to true for every key which is part of this run.
+	 */
+	void lookup(const std::vector<const std::vector<unsigned int>*>& keys, std::vector<bool>& is_spilled) const;
+
+	/**
+	 * Read the keys of a single block, in sorted order.
+	 */
+	void readBlock(std::vector<std::vector<unsigned int> >& keys, unsigned int block) const;
+
+	unsigned int getNumberOfBlocks() const { return block_first_keys_.size(); }
+
+	std::size_t getNumberOfKeys() const { return nr_keys_; }
+
+	std::size_t getFileSize() const { return file_size_; }
+
+private:
+	void createFile(const std::string& directory);
+
+	int fd_;
+	std::size_t nr_keys_;
+	std::size_t file_size_;
+	std::vector<unsigned char> buffer_;
+	std::vector<std::vector<unsigned int> > block_first_keys_;
+	std::vector<std::size_t> block_offsets_;
+};
+
+/**
+ * A closed list which keeps its keys in memory until the memory budget is exceeded, after which all the keys in memory are
+ * spilled to disk as a sorted, compressed run. Runs are merged once there are too many of them, the merge reads a single
+ * block of every run at a time so its memory use does not depend on the size of the runs.
+ *
+ * Keys in memory are checked immediately, keys on disk are checked in batches (delayed duplicate detection): the batch is
+ * sorted and every run is read at most once per batch.
+ */
+class ExternalClosedList
+{
+public:
+	/**
+	 * @param directory The directory in which the runs are stored, the files are removed as soon as they are created so
+	 * they never outlive the planner.
+	 * @param memory_budget The number of bytes the keys in memory may use before they are spilled to disk.
+	 */
+	ExternalClosedList(const std::string& directory, std::size_t memory_budget);
+
+	~ExternalClosedList();
+
+	/**
+	 * Add a key to the keys in memory.
+	 * @return False if the key was already part of the keys in memory.
+	 */
+	bool insert(const std::vector<unsigned int>& key);
+
+	/**
+	 * Check which of the given keys have been spilled to disk.
+	 * @param is_spilled Set to true for every key which is stored on disk, false otherwise.
+	 */
+	void findSpilled(const std::vector<const std::vector<unsigned int>*>& keys, std::vector<bool>& is_spilled) const;
+
+	/**
+	 * @return True if keys have been spilled to disk.
+	 */
+	bool hasSpilled() const { return !runs_.empty(); }
+
+	/**
+	 * Remove all the keys, both in memory and on disk.
+	 */
+	void clear();
+
+private:
+	/**
+	 * Write all keys in memory to a new run and merge the runs if there are too many of them.
+	 */
+	void spill();
+
+	std::string directory_;
+	std::size_t memory_budget_;
+	std::size_t memory_used_;
+
+	boost::unordered_set<std::vector<unsigned int> > keys_in_memory_;
+	std::vector<SpilledRun*> runs_;
+};
+
+};
+
+#endif
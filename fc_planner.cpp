@@ -1,8 +1,14 @@
 #include "fc_planner.h"
 
 #include <queue>
+#include <deque>
 #include <cmath>
+#include <cstdlib>
 #include <time.h>
+#include <sys/time.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "formula.h"
 #include "predicate_manager.h"
@@ -17,13 +23,70 @@
 #include "type_manager.h"
 #include "heuristics/fact_set.h"
 #include "coloured_graph.h"
+#include "external_closed_list.h"
+#include "transposition_table.h"
 
 //#define FC_PLANNER_SAFE_MEMORY
 
 namespace MyPOP {
 
-StateHeuristicListener::StateHeuristicListener(std::vector<State*>& found_states, const State& current_state, HEURISTICS::HeuristicInterface& heuristic, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added)
-	: found_states_(&found_states), current_state_(&current_state), heuristic_(&heuristic), initial_facts_(&initial_facts), goal_facts_(&goal_facts), term_manager_(&term_manager), find_helpful_actions_(find_helpful_actions), allow_new_goals_to_be_added_(allow_new_goals_to_be_added), found_better_state_(false)
+namespace {
+
+/**
+ * Set the heuristic value of the state, if a transposition table is given the value is taken from the table if the state
+ * has been evaluated before and stored in the table otherwise.
+ */
+void setHeuristicForState(State& state, HEURISTICS::HeuristicInterface& heuristic, TranspositionTable* transposition_table, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool allow_new_goals_to_be_added)
+{
+	if (transposition_table == NULL)
+	{
+		heuristic.setHeuristicForState(state, initial_facts, goal_facts, term_manager, false, allow_new_goals_to_be_added);
+		return;
+	}
+	
+	std::vector<const GroundedAtom*> state_facts;
+	state.getFacts(initial_facts, state_facts);
+	std::vector<unsigned int> key;
+	TranspositionTable::getKey(key, state_facts, allow_new_goals_to_be_added);
+	
+	unsigned int heuristic_value;
+	if (transposition_table->getHeuristic(heuristic_value, key))
+	{
+		state.setDistanceToGoal(heuristic_value);
+		return;
+	}
+	
+	heuristic.setHeuristicForState(state, initial_facts, goal_facts, term_manager, false, allow_new_goals_to_be_added);
+	transposition_table->setHeuristic(key, state.getHeuristic());
+}
+
+/**
+ * Delete all the states which are left when the search ends with a memory budget, in which case the processed states are
+ * only reachable through the states which have not been processed yet, the goal state, and the best state seen.
+ */
+void deleteExternalStates(std::priority_queue<State*, std::vector<State*>, CompareStates>& queue, std::vector<State*>& states_to_explore, const State* goal_state, const State* last_best_state)
+{
+	while (!queue.empty())
+	{
+		const State* state = queue.top();
+		queue.pop();
+		State::deleteUnusedStates(state, last_best_state);
+	}
+	
+	for (std::vector<State*>::const_iterator ci = states_to_explore.begin(); ci != states_to_explore.end(); ++ci)
+	{
+		State::deleteUnusedStates(*ci, last_best_state);
+	}
+	states_to_explore.clear();
+	
+	State::deleteUnusedStates(goal_state, last_best_state);
+	State::deleteUnusedStates(last_best_state, NULL);
+}
+
+};
+
+StateHeuristicListener::StateHeuristicListener(std::vector<State*>& found_states, const State& current_state, HEURISTICS::HeuristicInterface& heuristic, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added, TranspositionTable* transposition_table)
+	: found_states_(&found_states), current_state_(&current_state), heuristic_(&heuristic), initial_facts_(&initial_facts), goal_facts_(&goal_facts), term_manager_(&term_manager), find_helpful_actions_(find_helpful_actions), allow_new_goals_to_be_added_(allow_new_goals_to_be_added), found_better_state_(false), transposition_table_(transposition_table)
 {
 	
 }
@@ -36,7 +99,7 @@ StateHeuristicListener::~StateHeuristicListener()
 void StateHeuristicListener::addNewState(State& state)
 {
 	//heuristic_->setHeuristicForState(state, *goal_facts_, *term_manager_, find_helpful_actions_, allow_new_goals_to_be_added_);
-	heuristic_->setHeuristicForState(state, *initial_facts_, *goal_facts_, *term_manager_, false, allow_new_goals_to_be_added_);
+	setHeuristicForState(state, *heuristic_, transposition_table_, *initial_facts_, *goal_facts_, *term_manager_, allow_new_goals_to_be_added_);
 /*	if (find_helpful_actions_ && state.getHeuristic() < current_state_->getHeuristic())
 	{
 		found_better_state_ = true;
@@ -77,6 +140,11 @@ bool StateStoreListener::continueSearching()
 	
 std::vector<const GroundedAction*> GroundedAction::instantiated_grounded_actions_;
 std::vector<const GroundedAtom*> GroundedAtom::instantiated_grounded_atoms_;
+boost::unordered_map<GroundedAtom::GroundedAtomKey, unsigned int, GroundedAtom::GroundedAtomKeyHash, GroundedAtom::GroundedAtomKeyEquals> GroundedAtom::grounded_atom_ids_;
+std::vector<const Object*> GroundedAtom::grounded_atom_objects_;
+boost::unordered_map<const Predicate*, unsigned int> GroundedAtom::predicate_name_ids_;
+std::map<std::string, unsigned int> GroundedAtom::predicate_names_;
+std::vector<const GroundedAtom*> GroundedAtom::grounded_atoms_by_id_;
 
 const GroundedAction& GroundedAction::getGroundedAction(const Action& action, const Object** variables)
 {
@@ -151,7 +219,33 @@ unsigned int GroundedAction::numberOfGroundedActions()
 GroundedAction::GroundedAction(const Action& action, const Object** variables)
 	: action_(&action), variables_(variables)
 {
+	for (unsigned int effect_index = 0; effect_index < action_->getEffects().size(); ++effect_index)
+	{
+		const GroundedAtom& grounded_effect = getEffect(effect_index);
+		if (action_->getEffects()[effect_index]->isNegative())
+		{
+			delete_effects_.push_back(grounded_effect.getId());
+		}
+		else
+		{
+			add_effects_.push_back(std::make_pair(grounded_effect.getId(), effect_index));
+		}
+	}
+	
+	std::sort(delete_effects_.begin(), delete_effects_.end());
+	delete_effects_.erase(std::unique(delete_effects_.begin(), delete_effects_.end()), delete_effects_.end());
 	
+	// Keep a single effect for every added atom.
+	std::sort(add_effects_.begin(), add_effects_.end());
+	std::vector<std::pair<unsigned int, unsigned int> > unique_add_effects;
+	for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator ci = add_effects_.begin(); ci != add_effects_.end(); ++ci)
+	{
+		if (unique_add_effects.empty() || unique_add_effects.back().first != (*ci).first)
+		{
+			unique_add_effects.push_back(*ci);
+		}
+	}
+	add_effects_.swap(unique_add_effects);
 }
 
 GroundedAction::~GroundedAction()
@@ -159,46 +253,160 @@ GroundedAction::~GroundedAction()
 	delete[] variables_;
 }
 
+const GroundedAtom& GroundedAction::getEffect(unsigned int effect_index) const
+{
+	const Atom* effect = action_->getEffects()[effect_index];
+	const Object* effect_variables[effect->getArity()];
+	for (unsigned int term_index = 0; term_index < effect->getArity(); term_index++)
+	{
+		unsigned int variable_index = action_->getActionVariable(effect_index, term_index);
+		effect_variables[term_index] = variables_[variable_index];
+	}
+	
+	return GroundedAtom::getGroundedAtom(effect->getPredicate(), effect_variables);
+}
+
 void GroundedAction::applyTo(std::vector<const GroundedAtom*>& facts) const
 {
-/*
-	std::cout << "Apply: " << *this << std::endl;
+	// Remove the deleted facts, both lists are ordered by id so a single pass suffices. Normalise we assume that effect can only 
+	// delete facts which are mentioned in the preconditions. But some domains like Satellite do not conform to this assumption.
+	std::vector<const GroundedAtom*>::iterator facts_end = facts.begin();
+	std::vector<unsigned int>::const_iterator delete_ci = delete_effects_.begin();
 	for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
 	{
-		std::cout << "* " << **ci << std::endl;
+		unsigned int fact_id = (*ci)->getId();
+		while (delete_ci != delete_effects_.end() && *delete_ci < fact_id)
+		{
+			++delete_ci;
+		}
+		
+		if (delete_ci == delete_effects_.end() || *delete_ci != fact_id)
+		{
+			*facts_end = *ci;
+			++facts_end;
+		}
 	}
-*/
-	std::vector<const GroundedAtom*> to_add;
-	for (unsigned int effect_index = 0; effect_index < action_->getEffects().size(); ++effect_index)
+	unsigned int nr_remaining_facts = std::distance(facts.begin(), facts_end);
+	
+	// Find the added facts which are not yet part of the state. The grounded atoms of the effects might have been removed since 
+	// this action was created, in which case they are instantiated again.
+	const GroundedAtom* new_facts[add_effects_.size()];
+	unsigned int nr_new_facts = 0;
+	std::vector<const GroundedAtom*>::const_iterator facts_ci = facts.begin();
+	for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator ci = add_effects_.begin(); ci != add_effects_.end(); ++ci)
 	{
-		const Atom* effect = action_->getEffects()[effect_index];
-		const Object** effect_variables = new const Object*[effect->getArity()];
-		for (unsigned int term_index = 0; term_index < effect->getArity(); term_index++)
+		while (facts_ci != facts_end && (*facts_ci)->getId() < (*ci).first)
 		{
-			unsigned int variable_index = action_->getActionVariable(effect_index, term_index);
-			effect_variables[term_index] = variables_[variable_index];
+			++facts_ci;
 		}
 		
-		const GroundedAtom& grounded_effect = GroundedAtom::getGroundedAtom(effect->getPredicate(), effect_variables);
-		if (effect->isNegative())
+		if (facts_ci != facts_end && (*facts_ci)->getId() == (*ci).first)
 		{
-//			std::cout << "Remove: " << grounded_effect << std::endl;
-			// Normalise we assume that effect can only delete facts which are mentioned in the preconditions. But some domains
-			// like Satellite do not conform to this assumption.
-			std::vector<const GroundedAtom*>::iterator ci = std::find(facts.begin(), facts.end(), &grounded_effect);
-			if (ci != facts.end())
-			{
-				facts.erase(ci);
-			}
+			continue;
+		}
+		
+		const GroundedAtom* grounded_effect = GroundedAtom::getInstantiatedGroundedAtom((*ci).first);
+		if (grounded_effect == NULL)
+		{
+			grounded_effect = &getEffect((*ci).second);
+		}
+		new_facts[nr_new_facts++] = grounded_effect;
+	}
+	
+	// Merge the new facts into the remaining facts, starting from the back so no facts are overwritten before they are moved.
+	facts.resize(nr_remaining_facts + nr_new_facts);
+	int fact_index = nr_remaining_facts - 1;
+	int new_fact_index = nr_new_facts - 1;
+	for (int index = nr_remaining_facts + nr_new_facts - 1; new_fact_index >= 0; --index)
+	{
+		if (fact_index >= 0 && facts[fact_index]->getId() > new_facts[new_fact_index]->getId())
+		{
+			facts[index] = facts[fact_index--];
+		}
+		else
+		{
+			facts[index] = new_facts[new_fact_index--];
+		}
+	}
+}
+
+void GroundedAction::getPreconditions(std::vector<unsigned int>& precondition_ids, std::vector<unsigned int>& negative_precondition_ids) const
+{
+	std::vector<const Atom*> preconditions;
+	std::vector<const Equality*> equalities;
+	Utility::convertFormula(preconditions, equalities, &action_->getPrecondition());
+	
+	for (std::vector<const Atom*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+	{
+		const Atom* precondition = *ci;
+		const Object* precondition_variables[precondition->getArity()];
+		for (unsigned int term_index = 0; term_index < precondition->getArity(); ++term_index)
+		{
+			precondition_variables[term_index] = &getObject(*precondition->getTerms()[term_index]);
+		}
+		unsigned int precondition_id = GroundedAtom::getGroundedAtom(precondition->getPredicate(), precondition_variables).getId();
+		if (precondition->isNegative())
+		{
+			negative_precondition_ids.push_back(precondition_id);
 		}
 		else
 		{
-//			std::cout << "Add: " << grounded_effect << std::endl;
-			to_add.push_back(&grounded_effect);
+			precondition_ids.push_back(precondition_id);
+		}
+	}
+	
+	std::sort(precondition_ids.begin(), precondition_ids.end());
+	precondition_ids.erase(std::unique(precondition_ids.begin(), precondition_ids.end()), precondition_ids.end());
+	std::sort(negative_precondition_ids.begin(), negative_precondition_ids.end());
+	negative_precondition_ids.erase(std::unique(negative_precondition_ids.begin(), negative_precondition_ids.end()), negative_precondition_ids.end());
+}
+
+unsigned int GroundedAction::getIllTypedVariable() const
+{
+	for (unsigned int i = 0; i < action_->getVariables().size(); ++i)
+	{
+		if (!variables_[i]->getType()->isCompatible(*action_->getVariables()[i]->getType()))
+		{
+			return i;
 		}
 	}
+	return std::numeric_limits<unsigned int>::max();
+}
+
+const Equality* GroundedAction::getViolatedEquality() const
+{
+	std::vector<const Atom*> preconditions;
+	std::vector<const Equality*> equalities;
+	Utility::convertFormula(preconditions, equalities, &action_->getPrecondition());
 	
-	facts.insert(facts.end(), to_add.begin(), to_add.end());
+	for (std::vector<const Equality*>::const_iterator ci = equalities.begin(); ci != equalities.end(); ++ci)
+	{
+		const Equality* equality = *ci;
+		bool are_equal = &getObject(equality->getLHSTerm()) == &getObject(equality->getRHSTerm());
+		if (are_equal == equality->isNegative())
+		{
+			return equality;
+		}
+	}
+	return NULL;
+}
+
+const Object& GroundedAction::getObject(const Term& term) const
+{
+	unsigned int action_variable_index = action_->getActionVariable(term);
+	if (action_variable_index == std::numeric_limits<unsigned int>::max())
+	{
+		return static_cast<const Object&>(term);
+	}
+	return *variables_[action_variable_index];
+}
+
+void GroundedAction::getAddEffects(std::vector<unsigned int>& add_effect_ids) const
+{
+	for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator ci = add_effects_.begin(); ci != add_effects_.end(); ++ci)
+	{
+		add_effect_ids.push_back((*ci).first);
+	}
 }
 
 std::ostream& operator<<(std::ostream& os, const GroundedAction& grounded_action)
@@ -235,39 +443,93 @@ void GroundedAtom::removeInstantiatedGroundedAtom(const std::vector<const Ground
 	}
 }
 
-const GroundedAtom& GroundedAtom::getGroundedAtom(const Predicate& predicate, const Object** variables)
+std::size_t GroundedAtom::GroundedAtomKeyHash::operator()(const GroundedAtomKey& key) const
 {
-	for (std::vector<const GroundedAtom*>::const_iterator ci = instantiated_grounded_atoms_.begin(); ci != instantiated_grounded_atoms_.end(); ++ci)
+	std::size_t seed = 0;
+	boost::hash_combine(seed, key.predicate_name_id_);
+	for (unsigned int i = 0; i < key.arity_; ++i)
 	{
-		const GroundedAtom* grounded_atom = *ci;
-		
-		if (grounded_atom->getPredicate().getArity() != predicate.getArity() ||
-		    grounded_atom->getPredicate().getName() != predicate.getName())
-		{
-			continue;
-		}
-		
-		bool variable_domain_match = true;
-		for (unsigned int i = 0; i < grounded_atom->getPredicate().getArity(); ++i)
+		boost::hash_combine(seed, key.getObject(i));
+	}
+	return seed;
+}
+
+bool GroundedAtom::GroundedAtomKeyEquals::operator()(const GroundedAtomKey& lhs, const GroundedAtomKey& rhs) const
+{
+	if (lhs.predicate_name_id_ != rhs.predicate_name_id_ || lhs.arity_ != rhs.arity_)
+	{
+		return false;
+	}
+	
+	for (unsigned int i = 0; i < lhs.arity_; ++i)
+	{
+		if (lhs.getObject(i) != rhs.getObject(i))
 		{
-			if (&grounded_atom->getObject(i) != variables[i])
-			{
-				variable_domain_match = false;
-				break;
-			}
+			return false;
 		}
-		if (variable_domain_match)
+	}
+	return true;
+}
+
+unsigned int GroundedAtom::getPredicateNameId(const Predicate& predicate)
+{
+	boost::unordered_map<const Predicate*, unsigned int>::const_iterator ci = predicate_name_ids_.find(&predicate);
+	if (ci != predicate_name_ids_.end())
+	{
+		return (*ci).second;
+	}
+	
+	unsigned int predicate_name_id = predicate_names_.insert(std::make_pair(predicate.getName(), predicate_names_.size())).first->second;
+	predicate_name_ids_[&predicate] = predicate_name_id;
+	return predicate_name_id;
+}
+
+const GroundedAtom& GroundedAtom::getGroundedAtom(const Predicate& predicate, const Object* const* variables)
+{
+	GroundedAtomKey key(getPredicateNameId(predicate), predicate.getArity(), variables, 0);
+	boost::unordered_map<GroundedAtomKey, unsigned int, GroundedAtomKeyHash, GroundedAtomKeyEquals>::const_iterator id_ci = grounded_atom_ids_.find(key);
+	
+	unsigned int id = grounded_atoms_by_id_.size();
+	if (id_ci != grounded_atom_ids_.end())
+	{
+		id = (*id_ci).second;
+		const GroundedAtom* grounded_atom = grounded_atoms_by_id_[id];
+		if (grounded_atom != NULL)
 		{
-			delete[] variables;
 			return *grounded_atom;
 		}
 	}
+	else
+	{
+		// Only a new id needs a copy of the objects.
+		GroundedAtomKey stored_key(key.predicate_name_id_, key.arity_, NULL, grounded_atom_objects_.size());
+		grounded_atom_objects_.insert(grounded_atom_objects_.end(), variables, variables + predicate.getArity());
+		grounded_atom_ids_[stored_key] = id;
+		grounded_atoms_by_id_.push_back(NULL);
+	}
 	
-	GroundedAtom* new_grounded_atom = new GroundedAtom(predicate, variables);
+	GroundedAtom* new_grounded_atom = new GroundedAtom(predicate, variables, id);
+	grounded_atoms_by_id_[id] = new_grounded_atom;
 	instantiated_grounded_atoms_.push_back(new_grounded_atom);
 	return *new_grounded_atom;
 }
 
+void GroundedAtom::getGroundedAtoms(std::vector<const GroundedAtom*>& grounded_facts, const std::vector<const Atom*>& facts)
+{
+	for (std::vector<const Atom*>::const_iterator ci = facts.begin(); ci != facts.end(); ci++)
+	{
+		const Atom* fact = *ci;
+		const Object* variables[fact->getArity()];
+
+		for (unsigned int i = 0; i < fact->getArity(); ++i)
+		{
+			variables[i] = static_cast<const Object*>(fact->getTerms()[i]);
+		}
+		
+		grounded_facts.push_back(&getGroundedAtom(fact->getPredicate(), variables));
+	}
+}
+
 void GroundedAtom::generateGroundedAtoms(std::vector<const GroundedAtom*>& grounded_objects, const PredicateManager& predicate_manager, const TermManager& term_manager)
 {
 	for (std::vector<Predicate*>::const_iterator ci = predicate_manager.getManagableObjects().begin(); ci != predicate_manager.getManagableObjects().end(); ++ci)
@@ -289,7 +551,7 @@ void GroundedAtom::generateGroundedAtoms(std::vector<const GroundedAtom*>& groun
 		while (!done)
 		{
 			done = true;
-			const Object** objects = new const Object*[predicate->getArity()];
+			const Object* objects[predicate->getArity()];
 			for (unsigned int i = 0; i < predicate->getArity(); ++i)
 			{
 				std::vector<const Object*> objects_of_type;
@@ -335,9 +597,15 @@ unsigned int GroundedAtom::numberOfGroundedAtoms()
 	return instantiated_grounded_atoms_.size();
 }
 
-GroundedAtom::GroundedAtom(const Predicate& predicate, const Object** variables)
-	: predicate_(&predicate), variables_(variables)
+GroundedAtom::GroundedAtom(const Predicate& predicate, const Object* const* variables, unsigned int id)
+	: predicate_(&predicate), variables_(predicate.getArity() <= MAX_INLINE_TERMS ? inline_variables_ : new const Object*[predicate.getArity()]), id_(id), hash_(0)
 {
+	boost::hash_combine(hash_, predicate.getName());
+	for (unsigned int i = 0; i < predicate.getArity(); ++i)
+	{
+		variables_[i] = variables[i];
+		boost::hash_combine(hash_, variables[i]->getId());
+	}
 //	std::cout << "New Grounded atom: " << *this << std::endl;
 }
 /*
@@ -357,7 +625,11 @@ GroundedAtom::GroundedAtom(const SAS_Plus::BoundedAtom& bounded_atom, const Bind
 */
 GroundedAtom::~GroundedAtom()
 {
-	delete[] variables_;
+	grounded_atoms_by_id_[id_] = NULL;
+	if (variables_ != inline_variables_)
+	{
+		delete[] variables_;
+	}
 }
 
 bool GroundedAtom::operator==(const GroundedAtom& rhs) const
@@ -399,14 +671,15 @@ State::State(const std::vector<const GroundedAtom*>& facts, bool created_by_help
 */
 
 State::State(bool created_by_helpful_action)
-	: parent_(NULL), achieving_action_(NULL), distance_to_goal_(0), distance_from_start_(0), created_by_helpful_action_(created_by_helpful_action)
+	: parent_(NULL), achieving_action_(NULL), distance_to_goal_(0), distance_from_start_(0), created_by_helpful_action_(created_by_helpful_action), nr_successors_(0), accepted_landmarks_(NULL)
 {
 	
 }
 
 State::State(const State& rhs, const GroundedAction& grounded_action, bool created_by_helpful_action)
-	: parent_(&rhs), achieving_action_(&grounded_action)/*, facts_(rhs.facts_)*/, distance_to_goal_(rhs.distance_to_goal_), distance_from_start_(rhs.distance_from_start_ + 1), created_by_helpful_action_(created_by_helpful_action)
+	: parent_(&rhs), achieving_action_(&grounded_action)/*, facts_(rhs.facts_)*/, distance_to_goal_(rhs.distance_to_goal_), distance_from_start_(rhs.distance_from_start_ + 1), created_by_helpful_action_(created_by_helpful_action), nr_successors_(0), accepted_landmarks_(NULL)
 {
+	++rhs.nr_successors_;
 	//achievers_.insert(achievers_.end(), rhs.achievers_.begin(), rhs.achievers_.end());
 	//achievers_.push_back(&grounded_action);
 	//	std::sort(facts_.begin(), facts_.end());
@@ -438,6 +711,7 @@ void State::checkSanity() const
 
 State::~State()
 {
+	delete accepted_landmarks_;
 /*
 	for (std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >::const_iterator ci = helpful_actions_.begin(); ci != helpful_actions_.end(); ++ci)
 	{
@@ -457,6 +731,32 @@ State::~State()
 */
 }
 
+void State::setAcceptedLandmarks(const boost::dynamic_bitset<>& accepted_landmarks)
+{
+	if (accepted_landmarks_ == NULL)
+	{
+		accepted_landmarks_ = new boost::dynamic_bitset<>(accepted_landmarks);
+	}
+	else
+	{
+		*accepted_landmarks_ = accepted_landmarks;
+	}
+}
+
+void State::deleteUnusedStates(const State* state, const State* state_to_keep)
+{
+	while (state != NULL && state != state_to_keep && state->nr_successors_ == 0)
+	{
+		const State* parent = state->parent_;
+		if (parent != NULL)
+		{
+			--parent->nr_successors_;
+		}
+		delete state;
+		state = parent;
+	}
+}
+
 //bool State::areSymmetrical(const State& state, REACHABILITY::EquivalentObjectGroupManager& eog_manager, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager) const
 bool State::areSymmetrical(const State& state, const HEURISTICS::HeuristicInterface& heuristic, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager) const
 {
@@ -681,6 +981,57 @@ void State::getSymmetricalObjects(std::vector<REACHABILITY::ReachableFact*>& sta
 }
 */
 
+ObjectOrbits::ObjectOrbits(const std::multimap<const Object*, const Object*>& symmetrical_groups)
+{
+	for (std::multimap<const Object*, const Object*>::const_iterator ci = symmetrical_groups.begin(); ci != symmetrical_groups.end(); ++ci)
+	{
+		unsigned int object_id = (*ci).first->getId();
+		unsigned int symmetrical_object_id = (*ci).second->getId();
+		
+		while (orbit_ids_.size() <= std::max(object_id, symmetrical_object_id))
+		{
+			orbit_ids_.push_back(orbit_ids_.size());
+		}
+		
+		if (symmetrical_object_id < orbit_ids_[object_id])
+		{
+			orbit_ids_[object_id] = symmetrical_object_id;
+		}
+	}
+}
+
+unsigned int ObjectOrbits::getOrbitId(const Object& object) const
+{
+	if (object.getId() < orbit_ids_.size())
+	{
+		return orbit_ids_[object.getId()];
+	}
+	return object.getId();
+}
+
+void ObjectOrbits::getProjection(std::vector<unsigned int>& projection, const Object* const* assigned_variables, unsigned int nr_variables) const
+{
+	for (unsigned int i = 0; i < nr_variables; ++i)
+	{
+		if (assigned_variables[i] == NULL)
+		{
+			projection.push_back(std::numeric_limits<unsigned int>::max());
+			projection.push_back(i);
+			continue;
+		}
+		
+		projection.push_back(getOrbitId(*assigned_variables[i]));
+		
+		// Store the first variable which is assigned the same object.
+		unsigned int first_equal_variable = 0;
+		while (assigned_variables[first_equal_variable] != assigned_variables[i])
+		{
+			++first_equal_variable;
+		}
+		projection.push_back(first_equal_variable);
+	}
+}
+
 //void State::getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const State*>& all_states) const
 //void State::getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const State*>& all_states, const TermManager& term_manager, const std::vector<const GroundedAtom*>& goals, const HEURISTICS::HeuristicInterface& heuristic) const
 void State::getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const
@@ -689,129 +1040,33 @@ void State::getSuccessors(NewStateReachedListener& listener, const std::multimap
 	std::cout << "Find successors of" << std::endl << *this << std::endl;
 #endif
 	
-	/*
-	// Instantiate all the helpful actions and try to find preconditions to match them.
-	//if (helpful_actions_.size() > 0 && false)
-	if (false)
+	// Instantiate the helpful actions directly from their variable domains. Only if none of them is applicable in this state do
+	// we fall back to considering all the actions.
+	ObjectOrbits orbits(symmetrical_groups);
+	if (prune_unhelpful_actions && !helpful_actions.empty())
 	{
-					
-		std::vector<const GroundedAction*> already_tried_actions;
-		// TODO: Maybe shuffle? std::shuffle().
-		
-		
-		for (std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >::const_iterator ci = helpful_actions_.begin(); ci != helpful_actions_.end(); ++ci)
+		if (instantiateHelpfulActions(listener, orbits, initial_facts, helpful_actions) > 0)
 		{
-			const REACHABILITY::AchievingTransition* transition = (*ci).first;
-			const std::vector<HEURISTICS::VariableDomain*>* variable_domains = (*ci).second;
-			const Action& action = transition->getAchiever()->getTransition().getAction();
-			
-			unsigned int counter[action.getVariables().size()];
-			memset(&counter[0], 0, sizeof(unsigned int) * action.getVariables().size());
-			
-			const Object* assigned_variables[action.getVariables().size()];
-			
-			std::vector<const Atom*> preconditions;
-			std::vector<const Equality*> equalities;
-			Utility::convertFormula(preconditions, equalities, &action.getPrecondition());
-			
-			bool done = false;
-			while (!done)
-			{
-				done = true;
-				memset(assigned_variables, 0, sizeof(Object*) * action.getVariables().size());
-				
-				for (unsigned int action_variable_index = 0; action_variable_index < action.getVariables().size(); ++action_variable_index)
-				{
-					//HEURISTICS::VariableDomain* vd = transition->getVariableAssignments()[action_variable_index];
-					HEURISTICS::VariableDomain* vd = (*variable_domains)[action_variable_index];
-					assigned_variables[action_variable_index] = vd->getVariableDomain()[counter[action_variable_index]];
-				}
-				
-				// Ground this action.
-				const GroundedAction& grounded_action = GroundedAction::getGroundedAction(action, assigned_variables);
-				
-				// Make sure a symmetrical precondition has not been used.
-				bool is_symmetrical = false;
-				for (std::vector<const GroundedAction*>::const_iterator ci = already_tried_actions.begin(); ci != already_tried_actions.end(); ++ci)
-				{
-					const GroundedAction* old_action = *ci;
-					if (old_action->getAction().getVariables().size() != grounded_action.getAction().getVariables().size() ||
-							old_action->getAction().getPredicate() != grounded_action.getAction().getPredicate())
-					{
-						continue;
-					}
-					
-					bool terms_are_symmetrical = true;
-					for (unsigned int term_index = 0; term_index < old_action->getAction().getVariables().size(); ++term_index)
-					{
-						std::pair<std::multimap<const Object*, const Object*>::const_iterator, std::multimap<const Object*, const Object*>::const_iterator> eo_ci = symmetrical_groups.equal_range(&old_action->getVariablesAssignment(term_index));
-						bool found_symmetrical_object = false;
-						for (std::multimap<const Object*, const Object*>::const_iterator ci = eo_ci.first; ci != eo_ci.second; ++ci)
-						{
-							const Object* symmetrical_object = (*ci).second;
-							if (symmetrical_object == &grounded_action.getVariablesAssignment(term_index))
-							{
-								found_symmetrical_object = true;
-								break;
-							}
-						}
-						
-						if (!found_symmetrical_object)
-						{
-							terms_are_symmetrical = false;
-							break;
-						}
-					}
-					
-					// If the terms are symmetrical than we do not need to persue this branch further!
-					if (terms_are_symmetrical)
-					{
-		//				std::cerr << *fact << " == " << *grounded_atom << std::endl;
-						is_symmetrical = true;
-						break;
-					}
-				}
-				
-				if (is_symmetrical)
-				{
-					continue;
-				}
-
-				
-				//if (all_precondition_satisfied)
-				{
-					already_tried_actions.push_back(&grounded_action);
-					// Create a new state!
-					State* new_state = new State(*this, grounded_action, true);
 #ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
-//				std::cout << "Copy the old state: " << *new_state << std::endl;
+			std::cout << "Found successors using the helpful actions of: " << std::endl << *this << std::endl;
 #endif
-					listener.addNewState(*new_state);
-				}
-				
-				for (unsigned int action_variable_index = 0; action_variable_index < action.getVariables().size(); ++action_variable_index)
-				{
-					//if (counter[action_variable_index] + 1 != transition->getVariableAssignments()[action_variable_index]->getVariableDomain().size())
-					if (counter[action_variable_index] + 1 != (*variable_domains)[action_variable_index]->getVariableDomain().size())
-					{
-						done = false;
-						counter[action_variable_index] = counter[action_variable_index] + 1;
-						break;
-					}
-					else
-					{
-						counter[action_variable_index] = 0;
-					}
-				}
-			}
+			return;
 		}
+#ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
+		std::cout << "None of the helpful actions are applicable, consider all actions." << std::endl;
+#endif
+		prune_unhelpful_actions = false;
 	}
-	else*/
+	
 	{
 		for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ci++)
 		{
 			const Action* action = *ci;
-			
+			if (!action_manager.isRelevant(*action))
+			{
+				continue;
+			}
+			
 			std::vector<const Atom*> preconditions;
 			std::vector<const Equality*> equalities;
 			Utility::convertFormula(preconditions, equalities, &action->getPrecondition());
@@ -820,7 +1075,8 @@ void State::getSuccessors(NewStateReachedListener& listener, const std::multimap
 			const Object* assigned_variables[action->getVariables().size()];
 			memset(assigned_variables, 0, sizeof(Object*) * action->getVariables().size());
 			
-			instantiateAndExecuteAction(listener, symmetrical_groups, *action, preconditions, equalities, 0, assigned_variables, type_manager, prune_unhelpful_actions, initial_facts, helpful_actions);
+			OrbitProjectionSet tried_actions;
+			instantiateAndExecuteAction(listener, orbits, tried_actions, *action, preconditions, equalities, 0, assigned_variables, type_manager, prune_unhelpful_actions, initial_facts, helpful_actions);
 		}
 	}
 #ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
@@ -852,11 +1108,293 @@ bool State::isSuperSetOf(const std::vector<const GroundedAtom*>& initial_facts,
 	return true;
 }
 
+namespace {
+
+/**
+ * Order grounded atoms by their ids.
+ */
+struct GroundedAtomIdOrdering
+{
+	bool operator()(const GroundedAtom* lhs, const GroundedAtom* rhs) const
+	{
+		return lhs->getId() < rhs->getId();
+	}
+};
+
+/**
+ * A term of a precondition or an equality of an action: either the index of an action variable, or a constant in which case
+ * the index is the maximum unsigned int.
+ */
+typedef std::pair<unsigned int, const Object*> ActionTerm;
+
+ActionTerm getActionTerm(const Action& action, const Term& term)
+{
+	unsigned int action_variable_index = action.getActionVariable(term);
+	if (action_variable_index == std::numeric_limits<unsigned int>::max())
+	{
+		return std::make_pair(action_variable_index, static_cast<const Object*>(&term));
+	}
+	return std::make_pair(action_variable_index, static_cast<const Object*>(NULL));
+}
+
+/**
+ * @return The object assigned to the term, or NULL if it is an action variable which has not been assigned yet.
+ */
+const Object* getAssignedObject(const ActionTerm& term, const Object* const* assigned_variables)
+{
+	return term.second != NULL ? term.second : assigned_variables[term.first];
+}
+
+/**
+ * Finds the assignments to the variables of a helpful action for which its preconditions are satisfied in a state. The
+ * positive preconditions are joined one at a time with the facts of the state which share their predicate, and a variable is
+ * only bound to the objects of its domain. The variables which are not part of a positive precondition are assigned every
+ * object of their domain, after which the equalities and the negative preconditions are checked.
+ */
+class HelpfulActionJoin
+{
+public:
+	/**
+	 * @param object_sets For every action variable, the objects it can be assigned to ordered by their address.
+	 * @param indexed_state_facts The facts of the state indexed by the names of their predicates.
+	 */
+	HelpfulActionJoin(const Action& action, const std::vector<std::vector<const Object*> >& object_sets, const std::map<std::string, std::vector<const GroundedAtom*> >& indexed_state_facts);
+	
+	void getAssignments(std::vector<std::vector<const Object*> >& assignments);
+	
+private:
+	
+	/**
+	 * Bind the variables of the positive precondition with the given index and all those after it.
+	 */
+	void join(unsigned int precondition_index);
+	
+	/**
+	 * Assign all the objects of their domain to the variables from the given index onwards which have not been bound yet.
+	 */
+	void assignFreeVariables(unsigned int variable_index);
+	
+	/**
+	 * @return True if the precondition, with all its terms assigned, is part of the state.
+	 */
+	bool isTrue(const Atom& precondition, const std::vector<ActionTerm>& terms) const;
+	
+	bool matches(const GroundedAtom& fact, const Atom& precondition, const std::vector<ActionTerm>& terms) const;
+	
+	const std::vector<const GroundedAtom*>* getFacts(const Atom& precondition) const;
+	
+	const Object* const* getAssignedVariables() const { return assigned_variables_.empty() ? NULL : &assigned_variables_[0]; }
+	
+	const std::vector<std::vector<const Object*> >* object_sets_;
+	const std::map<std::string, std::vector<const GroundedAtom*> >* indexed_state_facts_;
+	
+	std::vector<const Atom*> positive_preconditions_, negative_preconditions_;
+	std::vector<std::vector<ActionTerm> > positive_precondition_terms_, negative_precondition_terms_;
+	std::vector<const Equality*> equalities_;
+	std::vector<std::pair<ActionTerm, ActionTerm> > equality_terms_;
+	
+	std::vector<const Object*> assigned_variables_;
+	std::vector<std::vector<const Object*> >* assignments_;
+};
+
+HelpfulActionJoin::HelpfulActionJoin(const Action& action, const std::vector<std::vector<const Object*> >& object_sets, const std::map<std::string, std::vector<const GroundedAtom*> >& indexed_state_facts)
+	: object_sets_(&object_sets), indexed_state_facts_(&indexed_state_facts), assigned_variables_(action.getVariables().size(), NULL), assignments_(NULL)
+{
+	std::vector<const Atom*> preconditions;
+	Utility::convertFormula(preconditions, equalities_, &action.getPrecondition());
+	
+	// Map the terms of the preconditions and equalities to the action variables, or to the constants they refer to.
+	for (std::vector<const Atom*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+	{
+		const Atom* precondition = *ci;
+		std::vector<ActionTerm> terms;
+		for (unsigned int term_index = 0; term_index < precondition->getArity(); ++term_index)
+		{
+			terms.push_back(getActionTerm(action, *precondition->getTerms()[term_index]));
+		}
+		
+		if (precondition->isNegative())
+		{
+			negative_preconditions_.push_back(precondition);
+			negative_precondition_terms_.push_back(terms);
+		}
+		else
+		{
+			positive_preconditions_.push_back(precondition);
+			positive_precondition_terms_.push_back(terms);
+		}
+	}
+	
+	for (std::vector<const Equality*>::const_iterator ci = equalities_.begin(); ci != equalities_.end(); ++ci)
+	{
+		equality_terms_.push_back(std::make_pair(getActionTerm(action, (*ci)->getLHSTerm()), getActionTerm(action, (*ci)->getRHSTerm())));
+	}
+}
+
+void HelpfulActionJoin::getAssignments(std::vector<std::vector<const Object*> >& assignments)
+{
+	assignments_ = &assignments;
+	join(0);
+	assignments_ = NULL;
+}
+
+void HelpfulActionJoin::join(unsigned int precondition_index)
+{
+	if (precondition_index == positive_preconditions_.size())
+	{
+		assignFreeVariables(0);
+		return;
+	}
+	
+	const Atom* precondition = positive_preconditions_[precondition_index];
+	const std::vector<ActionTerm>& terms = positive_precondition_terms_[precondition_index];
+	const std::vector<const GroundedAtom*>* facts = getFacts(*precondition);
+	if (facts == NULL)
+	{
+		return;
+	}
+	
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts->begin(); ci != facts->end(); ++ci)
+	{
+		const GroundedAtom* fact = *ci;
+		if (fact->getPredicate().getArity() != precondition->getArity())
+		{
+			continue;
+		}
+		
+		// Bind the variables which are not bound yet, they are released again once all the facts after it have been tried.
+		std::vector<unsigned int> bound_variables;
+		bool can_unify = true;
+		for (unsigned int term_index = 0; term_index < precondition->getArity() && can_unify; ++term_index)
+		{
+			const ActionTerm& term = terms[term_index];
+			const Object* object = &fact->getObject(term_index);
+			const Object* assigned_object = getAssignedObject(term, getAssignedVariables());
+			if (assigned_object != NULL)
+			{
+				can_unify = assigned_object == object;
+			}
+			else if (std::binary_search((*object_sets_)[term.first].begin(), (*object_sets_)[term.first].end(), object))
+			{
+				assigned_variables_[term.first] = object;
+				bound_variables.push_back(term.first);
+			}
+			else
+			{
+				can_unify = false;
+			}
+		}
+		
+		if (can_unify)
+		{
+			join(precondition_index + 1);
+		}
+		
+		for (std::vector<unsigned int>::const_iterator ci = bound_variables.begin(); ci != bound_variables.end(); ++ci)
+		{
+			assigned_variables_[*ci] = NULL;
+		}
+	}
+}
+
+void HelpfulActionJoin::assignFreeVariables(unsigned int variable_index)
+{
+	if (variable_index == assigned_variables_.size())
+	{
+		const Object* const* assigned_variables = getAssignedVariables();
+		for (unsigned int i = 0; i < equalities_.size(); ++i)
+		{
+			if ((getAssignedObject(equality_terms_[i].first, assigned_variables) == getAssignedObject(equality_terms_[i].second, assigned_variables)) == equalities_[i]->isNegative())
+			{
+				return;
+			}
+		}
+		
+		for (unsigned int i = 0; i < negative_preconditions_.size(); ++i)
+		{
+			if (isTrue(*negative_preconditions_[i], negative_precondition_terms_[i]))
+			{
+				return;
+			}
+		}
+		
+		assignments_->push_back(assigned_variables_);
+		return;
+	}
+	
+	if (assigned_variables_[variable_index] != NULL)
+	{
+		assignFreeVariables(variable_index + 1);
+		return;
+	}
+	
+	const std::vector<const Object*>& object_set = (*object_sets_)[variable_index];
+	for (std::vector<const Object*>::const_iterator ci = object_set.begin(); ci != object_set.end(); ++ci)
+	{
+		assigned_variables_[variable_index] = *ci;
+		assignFreeVariables(variable_index + 1);
+	}
+	assigned_variables_[variable_index] = NULL;
+}
+
+bool HelpfulActionJoin::isTrue(const Atom& precondition, const std::vector<ActionTerm>& terms) const
+{
+	const std::vector<const GroundedAtom*>* facts = getFacts(precondition);
+	if (facts == NULL)
+	{
+		return false;
+	}
+	
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts->begin(); ci != facts->end(); ++ci)
+	{
+		if (matches(**ci, precondition, terms))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HelpfulActionJoin::matches(const GroundedAtom& fact, const Atom& precondition, const std::vector<ActionTerm>& terms) const
+{
+	if (fact.getPredicate().getArity() != precondition.getArity())
+	{
+		return false;
+	}
+	
+	for (unsigned int term_index = 0; term_index < precondition.getArity(); ++term_index)
+	{
+		if (&fact.getObject(term_index) != getAssignedObject(terms[term_index], getAssignedVariables()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const std::vector<const GroundedAtom*>* HelpfulActionJoin::getFacts(const Atom& precondition) const
+{
+	std::map<std::string, std::vector<const GroundedAtom*> >::const_iterator ci = indexed_state_facts_->find(precondition.getPredicate().getName());
+	if (ci == indexed_state_facts_->end())
+	{
+		return NULL;
+	}
+	return &(*ci).second;
+}
+
+};
+
 void State::getFacts(const std::vector<const GroundedAtom*>& initial_facts, std::vector<const GroundedAtom*>& facts) const
+{
+	getFactsOrderedById(initial_facts, facts);
+	std::sort(facts.begin(), facts.end());
+}
+
+void State::getFactsOrderedById(const std::vector<const GroundedAtom*>& initial_facts, std::vector<const GroundedAtom*>& facts) const
 {
 	if (parent_ != NULL)
 	{
-		parent_->getFacts(initial_facts, facts);
+		parent_->getFactsOrderedById(initial_facts, facts);
 		achieving_action_->applyTo(facts);
 	}
 	
@@ -864,8 +1402,8 @@ void State::getFacts(const std::vector<const GroundedAtom*>& initial_facts, std:
 	else
 	{
 		facts.insert(facts.end(), initial_facts.begin(), initial_facts.end());
+		std::sort(facts.begin(), facts.end(), GroundedAtomIdOrdering());
 	}
-	std::sort(facts.begin(), facts.end());
 }
 
 /*
@@ -1010,11 +1548,11 @@ void State::removeFact(const GroundedAtom& fact)
 	std::sort(facts_.begin(), facts_.end());
 }
 */
-void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const Action& action, const std::vector<const Atom*>& preconditions, const std::vector<const Equality*>& equalities, unsigned int uninitialised_precondition_index, const Object** assigned_variables, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const
+void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const ObjectOrbits& orbits, OrbitProjectionSet& tried_actions, const Action& action, const std::vector<const Atom*>& preconditions, const std::vector<const Equality*>& equalities, unsigned int uninitialised_precondition_index, const Object** assigned_variables, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const
 {
 	// Find facts in the current state which can unify with the 'uninitialised_precondition_index'th precondition and does not violate the already assigned variables.
 	const Atom* precondition = preconditions[uninitialised_precondition_index];
-	std::vector<const GroundedAtom*> already_tried_facts;
+	OrbitProjectionSet tried_assignments;
 	
 	//std::cout << "Try to apply: " << action << "." << std::endl;
 	
@@ -1082,51 +1620,11 @@ void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const
 		std::cout << ")" << std::endl;
 #endif
 		
-		// Make sure a symmetrical precondition has not been used.
-		bool is_symmetrical = false;
-		for (std::vector<const GroundedAtom*>::const_iterator ci = already_tried_facts.begin(); ci != already_tried_facts.end(); ++ci)
-		{
-			const GroundedAtom* fact = *ci;
-			if (fact->getPredicate().getArity() != grounded_atom->getPredicate().getArity() ||
-			    fact->getPredicate().getName() != grounded_atom->getPredicate().getName())
-			{
-				continue;
-			}
-			
-			bool terms_are_symmetrical = true;
-			for (unsigned int term_index = 0; term_index < fact->getPredicate().getArity(); ++term_index)
-			{
-				std::pair<std::multimap<const Object*, const Object*>::const_iterator, std::multimap<const Object*, const Object*>::const_iterator> eo_ci = symmetrical_groups.equal_range(&fact->getObject(term_index));
-				bool found_symmetrical_object = false;
-				for (std::multimap<const Object*, const Object*>::const_iterator ci = eo_ci.first; ci != eo_ci.second; ++ci)
-				{
-					const Object* symmetrical_object = (*ci).second;
-					if (symmetrical_object == &grounded_atom->getObject(term_index))
-					{
-						found_symmetrical_object = true;
-						break;
-					}
-				}
-				
-				if (!found_symmetrical_object)
-				{
-					terms_are_symmetrical = false;
-					break;
-				}
-			}
-			
-			// If the terms are symmetrical than we do not need to persue this branch further!
-			if (terms_are_symmetrical)
-			{
-#ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
-				std::cerr << *fact << " == " << *grounded_atom << std::endl;
-#endif
-				is_symmetrical = true;
-				break;
-			}
-		}
-		
-		if (is_symmetrical)
+		// Make sure a symmetrical assignment has not been used. All the candidates share the variables assigned so far, so if 
+		// the projections are equal there is a symmetry which maps one assignment to the other and leaves these variables intact.
+		std::vector<unsigned int> projection;
+		orbits.getProjection(projection, new_assigned_variables, action.getVariables().size());
+		if (!tried_assignments.insert(projection).second)
 		{
 #ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
 			std::cout << "\tIs symmetrical." << std::endl;
@@ -1137,7 +1635,6 @@ void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const
 		// Found an atom which satisfies all constraints, check if we now have a full assignment!
 		if (uninitialised_precondition_index + 1 == preconditions.size())
 		{
-			already_tried_facts.push_back(grounded_atom);
 #ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
 			std::cout << "Found a successor state!" << std::endl;
 #endif
@@ -1170,6 +1667,14 @@ void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const
 			for (std::vector<const Object**>::const_iterator ci = all_grounded_action_variables.begin(); ci != all_grounded_action_variables.end(); ci++)
 			{
 				const Object** grounded_action_variables = *ci;
+				
+				// Different branches of the search can lead to symmetrical actions.
+				std::vector<unsigned int> action_projection;
+				orbits.getProjection(action_projection, grounded_action_variables, action.getVariables().size());
+				if (!tried_actions.insert(action_projection).second)
+				{
+					continue;
+				}
 
 				// Check if this is a helpful action or not.
 				bool is_helpful = helpful_actions.empty();
@@ -1235,7 +1740,7 @@ void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const
 				for (std::vector<const Atom*>::const_iterator ci = action.getEffects().begin(); ci != action.getEffects().end(); ci++)
 				{
 					const Atom* effect = *ci;
-					const Object** effect_variables = new const Object*[effect->getArity()];
+					const Object* effect_variables[effect->getArity()];
 					
 					for (unsigned int i = 0; i < effect->getArity(); i++)
 					{
@@ -1289,7 +1794,7 @@ void State::instantiateAndExecuteAction(NewStateReachedListener& listener, const
 		// Add it as a precondition and try to find atoms to satisfy the remainder of the preconditions.
 		else
 		{
-			instantiateAndExecuteAction(listener, symmetrical_groups, action, preconditions, equalities, uninitialised_precondition_index + 1, new_assigned_variables, type_manager, prune_unhelpful_actions, initial_facts, helpful_actions);
+			instantiateAndExecuteAction(listener, orbits, tried_actions, action, preconditions, equalities, uninitialised_precondition_index + 1, new_assigned_variables, type_manager, prune_unhelpful_actions, initial_facts, helpful_actions);
 		}
 	}
 }
@@ -1344,6 +1849,87 @@ void State::createAllGroundedVariables(std::vector<const Object**>& all_grounded
 	}
 }
 
+unsigned int State::instantiateHelpfulActions(NewStateReachedListener& listener, const ObjectOrbits& orbits, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const
+{
+	std::vector<const GroundedAtom*> state_facts;
+	getFacts(initial_facts, state_facts);
+	
+	// Index the facts by their predicate so we only need to consider the facts which can satisfy a precondition.
+	std::map<std::string, std::vector<const GroundedAtom*> > indexed_state_facts;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ++ci)
+	{
+		indexed_state_facts[(*ci)->getPredicate().getName()].push_back(*ci);
+	}
+	
+	unsigned int states_created = 0;
+	OrbitProjectionSet tried_actions;
+	for (std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >::const_iterator ci = helpful_actions.begin(); ci != helpful_actions.end() && listener.continueSearching(); ++ci)
+	{
+		const REACHABILITY::AchievingTransition* transition = (*ci).first;
+		const std::vector<HEURISTICS::VariableDomain*>* variable_domains = (*ci).second;
+		const Action& action = transition->getAchiever()->getTransition().getAction();
+		unsigned int nr_action_variables = action.getVariables().size();
+		
+		if (variable_domains->size() != nr_action_variables)
+		{
+			continue;
+		}
+		
+		// Only consider the objects which can be assigned to the action variables, the domains are ordered by address.
+		std::vector<std::vector<const Object*> > object_sets(nr_action_variables);
+		bool has_empty_domain = false;
+		for (unsigned int i = 0; i < nr_action_variables; ++i)
+		{
+			const std::vector<const Object*>& variable_domain = (*variable_domains)[i]->getVariableDomain();
+			for (std::vector<const Object*>::const_iterator ci = variable_domain.begin(); ci != variable_domain.end(); ++ci)
+			{
+				if ((*ci)->getType()->isCompatible(*action.getVariables()[i]->getType()))
+				{
+					object_sets[i].push_back(*ci);
+				}
+			}
+			if (object_sets[i].empty())
+			{
+				has_empty_domain = true;
+				break;
+			}
+		}
+		
+		if (has_empty_domain)
+		{
+			continue;
+		}
+		
+		std::vector<std::vector<const Object*> > assignments;
+		HelpfulActionJoin join(action, object_sets, indexed_state_facts);
+		join.getAssignments(assignments);
+		
+		for (std::vector<std::vector<const Object*> >::const_iterator ci = assignments.begin(); ci != assignments.end() && listener.continueSearching(); ++ci)
+		{
+			const Object* assigned_variables[nr_action_variables];
+			std::copy((*ci).begin(), (*ci).end(), assigned_variables);
+			
+			// Make sure a symmetrical action has not been used, this also filters actions which are part of multiple helpful actions.
+			std::vector<unsigned int> projection;
+			projection.push_back(action.getId());
+			orbits.getProjection(projection, assigned_variables, nr_action_variables);
+			if (!tried_actions.insert(projection).second)
+			{
+				continue;
+			}
+			
+			const GroundedAction& grounded_action = GroundedAction::getGroundedAction(action, assigned_variables);
+			State* new_state = new State(*this, grounded_action, true);
+#ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
+			std::cout << "Helpful successor state: " << grounded_action << std::endl;
+#endif
+			listener.addNewState(*new_state);
+			++states_created;
+		}
+	}
+	return states_created;
+}
+
 /*
 void State::deleteHelpfulActions()
 {
@@ -1380,6 +1966,19 @@ bool State::isEqualTo(const State& other, const std::vector<const GroundedAtom*>
 	return true;
 }
 
+std::size_t State::getHash(const std::vector<const GroundedAtom*>& initial_facts) const
+{
+	std::vector<const GroundedAtom*> state_facts;
+	getFacts(initial_facts, state_facts);
+	
+	std::size_t hash = 0;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ++ci)
+	{
+		hash += (*ci)->getHash();
+	}
+	return hash;
+}
+
 bool State::operator==(const State& state) const
 {
 	assert (false);
@@ -1459,7 +2058,7 @@ bool CompareStates::operator()(const State* lhs, const State* rhs)
 }
 
 ForwardChainingPlanner::ForwardChainingPlanner(const ActionManager& action_manager, PredicateManager& predicate_manager, const TypeManager& type_manager, HEURISTICS::HeuristicInterface& heuristic)
-	: action_manager_(&action_manager), predicate_manager_(&predicate_manager), type_manager_(&type_manager), heuristic_(&heuristic)
+	: action_manager_(&action_manager), predicate_manager_(&predicate_manager), type_manager_(&type_manager), heuristic_(&heuristic), seed_(0), cancel_flag_(NULL), state_packer_(NULL), external_memory_budget_(0), transposition_table_(NULL)
 {
 	
 }
@@ -1471,42 +2070,30 @@ ForwardChainingPlanner::~ForwardChainingPlanner()
 
 std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions, bool allow_restarts, bool allow_new_goals_to_be_added)
 {
-	std::srand(std::time(NULL));
+	unsigned int random_state = seed_;
 	unsigned int states_seen_without_improvement = 0;
 	std::vector<const GroundedAtom*> grounded_initial_facts;
-	for (std::vector<const Atom*>::const_iterator ci = initial_facts.begin(); ci != initial_facts.end(); ci++)
-	{
-		const Atom* initial_fact = *ci;
-		const Object** variables = new const Object*[initial_fact->getArity()];
-
-		for (unsigned int i = 0; i < initial_fact->getArity(); ++i)
-		{
-			variables[i] = static_cast<const Object*>(initial_fact->getTerms()[i]);
-		}
-		
-		grounded_initial_facts.push_back(&GroundedAtom::getGroundedAtom(initial_fact->getPredicate(), variables));
-	}
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
 	
 	std::vector<const GroundedAtom*> grounded_goal_facts;
-	for (std::vector<const Atom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ci++)
-	{
-		const Atom* goal_fact = *ci;
-		const Object** variables = new const Object*[goal_fact->getArity()];
-
-		for (unsigned int i = 0; i < goal_fact->getArity(); ++i)
-		{
-			variables[i] = static_cast<const Object*>(goal_fact->getTerms()[i]);
-		}
-		
-		grounded_goal_facts.push_back(&GroundedAtom::getGroundedAtom(goal_fact->getPredicate(), variables));
-	}
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
 	
 	// All the grounded atoms that should never be removed.
 	std::vector<const GroundedAtom*> grounded_atoms_not_to_be_removed;
 	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_initial_facts.begin(), grounded_initial_facts.end());
 	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_goal_facts.begin(), grounded_goal_facts.end());
 	
+	// Without a memory budget all the processed states are kept until the search ends, with a memory budget a processed
+	// state is deleted as soon as none of the states we still have to explore descend from it.
 	std::vector<const State*> processed_states;
+	// The closed list stores the canonical forms of the processed states, so a state is only compared against the canonical
+	// forms of the processed states whose hash is the same.
+	boost::unordered_set<std::vector<unsigned int> > closed_list;
+	CanonicalColouredGraph canonical_graph(*action_manager_, grounded_goal_facts);
+	
+	// If a memory budget is set the canonical forms themselves are stored in the external closed list.
+	bool use_external_closed_list = external_memory_budget_ > 0;
+	ExternalClosedList external_closed_list(external_directory_, external_memory_budget_);
 	//State* initial_state = new State(grounded_initial_facts, true);
 	State* initial_state = new State(true);
 	
@@ -1518,6 +2105,12 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 	heuristic_->setHeuristicForState(*initial_state, grounded_initial_facts, grounded_goal_facts, term_manager, true, allow_new_goals_to_be_added);
 	GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
 	
+	// The stored heuristic values are only valid for the goals they were calculated for.
+	if (transposition_table_ != NULL)
+	{
+		transposition_table_->setGoals(grounded_goal_facts);
+	}
+	
 	std::priority_queue<State*, std::vector<State*>, CompareStates> queue;
 	queue.push(initial_state);
 	
@@ -1527,20 +2120,23 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 	unsigned int best_heuristic_estimate = std::numeric_limits<unsigned int>::max();
 	
 	State* last_best_state_seen = initial_state;
+	std::vector<unsigned int> last_best_state_canonical_form;
 	unsigned int base = 2;
 	unsigned int min_power = 1;
 	unsigned int max_power = 12;
 	unsigned int current_power = min_power;
 	
 	std::vector<State*> current_states_to_explore;
+	std::vector<std::vector<unsigned int> > current_canonical_forms;
 	unsigned int current_best_value_in_list = initial_state->getHeuristic();
 	
-	while (!queue.empty() || !current_states_to_explore.empty())
+	while ((!queue.empty() || !current_states_to_explore.empty()) && !isCancelled())
 	{
 		// Create a list of states which have the same heuristic value.
 		if (current_states_to_explore.empty() || queue.top()->getHeuristic() == current_best_value_in_list)
 		{
 			current_best_value_in_list = queue.top()->getHeuristic();
+			unsigned int first_new_state = current_states_to_explore.size();
 			
 			while (!queue.empty() && queue.top()->getHeuristic() == current_best_value_in_list)
 			{
@@ -1548,15 +2144,66 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 				queue.pop();
 				current_states_to_explore.push_back(state);
 			}
+			
+			// The states which have been spilled to disk are detected for the whole list at once, so the runs on disk are 
+			// read at most once for every list of states.
+			if (use_external_closed_list)
+			{
+				for (unsigned int i = first_new_state; i < current_states_to_explore.size(); ++i)
+				{
+					std::vector<const GroundedAtom*> state_facts;
+					current_states_to_explore[i]->getFacts(grounded_initial_facts, state_facts);
+					current_canonical_forms.push_back(std::vector<unsigned int>());
+					canonical_graph.getCanonicalForm(current_canonical_forms.back(), state_facts);
+				}
+				
+				if (external_closed_list.hasSpilled())
+				{
+					std::vector<const std::vector<unsigned int>*> new_canonical_forms;
+					for (unsigned int i = first_new_state; i < current_canonical_forms.size(); ++i)
+					{
+						new_canonical_forms.push_back(&current_canonical_forms[i]);
+					}
+					std::vector<bool> is_spilled;
+					external_closed_list.findSpilled(new_canonical_forms, is_spilled);
+					
+					unsigned int nr_states = first_new_state;
+					for (unsigned int i = 0; i < is_spilled.size(); ++i)
+					{
+						if (is_spilled[i])
+						{
+							State::deleteUnusedStates(current_states_to_explore[first_new_state + i], last_best_state_seen);
+							continue;
+						}
+						current_states_to_explore[nr_states] = current_states_to_explore[first_new_state + i];
+						current_canonical_forms[nr_states].swap(current_canonical_forms[first_new_state + i]);
+						++nr_states;
+					}
+					current_states_to_explore.resize(nr_states);
+					current_canonical_forms.resize(nr_states);
+				}
+			}
+			
+			if (current_states_to_explore.empty())
+			{
+				continue;
+			}
 		}
 		
 		// From all the elements in the list, pick one at random to explore.
-		unsigned int random_state_index = std::rand() % current_states_to_explore.size();
+		unsigned int random_state_index = rand_r(&random_state) % current_states_to_explore.size();
 		
 		State* state = current_states_to_explore[random_state_index];
 		current_states_to_explore.erase(current_states_to_explore.begin() + random_state_index);
 		
-#ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
+		std::vector<unsigned int> canonical_form;
+		if (use_external_closed_list)
+		{
+			canonical_form.swap(current_canonical_forms[random_state_index]);
+			current_canonical_forms.erase(current_canonical_forms.begin() + random_state_index);
+		}
+		
+#ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
 		std::cout << "Current state: " << *state << std::endl;
 		
 		std::vector<const GroundedAtom*> grounded_atom;
@@ -1572,19 +2219,28 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 //		State* state = queue.top();
 //		queue.pop();
 		
+		// States which are symmetrical to a state we have already processed are pruned.
+		if (!use_external_closed_list)
+		{
+			std::vector<const GroundedAtom*> state_facts;
+			state->getFacts(grounded_initial_facts, state_facts);
+			canonical_graph.getCanonicalForm(canonical_form, state_facts);
+		}
+		
 		bool already_processed = false;
-		for (std::vector<const State*>::const_iterator ci = processed_states.begin(); ci != processed_states.end(); ci++)
+		if (use_external_closed_list)
 		{
-			//if (*state == **ci)
-			if (state->isEqualTo(**ci, grounded_initial_facts))
-			{
-				already_processed = true;
-				break;
-			}
+			// A state whose canonical form got spilled after its list was checked against the disk is expanded again, 
+			// which costs time but does not affect the search.
+			already_processed = !external_closed_list.insert(canonical_form);
+		}
+		else
+		{
+			already_processed = closed_list.count(canonical_form) != 0;
+		}
 #ifdef FC_PLANNER_SAFE_MEMORY
-			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+		GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
 #endif
-		}
 		
 		if (already_processed)
 		{
@@ -1592,7 +2248,14 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 			std::cout << "Already processed!?" << queue.size() << std::endl;
 			std::cout << *state << std::endl;
 #endif
-			delete state;
+			if (use_external_closed_list)
+			{
+				State::deleteUnusedStates(state, last_best_state_seen);
+			}
+			else
+			{
+				delete state;
+			}
 			continue;
 		}
 
@@ -1622,9 +2285,14 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 			//{
 			//	last_best_state_seen->deleteHelpfulActions();
 			//}
+			if (use_external_closed_list)
+			{
+				State::deleteUnusedStates(last_best_state_seen, state);
+			}
 			last_best_state_seen = state;
+			last_best_state_canonical_form = canonical_form;
 			best_heuristic_estimate = state->getHeuristic();
-			std::cerr << "\t" << best_heuristic_estimate << " state = " << processed_states.size() << "; Grounded Actions = " << GroundedAction::numberOfGroundedActions() << "; Grounded atoms: " << GroundedAtom::numberOfGroundedAtoms() << std::endl;
+			std::cerr << "\t" << best_heuristic_estimate << " state = " << states_visited << "; Grounded Actions = " << GroundedAction::numberOfGroundedActions() << "; Grounded atoms: " << GroundedAtom::numberOfGroundedAtoms() << std::endl;
 //			std::cerr << *state << std::endl;
 //			std::cout << "Best new heuristic, empty the queue!" << std::endl;
 			/*
@@ -1678,7 +2346,14 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 			{
 				const State* dead_state = queue.top();
 				queue.pop();
-				delete dead_state;
+				if (use_external_closed_list)
+				{
+					State::deleteUnusedStates(dead_state, last_best_state_seen);
+				}
+				else
+				{
+					delete dead_state;
+				}
 			}
 			
 			for (std::vector<const State*>::const_iterator ci = processed_states.begin(); ci != processed_states.end(); ci++)
@@ -1689,18 +2364,38 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 				}
 			}
 			processed_states.clear();
+			closed_list.clear();
+			external_closed_list.clear();
 			
 			for (std::vector<State*>::const_iterator ci = current_states_to_explore.begin(); ci != current_states_to_explore.end(); ++ci)
 			{
-				delete *ci;
+				if (use_external_closed_list)
+				{
+					State::deleteUnusedStates(*ci, last_best_state_seen);
+				}
+				else
+				{
+					delete *ci;
+				}
 			}
 			current_states_to_explore.clear();
+			current_canonical_forms.clear();
+			
+			if (use_external_closed_list)
+			{
+				State::deleteUnusedStates(state, last_best_state_seen);
+			}
 			
 			// Delete all grounded actions which are not stored in the states.
 			//GroundedAction::removeInstantiatedGroundedActions(last_best_state_seen->getAchievers().begin(), last_best_state_seen->getAchievers().end());
 //			GroundedAction::removeInstantiatedGroundedActions(*last_best_state_seen);
 //			delete state;
 			state = last_best_state_seen;
+			canonical_form = last_best_state_canonical_form;
+			if (use_external_closed_list)
+			{
+				external_closed_list.insert(canonical_form);
+			}
 			current_best_value_in_list = state->getHeuristic();
 			states_seen_without_improvement = 0;
 			
@@ -1708,7 +2403,10 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 			if (prune_unhelpful_actions && current_power == max_power)
 			{
 				std::cerr << "Too many restarts, abort!" << std::endl;
-				processed_states.push_back(state);
+				if (!use_external_closed_list)
+				{
+					processed_states.push_back(state);
+				}
 				break;
 			}
 			
@@ -1716,9 +2414,13 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 		}
 		++states_seen_without_improvement;
 		++states_visited;
-		processed_states.push_back(state);
+		if (!use_external_closed_list)
+		{
+			processed_states.push_back(state);
+			closed_list.insert(canonical_form);
+		}
 		
-		if (states_visited % 1000 == 0) std::cerr << "M" << "s=" << processed_states.size() << ";g=" << GroundedAction::numberOfGroundedActions() << "q=" << queue.size();
+		if (states_visited % 1000 == 0) std::cerr << "M" << "s=" << states_visited << ";g=" << GroundedAction::numberOfGroundedActions() << "q=" << queue.size();
 		else if (states_visited % 100 == 0) std::cerr << ".";
 		//else std::cerr << "@";
 		
@@ -1745,6 +2447,12 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 				parent = parent->getParent();
 			}
 			
+			if (use_external_closed_list)
+			{
+				deleteExternalStates(queue, current_states_to_explore, state, last_best_state_seen);
+				return std::make_pair(states_visited, plan.size());
+			}
+			
 			while (!queue.empty())
 			{
 				const State* state = queue.top();
@@ -1770,7 +2478,7 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 		NewStateReachedListener* new_state_reached_listener = NULL;
 		//if (prune_unhelpful_actions)
 		{
-			new_state_reached_listener = new StateHeuristicListener(successor_states, *state,  *heuristic_, grounded_initial_facts, grounded_goal_facts, term_manager, prune_unhelpful_actions, allow_new_goals_to_be_added);
+			new_state_reached_listener = new StateHeuristicListener(successor_states, *state,  *heuristic_, grounded_initial_facts, grounded_goal_facts, term_manager, prune_unhelpful_actions, allow_new_goals_to_be_added, transposition_table_);
 		}
 		//else
 		//{
@@ -1826,13 +2534,8 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 		{
 			State* successor_state = *ci;
 			++successors_generated;
-			if (prune_unhelpful_actions && !successor_state->isCreatedByHelpfulAction())
-			{
-				assert (false);
-				delete successor_state;
-//				std::cerr << "*";
-				continue;
-			}
+			// Note that if none of the helpful actions are applicable then the successor states are generated by all the actions, so 
+			// states which are not created by helpful actions are not pruned.
 			
 			/*
 			if (successor_state->getHeuristic() == std::numeric_limits<unsigned int>::max())
@@ -1902,9 +2605,19 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 */
 		}
 		
+		// A state without successors is not needed to extract a plan.
+		if (use_external_closed_list)
+		{
+			State::deleteUnusedStates(state, last_best_state_seen);
+		}
 		//state->deleteHelpfulActions();
 	}
 	
+	if (use_external_closed_list)
+	{
+		deleteExternalStates(queue, current_states_to_explore, NULL, last_best_state_seen);
+	}
+	
 	while (!queue.empty())
 	{
 		const State* state = queue.top();
@@ -1929,4 +2642,453 @@ std::pair<int, int> ForwardChainingPlanner::findPlan(std::vector<const GroundedA
 	return std::make_pair(-1, -1);
 }
 
+std::pair<int, int> ForwardChainingPlanner::findPlanWithGoalAgenda(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<std::vector<const Atom*> >& goal_agenda, const TermManager& term_manager, bool prune_unhelpful_actions, bool allow_restarts, bool allow_new_goals_to_be_added)
+{
+	std::vector<const Atom*> current_initial_facts(initial_facts);
+	std::vector<const Atom*> current_goal_facts;
+	std::vector<const Atom*> created_atoms;
+	int states_visited = 0;
+	bool plan_found = true;
+	
+	for (std::vector<std::vector<const Atom*> >::const_iterator ci = goal_agenda.begin(); ci != goal_agenda.end(); ++ci)
+	{
+		current_goal_facts.insert(current_goal_facts.end(), (*ci).begin(), (*ci).end());
+		std::cerr << "Goal agenda: " << current_goal_facts.size() << " goals." << std::endl;
+		
+		std::vector<const GroundedAction*> sub_plan;
+		std::pair<int, int> result = findPlan(sub_plan, current_initial_facts, current_goal_facts, term_manager, prune_unhelpful_actions, allow_restarts, allow_new_goals_to_be_added);
+		if (result.first == -1)
+		{
+			plan_found = false;
+			break;
+		}
+		states_visited += result.first;
+		plan.insert(plan.end(), sub_plan.begin(), sub_plan.end());
+		
+		if (ci + 1 == goal_agenda.end())
+		{
+			break;
+		}
+		
+		// The state reached by the sub plan is the initial state of the next search.
+		std::vector<const GroundedAtom*> facts;
+		GroundedAtom::getGroundedAtoms(facts, current_initial_facts);
+		std::sort(facts.begin(), facts.end(), GroundedAtomIdOrdering());
+		for (std::vector<const GroundedAction*>::const_iterator ci = sub_plan.begin(); ci != sub_plan.end(); ++ci)
+		{
+			(*ci)->applyTo(facts);
+		}
+		
+		current_initial_facts.clear();
+		for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+		{
+			const GroundedAtom* fact = *ci;
+			
+			// The atom takes ownership of the terms vector and deletes it, the objects in it are shared and must not be deleted.
+			std::vector<const Term*>* terms = new std::vector<const Term*>();
+			for (unsigned int i = 0; i < fact->getPredicate().getArity(); ++i)
+			{
+				terms->push_back(&fact->getObject(i));
+			}
+			Atom* atom = new Atom(fact->getPredicate(), *terms, false);
+			current_initial_facts.push_back(atom);
+			created_atoms.push_back(atom);
+		}
+	}
+	
+	for (std::vector<const Atom*>::const_iterator ci = created_atoms.begin(); ci != created_atoms.end(); ++ci)
+	{
+		delete *ci;
+	}
+	
+	if (!plan_found)
+	{
+		plan.clear();
+		return std::make_pair(-1, -1);
+	}
+	return std::make_pair(states_visited, plan.size());
+}
+
+bool ForwardChainingPlanner::addToClosedList(const State& state, boost::unordered_set<PackedState>& closed_list, const std::vector<const GroundedAtom*>& initial_facts) const
+{
+	PackedState key;
+	getStateKey(key, state, initial_facts);
+	return closed_list.insert(key).second;
+}
+
+std::pair<int, int> ForwardChainingPlanner::findPlanEHC(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, bool allow_new_goals_to_be_added)
+{
+	std::vector<const GroundedAtom*> grounded_initial_facts;
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
+	
+	std::vector<const GroundedAtom*> grounded_goal_facts;
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
+	
+	// All the grounded atoms that should never be removed.
+	std::vector<const GroundedAtom*> grounded_atoms_not_to_be_removed;
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_initial_facts.begin(), grounded_initial_facts.end());
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_goal_facts.begin(), grounded_goal_facts.end());
+	
+	// States are linked to their parents, so we keep all states alive until the search is over.
+	std::vector<State*> all_states;
+	
+	// Every state is evaluated once, when it is taken from the open list, and the helpful actions are always extracted. That 
+	// way the helpful actions held by the heuristic always belong to the state which is expanded next.
+	State* current_state = new State(true);
+	all_states.push_back(current_state);
+	heuristic_->setHeuristicForState(*current_state, grounded_initial_facts, grounded_goal_facts, term_manager, true, allow_new_goals_to_be_added);
+	GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+	
+	if (transposition_table_ != NULL)
+	{
+		transposition_table_->setGoals(grounded_goal_facts);
+	}
+	
+	unsigned int states_visited = 0;
+	bool use_helpful_actions = true;
+	
+	while (!current_state->isSuperSetOf(grounded_initial_facts, grounded_goal_facts))
+	{
+		if (current_state->getHeuristic() == std::numeric_limits<unsigned int>::max())
+		{
+			break;
+		}
+		
+		// Breadth first search from the current state until we find a state with a better heuristic value.
+		std::deque<State*> open_list;
+		boost::unordered_set<PackedState> closed_list;
+		open_list.push_back(current_state);
+		addToClosedList(*current_state, closed_list, grounded_initial_facts);
+		
+		State* improving_state = NULL;
+		while (!open_list.empty() && improving_state == NULL && !isCancelled())
+		{
+			State* state = open_list.front();
+			open_list.pop_front();
+			++states_visited;
+			
+			if (states_visited % 1000 == 0) std::cerr << "M" << "s=" << closed_list.size() << ";g=" << GroundedAction::numberOfGroundedActions() << "q=" << open_list.size();
+			else if (states_visited % 100 == 0) std::cerr << ".";
+			
+			// The root of the breadth first search has already been evaluated.
+			if (state != current_state)
+			{
+				std::vector<unsigned int> key;
+				unsigned int stored_heuristic = 0;
+				bool is_stored = false;
+				if (transposition_table_ != NULL)
+				{
+					std::vector<const GroundedAtom*> state_facts;
+					state->getFacts(grounded_initial_facts, state_facts);
+					TranspositionTable::getKey(key, state_facts, allow_new_goals_to_be_added);
+					is_stored = transposition_table_->getHeuristic(stored_heuristic, key);
+				}
+				
+				// The helpful actions are only needed if the state improves on the current state or is expanded using its 
+				// helpful actions, dead ends and other states known not to improve are not evaluated again.
+				if (is_stored && (stored_heuristic == std::numeric_limits<unsigned int>::max() || (stored_heuristic >= current_state->getHeuristic() && !use_helpful_actions)))
+				{
+					state->setDistanceToGoal(stored_heuristic);
+				}
+				else
+				{
+					heuristic_->setHeuristicForState(*state, grounded_initial_facts, grounded_goal_facts, term_manager, true, allow_new_goals_to_be_added);
+					GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+					
+					if (transposition_table_ != NULL && !is_stored)
+					{
+						transposition_table_->setHeuristic(key, state->getHeuristic());
+					}
+				}
+				
+				if (state->getHeuristic() == std::numeric_limits<unsigned int>::max())
+				{
+					continue;
+				}
+				
+				if (state->getHeuristic() < current_state->getHeuristic())
+				{
+					improving_state = state;
+					break;
+				}
+			}
+			
+			std::multimap<const Object*, const Object*> symmetrical_groups;
+			heuristic_->getFunctionalSymmetricSets(symmetrical_groups, *state, grounded_initial_facts, grounded_goal_facts, term_manager);
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			
+			std::vector<State*> successor_states;
+			StateStoreListener listener(successor_states);
+			state->getSuccessors(listener, symmetrical_groups, *action_manager_, *type_manager_, use_helpful_actions, grounded_initial_facts, heuristic_->getHelpfulActions());
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			
+			all_states.insert(all_states.end(), successor_states.begin(), successor_states.end());
+			for (std::vector<State*>::const_iterator ci = successor_states.begin(); ci != successor_states.end(); ++ci)
+			{
+				State* successor_state = *ci;
+				if (!addToClosedList(*successor_state, closed_list, grounded_initial_facts))
+				{
+					continue;
+				}
+				
+				open_list.push_back(successor_state);
+			}
+		}
+		
+		if (improving_state != NULL)
+		{
+			current_state = improving_state;
+			use_helpful_actions = true;
+			std::cerr << "\t" << current_state->getHeuristic() << " state = " << states_visited << "; Grounded Actions = " << GroundedAction::numberOfGroundedActions() << "; Grounded atoms: " << GroundedAtom::numberOfGroundedAtoms() << std::endl;
+		}
+		
+		// If the helpful actions did not lead to a better state, search again using all the successors.
+		else if (use_helpful_actions)
+		{
+			std::cerr << "\tNo better state found using the helpful actions, consider all successors." << std::endl;
+			use_helpful_actions = false;
+		}
+		else
+		{
+			break;
+		}
+	}
+	
+	std::pair<int, int> result(-1, -1);
+	if (current_state->isSuperSetOf(grounded_initial_facts, grounded_goal_facts))
+	{
+		const State* parent = current_state;
+		while (parent != NULL && parent->getAchievingAction() != NULL)
+		{
+			plan.insert(plan.begin(), parent->getAchievingAction());
+			parent = parent->getParent();
+		}
+		result = std::make_pair(states_visited, plan.size());
+	}
+	else
+	{
+		std::cerr << "Enforced hill climbing failed!" << std::endl;
+	}
+	
+	for (std::vector<State*>::const_iterator ci = all_states.begin(); ci != all_states.end(); ++ci)
+	{
+		delete *ci;
+	}
+	return result;
+}
+
+void ForwardChainingPlanner::getStateKey(PackedState& key, const State& state, const std::vector<const GroundedAtom*>& initial_facts) const
+{
+	std::vector<const GroundedAtom*> state_facts;
+	state.getFacts(initial_facts, state_facts);
+	if (state_packer_ != NULL)
+	{
+		state_packer_->pack(key, state_facts);
+		return;
+	}
+	
+	key.clear();
+	for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ++ci)
+	{
+		key.push_back((*ci)->getId());
+	}
+	std::sort(key.begin(), key.end());
+}
+
+namespace {
+
+// The number of bytes of the transposition table used by the anytime search if no table has been set.
+const std::size_t ANYTIME_TRANSPOSITION_TABLE_BUDGET = 64 * 1024 * 1024;
+
+/**
+ * A state in the open list of the weighted A* search.
+ */
+struct WeightedSearchNode
+{
+	WeightedSearchNode(State& state, double f)
+		: state_(&state), f_(f)
+	{
+		
+	}
+	
+	State* state_;
+	double f_;
+};
+
+/**
+ * Order the nodes by their f value, ties are broken in favour of the lowest heuristic value.
+ */
+struct CompareWeightedSearchNodes
+{
+	bool operator()(const WeightedSearchNode& lhs, const WeightedSearchNode& rhs) const
+	{
+		if (lhs.f_ != rhs.f_)
+		{
+			return lhs.f_ > rhs.f_;
+		}
+		return lhs.state_->getHeuristic() > rhs.state_->getHeuristic();
+	}
+};
+
+/**
+ * @return True if at least time_budget seconds have passed since start_time.
+ */
+bool isOutOfTime(const struct timeval& start_time, unsigned int time_budget)
+{
+	struct timeval current_time;
+	gettimeofday(&current_time, NULL);
+	long elapsed_time = (current_time.tv_sec - start_time.tv_sec) * 1000000L + (current_time.tv_usec - start_time.tv_usec);
+	return elapsed_time >= static_cast<long>(time_budget) * 1000000L;
+}
+
+};
+
+unsigned int ForwardChainingPlanner::improvePlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, unsigned int time_budget)
+{
+	struct timeval start_time;
+	gettimeofday(&start_time, NULL);
+	
+	std::vector<const GroundedAtom*> grounded_initial_facts;
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
+	
+	std::vector<const GroundedAtom*> grounded_goal_facts;
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
+	
+	// All the grounded atoms that should never be removed.
+	std::vector<const GroundedAtom*> grounded_atoms_not_to_be_removed;
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_initial_facts.begin(), grounded_initial_facts.end());
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), grounded_goal_facts.begin(), grounded_goal_facts.end());
+	
+	// Every search evaluates mostly the same states, so the heuristic values are always stored.
+	TranspositionTable anytime_transposition_table(ANYTIME_TRANSPOSITION_TABLE_BUDGET);
+	TranspositionTable* transposition_table = transposition_table_ != NULL ? transposition_table_ : &anytime_transposition_table;
+	transposition_table->setGoals(grounded_goal_facts);
+	
+	const double weights[] = { 5.0, 3.0, 2.0, 1.5, 1.0 };
+	unsigned int states_visited = 0;
+	bool out_of_time = false;
+	for (unsigned int weight_index = 0; weight_index < sizeof(weights) / sizeof(double) && !out_of_time && !isCancelled(); ++weight_index)
+	{
+		double weight = weights[weight_index];
+		std::cerr << "Anytime search: w = " << weight << "; best plan length = " << plan.size() << std::endl;
+		
+		// States are linked to their parents, so we keep all states alive until the search is over.
+		std::vector<State*> all_states;
+		std::priority_queue<WeightedSearchNode, std::vector<WeightedSearchNode>, CompareWeightedSearchNodes> open_list;
+		boost::unordered_map<PackedState, unsigned int> best_distances;
+		
+		State* initial_state = new State(true);
+		all_states.push_back(initial_state);
+		setHeuristicForState(*initial_state, *heuristic_, transposition_table, grounded_initial_facts, grounded_goal_facts, term_manager, false);
+		GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+		
+		PackedState initial_state_key;
+		getStateKey(initial_state_key, *initial_state, grounded_initial_facts);
+		best_distances[initial_state_key] = 0;
+		open_list.push(WeightedSearchNode(*initial_state, weight * initial_state->getHeuristic()));
+		
+		const State* goal_state = NULL;
+		while (!open_list.empty() && !isCancelled())
+		{
+			State* state = open_list.top().state_;
+			open_list.pop();
+			
+			// A state can be part of the open list multiple times, it is only expanded with its shortest distance.
+			PackedState state_key;
+			getStateKey(state_key, *state, grounded_initial_facts);
+			if (best_distances[state_key] < state->getDistanceFromStart())
+			{
+				continue;
+			}
+			
+			if (state->isSuperSetOf(grounded_initial_facts, grounded_goal_facts))
+			{
+				goal_state = state;
+				break;
+			}
+			
+			++states_visited;
+			
+			// Reading the clock is cheap compared to evaluating the successors, so the budget is checked for every state.
+			if (isOutOfTime(start_time, time_budget))
+			{
+				out_of_time = true;
+				break;
+			}
+			
+			heuristic_->deleteHelpfulActions();
+			std::multimap<const Object*, const Object*> symmetrical_groups;
+			heuristic_->getFunctionalSymmetricSets(symmetrical_groups, *state, grounded_initial_facts, grounded_goal_facts, term_manager);
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			
+			std::vector<State*> successor_states;
+			StateStoreListener listener(successor_states);
+			state->getSuccessors(listener, symmetrical_groups, *action_manager_, *type_manager_, false, grounded_initial_facts, heuristic_->getHelpfulActions());
+			all_states.insert(all_states.end(), successor_states.begin(), successor_states.end());
+			
+			for (std::vector<State*>::const_iterator ci = successor_states.begin(); ci != successor_states.end(); ++ci)
+			{
+				State* successor_state = *ci;
+				unsigned int distance = successor_state->getDistanceFromStart();
+				if (distance >= plan.size())
+				{
+					continue;
+				}
+				
+				PackedState successor_key;
+				getStateKey(successor_key, *successor_state, grounded_initial_facts);
+				boost::unordered_map<PackedState, unsigned int>::iterator distance_i = best_distances.find(successor_key);
+				if (distance_i != best_distances.end() && (*distance_i).second <= distance)
+				{
+					continue;
+				}
+				best_distances[successor_key] = distance;
+				
+				// A state can have many successors, so the budget is checked before each of them is evaluated as well.
+				if (isOutOfTime(start_time, time_budget))
+				{
+					out_of_time = true;
+					break;
+				}
+				
+				setHeuristicForState(*successor_state, *heuristic_, transposition_table, grounded_initial_facts, grounded_goal_facts, term_manager, false);
+				unsigned int heuristic = successor_state->getHeuristic();
+				if (heuristic == std::numeric_limits<unsigned int>::max() || distance + heuristic >= plan.size())
+				{
+					continue;
+				}
+				open_list.push(WeightedSearchNode(*successor_state, distance + weight * heuristic));
+			}
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			if (out_of_time)
+			{
+				break;
+			}
+		}
+		
+		if (goal_state != NULL)
+		{
+			plan.clear();
+			const State* parent = goal_state;
+			while (parent != NULL && parent->getAchievingAction() != NULL)
+			{
+				plan.insert(plan.begin(), parent->getAchievingAction());
+				parent = parent->getParent();
+			}
+			
+			std::cerr << "Improved plan found: " << plan.size() << " actions." << std::endl;
+			for (std::vector<const GroundedAction*>::const_iterator ci = plan.begin(); ci != plan.end(); ++ci)
+			{
+				std::cerr << **ci << std::endl;
+			}
+		}
+		
+		for (std::vector<State*>::const_iterator ci = all_states.begin(); ci != all_states.end(); ++ci)
+		{
+			delete *ci;
+		}
+	}
+	return states_visited;
+}
+
 };
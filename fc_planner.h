@@ -3,8 +3,15 @@
 
 #include <vector>
 #include <ostream>
+#include <map>
+#include <string>
+#include <csignal>
+#include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/dynamic_bitset.hpp>
 
 #include "heuristics/heuristic_interface.h"
+#include "state_packer.h"
 
 namespace MyPOP
 {
@@ -13,9 +20,11 @@ class ActionManager;
 class Atom;
 class Equality;
 class PredicateManager;
+class Term;
 class TypeManager;
 class Object;
 class Predicate;
+class TranspositionTable;
 
 /*namespace SAS_Plus
 {
@@ -69,7 +78,7 @@ public:
 class StateHeuristicListener : public NewStateReachedListener
 {
 public:
-	StateHeuristicListener(std::vector<State*>& found_states, const State& current_state, HEURISTICS::HeuristicInterface& heuristic, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added);
+	StateHeuristicListener(std::vector<State*>& found_states, const State& current_state, HEURISTICS::HeuristicInterface& heuristic, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added, TranspositionTable* transposition_table);
 
 	~StateHeuristicListener();
 	
@@ -84,6 +93,7 @@ private:
 	const std::vector<const GroundedAtom*>* goal_facts_;
 	const TermManager* term_manager_;
 	bool find_helpful_actions_, allow_new_goals_to_be_added_, found_better_state_;
+	TranspositionTable* transposition_table_;
 };
 
 /**
@@ -120,8 +130,38 @@ public:
 	/**
 	 * Apply the grounded action to a set of facts which constitute a state. We assume that all the preconditions
 	 * are satisfied already.
+	 * @param facts The facts of the state, ordered by their ids. The order is preserved.
 	 */
 	void applyTo(std::vector<const GroundedAtom*>& facts) const;
+	
+	/**
+	 * Ground the preconditions of this action, the equality constraints are checked by getViolatedEquality.
+	 * @param precondition_ids The ids of the grounded positive preconditions, ordered by id.
+	 * @param negative_precondition_ids The ids of the grounded negative preconditions, which must not be true, ordered by id.
+	 */
+	void getPreconditions(std::vector<unsigned int>& precondition_ids, std::vector<unsigned int>& negative_precondition_ids) const;
+	
+	/**
+	 * @return The index of an action variable which is assigned an object of a type incompatible with the type of the
+	 * variable, or std::numeric_limits<unsigned int>::max() if all the objects are of the right type.
+	 */
+	unsigned int getIllTypedVariable() const;
+	
+	/**
+	 * @return An equality constraint of the preconditions, (= ?x ?y) or (not (= ?x ?y)), which does not hold for the objects
+	 * assigned to this action or NULL if all of them hold.
+	 */
+	const Equality* getViolatedEquality() const;
+	
+	/**
+	 * @param add_effect_ids The ids of the grounded atoms added by this action, ordered by id.
+	 */
+	void getAddEffects(std::vector<unsigned int>& add_effect_ids) const;
+	
+	/**
+	 * @return The ids of the grounded atoms deleted by this action, ordered by id.
+	 */
+	const std::vector<unsigned int>& getDeleteEffects() const { return delete_effects_; }
 private:
 	
 	static std::vector<const GroundedAction*> instantiated_grounded_actions_;
@@ -129,9 +169,25 @@ private:
 	
 	~GroundedAction();
 	
+	/**
+	 * @return The object assigned to the term, which is either an action variable or a constant.
+	 */
+	const Object& getObject(const Term& term) const;
+	
+	/**
+	 * Ground the effect with the given index.
+	 */
+	const GroundedAtom& getEffect(unsigned int effect_index) const;
+	
 	const Action* action_;
 	const Object** variables_;
 	
+	// The ids of the grounded atoms added by this action ordered by id, paired with the index of the effect which adds them.
+	std::vector<std::pair<unsigned int, unsigned int> > add_effects_;
+	
+	// The ids of the grounded atoms deleted by this action ordered by id.
+	std::vector<unsigned int> delete_effects_;
+	
 	friend std::ostream& operator<<(std::ostream& os, const GroundedAction& grounded_action);
 };
 
@@ -145,13 +201,40 @@ class GroundedAtom
 public:
 	static void removeInstantiatedGroundedAtom();
 	static void removeInstantiatedGroundedAtom(const std::vector<const GroundedAtom*>& exceptions);
-	static const GroundedAtom& getGroundedAtom(const Predicate& predicate, const Object** variables);
+	/**
+	 * Get the grounded atom of the given predicate and objects, the objects are copied.
+	 */
+	static const GroundedAtom& getGroundedAtom(const Predicate& predicate, const Object* const* variables);
+	
+	/**
+	 * Ground the given facts, all terms of these facts must be objects.
+	 */
+	static void getGroundedAtoms(std::vector<const GroundedAtom*>& grounded_facts, const std::vector<const Atom*>& facts);
 	static void generateGroundedAtoms(std::vector<const GroundedAtom*>& grounded_objects, const PredicateManager& predicate_manager, const TermManager& term_manager);
 //	static const GroundedAtom& getGroundedAtom(const SAS_Plus::BoundedAtom& bounded_atom, const Bindings& bindings);
 	
 	static unsigned int numberOfGroundedAtoms();
 	
+	/**
+	 * Every grounded atom which has been instantiated gets a unique id, ids are assigned in the order the atoms are created and
+	 * do not change if an atom is removed and instantiated again.
+	 * @return The number of ids which have been handed out.
+	 */
+	static unsigned int numberOfGroundedAtomIds() { return grounded_atoms_by_id_.size(); }
+	
+	/**
+	 * @return The grounded atom with the given id, or NULL if it has been removed.
+	 */
+	static const GroundedAtom* getInstantiatedGroundedAtom(unsigned int id) { return grounded_atoms_by_id_[id]; }
+	
 	virtual ~GroundedAtom();
+	
+	unsigned int getId() const { return id_; }
+	
+	/**
+	 * The hash is based on the name of the predicate and the ids of the objects, so it is the same for every process.
+	 */
+	std::size_t getHash() const { return hash_; }
 
 	//const Atom& getAtom() const { return *atom_; }
 	const Predicate& getPredicate() const { return *predicate_; }
@@ -161,19 +244,105 @@ public:
 	bool operator!=(const GroundedAtom& rhs) const;
 	
 private:
-	GroundedAtom(const Predicate& predicate, const Object** variables);
+	GroundedAtom(const Predicate& predicate, const Object* const* variables, unsigned int id);
 //	GroundedAtom(const SAS_Plus::BoundedAtom& bounded_atom, const Bindings& bindings);
 	
 	static std::vector<const GroundedAtom*> instantiated_grounded_atoms_;
+	
+	/**
+	 * Identifies a grounded atom by the id of the name of its predicate and its objects. The keys stored in grounded_atom_ids_
+	 * refer to a copy of the objects in grounded_atom_objects_, while a key used for a lookup refers to the objects passed
+	 * to getGroundedAtom so no memory is allocated for it.
+	 */
+	struct GroundedAtomKey
+	{
+		GroundedAtomKey(unsigned int predicate_name_id, unsigned int arity, const Object* const* objects, unsigned int objects_offset)
+			: predicate_name_id_(predicate_name_id), arity_(arity), objects_(objects), objects_offset_(objects_offset)
+		{
+		
+		}
+		
+		const Object* getObject(unsigned int index) const { return objects_ != NULL ? objects_[index] : grounded_atom_objects_[objects_offset_ + index]; }
+		
+		unsigned int predicate_name_id_;
+		unsigned int arity_;
+		
+		// The objects of a key used for a lookup, or NULL if the objects are stored in grounded_atom_objects_.
+		const Object* const* objects_;
+		unsigned int objects_offset_;
+	};
+	
+	struct GroundedAtomKeyHash
+	{
+		std::size_t operator()(const GroundedAtomKey& key) const;
+	};
+	
+	struct GroundedAtomKeyEquals
+	{
+		bool operator()(const GroundedAtomKey& lhs, const GroundedAtomKey& rhs) const;
+	};
+	
+	/**
+	 * Predicates with different types can share the same name, grounded atoms of these predicates are equal if their objects 
+	 * are equal.
+	 * @return A unique id for the name of the predicate.
+	 */
+	static unsigned int getPredicateNameId(const Predicate& predicate);
+	
+	// The ids given to the grounded atoms, indexed by the name of the predicate and the objects.
+	static boost::unordered_map<GroundedAtomKey, unsigned int, GroundedAtomKeyHash, GroundedAtomKeyEquals> grounded_atom_ids_;
+	
+	// The objects of the keys in grounded_atom_ids_.
+	static std::vector<const Object*> grounded_atom_objects_;
+	
+	static boost::unordered_map<const Predicate*, unsigned int> predicate_name_ids_;
+	static std::map<std::string, unsigned int> predicate_names_;
+	
+	// The instantiated grounded atoms indexed by their id, removed grounded atoms are NULL.
+	static std::vector<const GroundedAtom*> grounded_atoms_by_id_;
 
+	// Grounded atoms with at most MAX_INLINE_TERMS terms store their objects inline, so they do not need a separate allocation.
+	static const unsigned int MAX_INLINE_TERMS = 4;
+	
 	const Predicate* predicate_;
+	const Object* inline_variables_[MAX_INLINE_TERMS];
 	const Object** variables_;
+	unsigned int id_;
+	std::size_t hash_;
 	
 	friend std::ostream& operator<<(std::ostream& os, const GroundedAtom& grounded_atom);
 };
 
 std::ostream& operator<<(std::ostream& os, const GroundedAtom& grounded_atom);
 
+/**
+ * The orbits of the objects in a state, objects which are symmetrical share the same orbit id. The orbit id of an object is 
+ * the smallest id of the objects it is symmetrical with, objects which are not symmetrical with any object are in an orbit of 
+ * their own.
+ */
+class ObjectOrbits
+{
+public:
+	ObjectOrbits(const std::multimap<const Object*, const Object*>& symmetrical_groups);
+	
+	unsigned int getOrbitId(const Object& object) const;
+	
+	/**
+	 * Project the assignments of the action variables onto their orbits. Two assignments with the same projection are 
+	 * symmetrical: for every variable the assigned objects are in the same orbit and the same variables are assigned the same
+	 * objects. Variables which are not assigned (NULL) are projected to the same value.
+	 */
+	void getProjection(std::vector<unsigned int>& projection, const Object* const* assigned_variables, unsigned int nr_variables) const;
+	
+private:
+	std::vector<unsigned int> orbit_ids_;
+};
+
+/**
+ * The projections onto the orbits of the assignments which have already been considered.
+ */
+typedef boost::unordered_set<std::vector<unsigned int> > OrbitProjectionSet;
+
 class State
 {
 public:
@@ -188,6 +357,11 @@ public:
 	
 	unsigned int getHeuristic() const { return /*distance_from_start_ + */distance_to_goal_; }
 	
+	/**
+	 * @return The number of actions executed to reach this state from the initial state.
+	 */
+	unsigned int getDistanceFromStart() const { return distance_from_start_; }
+	
 	//void getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const State*>& all_states) const;
 	//void getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const State*>& all_states, const TermManager& term_manager, const std::vector<const GroundedAtom*>& goals, const HEURISTICS::HeuristicInterface& heuristic) const;
 	void getSuccessors(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const ActionManager& action_manager, const TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const;
@@ -206,6 +380,11 @@ public:
 	//void deleteHelpfulActions();
 	
 	bool isEqualTo(const State& state, const std::vector<const GroundedAtom*>& initial_facts) const;
+	
+	/**
+	 * The hash of a state only depends on the facts which are true in it, not on the order in which they were achieved.
+	 */
+	std::size_t getHash(const std::vector<const GroundedAtom*>& initial_facts) const;
 	bool operator==(const State& state) const;
 	
 	/**
@@ -219,6 +398,27 @@ public:
 	const State* getParent() const { return parent_; }
 	const GroundedAction* getAchievingAction() const { return achieving_action_; }
 	
+	/**
+	 * @return The number of states created from this state which have not been deleted by deleteUnusedStates.
+	 */
+	unsigned int getNumberOfSuccessors() const { return nr_successors_; }
+	
+	/**
+	 * Delete the given state and every ancestor which has no other successors left, the ancestors are needed to extract the
+	 * plan so they can only be deleted once no state refers to them anymore.
+	 * @param state The state to delete.
+	 * @param state_to_keep A state which must not be deleted, even if it has no successors left.
+	 */
+	static void deleteUnusedStates(const State* state, const State* state_to_keep);
+	
+	/**
+	 * @return The landmarks which have been accepted on the path to this state, or NULL if they have not been stored. These
+	 * are stored by the landmark heuristic so the landmarks of a successor can be derived from those of its parent.
+	 */
+	const boost::dynamic_bitset<>* getAcceptedLandmarks() const { return accepted_landmarks_; }
+	
+	void setAcceptedLandmarks(const boost::dynamic_bitset<>& accepted_landmarks);
+	
 private:
 
 	const State* parent_;
@@ -237,13 +437,35 @@ private:
 	
 	bool created_by_helpful_action_;
 	
+	mutable unsigned int nr_successors_;
+	
+	boost::dynamic_bitset<>* accepted_landmarks_;
+	
 	//bool addFact(const GroundedAtom& fact, bool remove_fact);
 	//void removeFact(const GroundedAtom& fact);
 	
-	void instantiateAndExecuteAction(NewStateReachedListener& listener, const std::multimap<const Object*, const Object*>& symmetrical_groups, const MyPOP::Action& action, const std::vector< const MyPOP::Atom* >& preconditions, const std::vector< const MyPOP::Equality* >& equalities, unsigned int uninitialised_precondition_index, const MyPOP::Object** assigned_variables, const MyPOP::TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const;
+	/**
+	 * Find all the assignments to the action variables which satisfy the preconditions from the given index onwards and create
+	 * a successor state for each of them. Assignments which are symmetrical to an assignment we have already considered are
+	 * pruned.
+	 * @param tried_actions The projections of the grounded actions of this action which have already been applied.
+	 */
+	void instantiateAndExecuteAction(NewStateReachedListener& listener, const ObjectOrbits& orbits, OrbitProjectionSet& tried_actions, const MyPOP::Action& action, const std::vector< const MyPOP::Atom* >& preconditions, const std::vector< const MyPOP::Equality* >& equalities, unsigned int uninitialised_precondition_index, const MyPOP::Object** assigned_variables, const MyPOP::TypeManager& type_manager, bool prune_unhelpful_actions, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const;
 	
 	void createAllGroundedVariables(std::vector<const Object**>& all_grounded_action_variables, const Object** grounded_action_variables, const Action& action, const TypeManager& type_manager) const;
 	
+	/**
+	 * Ground the helpful actions using only the objects in their variable domains and create a successor state for every grounded
+	 * action whose preconditions are satisfied in this state.
+	 * @return The number of successor states which have been created.
+	 */
+	unsigned int instantiateHelpfulActions(NewStateReachedListener& listener, const ObjectOrbits& orbits, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > >& helpful_actions) const;
+	
+	/**
+	 * Like getFacts, but the facts are ordered by their ids.
+	 */
+	void getFactsOrderedById(const std::vector<const GroundedAtom*>& initial_facts, std::vector<const GroundedAtom*>& facts) const;
+	
 	//void checkSanity() const;
 	
 	friend std::ostream& operator<<(std::ostream& os, const State& state);
@@ -268,8 +490,70 @@ public:
 	
 	std::pair<int, int> findPlan(std::vector< const MyPOP::GroundedAction* >& plan, const std::vector< const MyPOP::Atom* >& initial_facts, const std::vector< const MyPOP::Atom* >& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions, bool allow_restarts, bool allow_new_goals_to_be_added);
 	
+	/**
+	 * Enforced hill climbing: from the best state found so far we perform a breadth first search until we find a state with a 
+	 * lower heuristic value. The breadth first search only considers the successors generated by the helpful actions, if no 
+	 * better state can be found this way we search again using all the successors.
+	 * @return The number of states visited and the length of the plan, or (-1, -1) if no plan could be found.
+	 */
+	std::pair<int, int> findPlanEHC(std::vector< const MyPOP::GroundedAction* >& plan, const std::vector< const MyPOP::Atom* >& initial_facts, const std::vector< const MyPOP::Atom* >& goal_facts, const TermManager& term_manager, bool allow_new_goals_to_be_added);
+	
+	/**
+	 * Search for shorter plans than the given plan until the time budget runs out, the search is restarted with decreasing 
+	 * weights (f = g + w * h) and states for which g + h is not smaller than the length of the best plan are pruned. The 
+	 * heuristic values are shared between the searches through the transposition table, every improved plan is printed as 
+	 * soon as it is found.
+	 * @param plan The best plan found so far, it is replaced by every improved plan.
+	 * @param time_budget The number of seconds we search for better plans.
+	 * @return The number of states visited.
+	 */
+	unsigned int improvePlan(std::vector< const MyPOP::GroundedAction* >& plan, const std::vector< const MyPOP::Atom* >& initial_facts, const std::vector< const MyPOP::Atom* >& goal_facts, const TermManager& term_manager, unsigned int time_budget);
+	
+	/**
+	 * Solve the goal subsets one after the other, every search starts from the state reached by the previous search and has to 
+	 * achieve the goals of all the subsets solved so far. The goals which have already been achieved are kept true by the 
+	 * heuristic, which treats the goals that are true in a state as persistent facts.
+	 * @param goal_agenda The goal subsets, in the order in which they are achieved.
+	 * @return The number of states visited by all searches and the length of the plan, or (-1, -1) if no plan could be found.
+	 */
+	std::pair<int, int> findPlanWithGoalAgenda(std::vector< const MyPOP::GroundedAction* >& plan, const std::vector< const MyPOP::Atom* >& initial_facts, const std::vector<std::vector< const MyPOP::Atom* > >& goal_agenda, const TermManager& term_manager, bool prune_unhelpful_actions, bool allow_restarts, bool allow_new_goals_to_be_added);
+	
+	/**
+	 * Set the seed used to break ties between states with the same heuristic value, using the same seed twice yields the 
+	 * same search.
+	 */
+	void setSeed(unsigned int seed) { seed_ = seed; }
+	
+	/**
+	 * Set a flag which is polled during the search, once it is set to a non zero value the search stops as if no plan could 
+	 * be found. The flag can be shared with other processes.
+	 */
+	void setCancelFlag(const volatile sig_atomic_t* cancel_flag) { cancel_flag_ = cancel_flag; }
+	
+	/**
+	 * Set the state packer used to detect duplicate states, if no state packer is set the facts of the states are compared.
+	 */
+	void setStatePacker(const StatePacker* state_packer) { state_packer_ = state_packer; }
+	
+	/**
+	 * Keep at most memory_budget bytes of the closed list of findPlan in memory, the rest is spilled to files in the given 
+	 * directory. A budget of 0 keeps the whole closed list in memory.
+	 */
+	void setExternalClosedList(std::size_t memory_budget, const std::string& directory) { external_memory_budget_ = memory_budget; external_directory_ = directory; }
+	
+	/**
+	 * Set the table in which the heuristic values of the successors are stored, the table is kept between restarts and 
+	 * between calls to findPlan and findPlanEHC.
+	 */
+	void setTranspositionTable(TranspositionTable* transposition_table) { transposition_table_ = transposition_table; }
+	
 private:
 	
+	/**
+	 * @return True if the search has been cancelled.
+	 */
+	bool isCancelled() const { return cancel_flag_ != NULL && *cancel_flag_ != 0; }
+	
 	//void setHeuristicForState(MyPOP::State& state, MyPOP::REACHABILITY::DTGReachability& analyst, const std::vector< const MyPOP::GroundedAtom* >& goal_facts, const std::vector< const MyPOP::REACHABILITY::ResolvedBoundedAtom* >& resolved_grounded_goal_facts, const MyPOP::Bindings& bindings) const;
 	//void setHeuristicForState(MyPOP::State& state, MyPOP::REACHABILITY::DTGReachability& analyst, const std::vector<const GroundedAtom*>& goal_facts, bool find_helpful_actions, bool allow_new_goals_to_be_added) const;
 	
@@ -280,11 +564,30 @@ private:
 	 */
 	bool satisfyGoal(const State& current_state, const std::vector<const GroundedAtom*>& goal_facts) const;
 	
+	/**
+	 * Add the key of the state, see getStateKey, to a closed list.
+	 * @return False if an equal state is already part of the closed list.
+	 */
+	bool addToClosedList(const State& state, boost::unordered_set<PackedState>& closed_list, const std::vector<const GroundedAtom*>& initial_facts) const;
+	
+	/**
+	 * Get a key which identifies the state, the packed state if a state packer has been set and the sorted ids of the facts 
+	 * otherwise.
+	 */
+	void getStateKey(PackedState& key, const State& state, const std::vector<const GroundedAtom*>& initial_facts) const;
+	
 	const ActionManager* action_manager_;
 	PredicateManager* predicate_manager_;
 	const TypeManager* type_manager_;
 	
 	HEURISTICS::HeuristicInterface* heuristic_;
+	
+	unsigned int seed_;
+	const volatile sig_atomic_t* cancel_flag_;
+	const StatePacker* state_packer_;
+	std::size_t external_memory_budget_;
+	std::string external_directory_;
+	TranspositionTable* transposition_table_;
 };
 
 };
@@ -0,0 +1,150 @@
+#include "goal_agenda.h"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+#include "formula.h"
+#include "term_manager.h"
+#include "sas/causal_graph.h"
+#include "sas/lifted_dtg.h"
+#include "heuristics/fact_set.h"
+
+//#define MYPOP_GOAL_AGENDA_COMMENTS
+
+namespace MyPOP {
+
+GoalAgenda::GoalAgenda(const SAS_Plus::CausalGraph& causal_graph, const PredicateManager& predicate_manager)
+	: causal_graph_(&causal_graph), predicate_manager_(&predicate_manager)
+{
+
+}
+
+void GoalAgenda::getGoalSubsets(std::vector<std::vector<const Atom*> >& goal_subsets, const std::vector<const Atom*>& goals) const
+{
+	// Find the lifted DTGs every goal is part of and all the lifted DTGs these depend on.
+	std::vector<std::set<const SAS_Plus::LiftedDTG*> > goal_dtgs(goals.size());
+	std::vector<std::set<const SAS_Plus::LiftedDTG*> > goal_dependencies(goals.size());
+	for (unsigned int i = 0; i < goals.size(); ++i)
+	{
+		const Atom* goal = goals[i];
+		std::vector<const HEURISTICS::VariableDomain*>* variable_domains = new std::vector<const HEURISTICS::VariableDomain*>();
+		for (unsigned int term_index = 0; term_index < goal->getArity(); ++term_index)
+		{
+			HEURISTICS::VariableDomain* variable_domain = new HEURISTICS::VariableDomain();
+			variable_domain->addObject(*static_cast<const Object*>(goal->getTerms()[term_index]));
+			variable_domains->push_back(variable_domain);
+		}
+		HEURISTICS::Fact goal_fact(*predicate_manager_, goal->getPredicate(), *variable_domains);
+
+		for (std::vector<SAS_Plus::LiftedDTG*>::const_iterator ci = causal_graph_->getAllLiftedDTGs().begin(); ci != causal_graph_->getAllLiftedDTGs().end(); ++ci)
+		{
+			const SAS_Plus::LiftedDTG* lifted_dtg = *ci;
+			std::vector<const SAS_Plus::MultiValuedValue*> found_nodes;
+			lifted_dtg->getNodes(found_nodes, goal_fact);
+			if (found_nodes.empty())
+			{
+				continue;
+			}
+
+			goal_dtgs[i].insert(lifted_dtg);
+			std::vector<const SAS_Plus::LiftedDTG*> dependencies;
+			causal_graph_->getAllDependencies(dependencies, *lifted_dtg);
+			goal_dependencies[i].insert(dependencies.begin(), dependencies.end());
+		}
+	}
+
+	// Goal i is achieved after goal j if j depends on i, but i does not depend on j.
+	std::vector<std::vector<unsigned int> > achieved_after(goals.size());
+	std::vector<unsigned int> nr_predecessors(goals.size(), 0);
+	for (unsigned int i = 0; i < goals.size(); ++i)
+	{
+		for (unsigned int j = 0; j < goals.size(); ++j)
+		{
+			if (i == j)
+			{
+				continue;
+			}
+
+			bool j_depends_on_i = false;
+			for (std::set<const SAS_Plus::LiftedDTG*>::const_iterator ci = goal_dtgs[i].begin(); ci != goal_dtgs[i].end(); ++ci)
+			{
+				if (goal_dependencies[j].count(*ci) != 0)
+				{
+					j_depends_on_i = true;
+					break;
+				}
+			}
+
+			bool i_depends_on_j = false;
+			for (std::set<const SAS_Plus::LiftedDTG*>::const_iterator ci = goal_dtgs[j].begin(); ci != goal_dtgs[j].end(); ++ci)
+			{
+				if (goal_dependencies[i].count(*ci) != 0)
+				{
+					i_depends_on_j = true;
+					break;
+				}
+			}
+
+			if (j_depends_on_i && !i_depends_on_j)
+			{
+				achieved_after[j].push_back(i);
+				++nr_predecessors[i];
+			}
+		}
+	}
+
+	// Every layer contains the goals whose predecessors have all been placed in an earlier layer.
+	std::vector<bool> is_placed(goals.size(), false);
+	unsigned int nr_placed_goals = 0;
+	while (nr_placed_goals < goals.size())
+	{
+		std::vector<unsigned int> layer;
+		for (unsigned int i = 0; i < goals.size(); ++i)
+		{
+			if (!is_placed[i] && nr_predecessors[i] == 0)
+			{
+				layer.push_back(i);
+			}
+		}
+
+		// The remaining goals are ordered cyclically, they are achieved together.
+		if (layer.empty())
+		{
+			for (unsigned int i = 0; i < goals.size(); ++i)
+			{
+				if (!is_placed[i])
+				{
+					layer.push_back(i);
+				}
+			}
+		}
+
+		goal_subsets.push_back(std::vector<const Atom*>());
+		for (std::vector<unsigned int>::const_iterator ci = layer.begin(); ci != layer.end(); ++ci)
+		{
+			unsigned int goal_index = *ci;
+			is_placed[goal_index] = true;
+			++nr_placed_goals;
+			goal_subsets.back().push_back(goals[goal_index]);
+
+			for (std::vector<unsigned int>::const_iterator ci = achieved_after[goal_index].begin(); ci != achieved_after[goal_index].end(); ++ci)
+			{
+				--nr_predecessors[*ci];
+			}
+		}
+	}
+
+#ifdef MYPOP_GOAL_AGENDA_COMMENTS
+	for (unsigned int i = 0; i < goal_subsets.size(); ++i)
+	{
+		std::cout << "Goal subset " << i << ":" << std::endl;
+		for (std::vector<const Atom*>::const_iterator ci = goal_subsets[i].begin(); ci != goal_subsets[i].end(); ++ci)
+		{
+			std::cout << "* " << **ci << std::endl;
+		}
+	}
+#endif
+}
+
+};
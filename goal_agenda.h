@@ -0,0 +1,41 @@
+#ifndef MYPOP_GOAL_AGENDA_H
+#define MYPOP_GOAL_AGENDA_H
+
+#include <vector>
+
+namespace MyPOP
+{
+class Atom;
+class PredicateManager;
+
+namespace SAS_Plus
+{
+class CausalGraph;
+};
+
+/**
+ * Splits the goals into an ordered list of subsets which are solved one after the other, every search starts from the state
+ * reached by the previous search and has to achieve the goals of all the subsets solved so far.
+ *
+ * The order is derived from the causal graph: a goal is achieved after another goal if the lifted DTG of the other goal
+ * depends on the lifted DTG of the goal, but not the other way around. For example, packages are delivered before the
+ * trucks are moved to their final location.
+ */
+class GoalAgenda
+{
+public:
+	GoalAgenda(const SAS_Plus::CausalGraph& causal_graph, const PredicateManager& predicate_manager);
+
+	/**
+	 * Split the goals into subsets, the goals of a subset have to be achieved before the goals of the next subset.
+	 */
+	void getGoalSubsets(std::vector<std::vector<const Atom*> >& goal_subsets, const std::vector<const Atom*>& goals) const;
+
+private:
+	const SAS_Plus::CausalGraph* causal_graph_;
+	const PredicateManager* predicate_manager_;
+};
+
+};
+
+#endif
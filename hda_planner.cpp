@@ -0,0 +1,549 @@
+#include "hda_planner.h"
+
+#include <queue>
+#include <limits>
+#include <iostream>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "action_manager.h"
+#include "term_manager.h"
+#include "fc_planner.h"
+#include "heuristics/heuristic_interface.h"
+
+//#define MYPOP_HDA_PLANNER_COMMENTS
+
+namespace MyPOP {
+
+const unsigned int MAX_HDA_WORKERS = 64;
+
+/**
+ * The status of all the workers, shared between all the processes. Every worker only writes to its own entries, the parent
+ * process uses these to detect when all workers are done.
+ */
+struct HDASharedStatus
+{
+	volatile sig_atomic_t terminate_;
+	volatile sig_atomic_t idle_[MAX_HDA_WORKERS];
+	volatile unsigned long messages_sent_[MAX_HDA_WORKERS];
+	volatile unsigned long messages_received_[MAX_HDA_WORKERS];
+	volatile unsigned long states_expanded_[MAX_HDA_WORKERS];
+};
+
+HashDistributedPlanner::HashDistributedPlanner(const ActionManager& action_manager, const TypeManager& type_manager, HEURISTICS::HeuristicInterface& heuristic, unsigned int nr_workers)
+	: action_manager_(&action_manager), type_manager_(&type_manager), heuristic_(&heuristic), nr_workers_(nr_workers), state_packer_(NULL)
+{
+	if (nr_workers_ == 0)
+	{
+		nr_workers_ = 1;
+	}
+	else if (nr_workers_ > MAX_HDA_WORKERS)
+	{
+		nr_workers_ = MAX_HDA_WORKERS;
+	}
+}
+
+HashDistributedPlanner::~HashDistributedPlanner()
+{
+
+}
+
+std::pair<int, int> HashDistributedPlanner::findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions)
+{
+	std::vector<const GroundedAtom*> grounded_initial_facts;
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
+
+	std::vector<const GroundedAtom*> grounded_goal_facts;
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
+
+	HDASharedStatus* status = static_cast<HDASharedStatus*>(mmap(NULL, sizeof(HDASharedStatus), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+	if (status == MAP_FAILED)
+	{
+		std::cerr << "Could not allocate the shared memory for the workers: " << strerror(errno) << std::endl;
+		return std::make_pair(-1, -1);
+	}
+	memset(status, 0, sizeof(HDASharedStatus));
+
+	// Create a pipe for every pair of workers and a pipe for every worker to send its plan to this process.
+	std::vector<std::vector<int> > read_fds(nr_workers_, std::vector<int>(nr_workers_, -1));
+	std::vector<std::vector<int> > write_fds(nr_workers_, std::vector<int>(nr_workers_, -1));
+	std::vector<int> result_read_fds(nr_workers_, -1);
+	std::vector<int> result_write_fds(nr_workers_, -1);
+	for (unsigned int sender = 0; sender < nr_workers_; ++sender)
+	{
+		for (unsigned int receiver = 0; receiver < nr_workers_; ++receiver)
+		{
+			if (sender == receiver) continue;
+			int fds[2];
+			if (pipe(fds) != 0)
+			{
+				std::cerr << "Could not create the pipes for the workers: " << strerror(errno) << std::endl;
+				exit(1);
+			}
+			fcntl(fds[0], F_SETFL, O_NONBLOCK);
+			fcntl(fds[1], F_SETFL, O_NONBLOCK);
+			read_fds[sender][receiver] = fds[0];
+			write_fds[sender][receiver] = fds[1];
+		}
+
+		int fds[2];
+		if (pipe(fds) != 0)
+		{
+			std::cerr << "Could not create the pipes for the workers: " << strerror(errno) << std::endl;
+			exit(1);
+		}
+		result_read_fds[sender] = fds[0];
+		result_write_fds[sender] = fds[1];
+	}
+
+	std::cout.flush();
+	std::cerr.flush();
+
+	std::vector<pid_t> workers;
+	for (unsigned int worker_id = 0; worker_id < nr_workers_; ++worker_id)
+	{
+		pid_t pid = fork();
+		if (pid == -1)
+		{
+			std::cerr << "Could not start worker " << worker_id << ": " << strerror(errno) << std::endl;
+			status->terminate_ = 1;
+			break;
+		}
+
+		if (pid == 0)
+		{
+			// Other workers can stop at any time, we detect this through failed writes.
+			signal(SIGPIPE, SIG_IGN);
+			
+			std::vector<int> inbound_fds(nr_workers_, -1);
+			std::vector<int> outbound_fds(nr_workers_, -1);
+			for (unsigned int sender = 0; sender < nr_workers_; ++sender)
+			{
+				for (unsigned int receiver = 0; receiver < nr_workers_; ++receiver)
+				{
+					if (sender == receiver) continue;
+					if (receiver == worker_id) inbound_fds[sender] = read_fds[sender][receiver];
+					else close(read_fds[sender][receiver]);
+					if (sender == worker_id) outbound_fds[receiver] = write_fds[sender][receiver];
+					else close(write_fds[sender][receiver]);
+				}
+				close(result_read_fds[sender]);
+				if (sender != worker_id) close(result_write_fds[sender]);
+			}
+
+			runWorker(worker_id, inbound_fds, outbound_fds, result_write_fds[worker_id], *status, grounded_initial_facts, grounded_goal_facts, term_manager, prune_unhelpful_actions);
+			close(result_write_fds[worker_id]);
+			_exit(0);
+		}
+		workers.push_back(pid);
+	}
+
+	for (unsigned int sender = 0; sender < nr_workers_; ++sender)
+	{
+		for (unsigned int receiver = 0; receiver < nr_workers_; ++receiver)
+		{
+			if (sender == receiver) continue;
+			close(read_fds[sender][receiver]);
+			close(write_fds[sender][receiver]);
+		}
+		close(result_write_fds[sender]);
+	}
+
+	// Wait for a plan or until all workers are idle and no states are underway.
+	std::vector<struct pollfd> result_poll_fds;
+	for (unsigned int worker_id = 0; worker_id < workers.size(); ++worker_id)
+	{
+		struct pollfd poll_fd;
+		poll_fd.fd = result_read_fds[worker_id];
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		result_poll_fds.push_back(poll_fd);
+	}
+
+	std::vector<unsigned int> plan_message;
+	bool found_plan = false;
+	bool last_check_was_idle = false;
+	unsigned long last_messages_sent = 0;
+	unsigned int workers_alive = workers.size();
+	while (!found_plan && workers_alive > 0 && status->terminate_ == 0)
+	{
+		poll(&result_poll_fds[0], result_poll_fds.size(), 50);
+
+		for (unsigned int worker_id = 0; worker_id < result_poll_fds.size() && !found_plan; ++worker_id)
+		{
+			struct pollfd& poll_fd = result_poll_fds[worker_id];
+			if (poll_fd.fd == -1 || (poll_fd.revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+			{
+				continue;
+			}
+
+			// A worker only writes to its result pipe once it found a plan, read until the worker closes the pipe.
+			std::vector<char> buffer;
+			char read_buffer[4096];
+			ssize_t bytes_read;
+			while ((bytes_read = read(poll_fd.fd, read_buffer, sizeof(read_buffer))) != 0)
+			{
+				if (bytes_read == -1)
+				{
+					if (errno == EINTR) continue;
+					break;
+				}
+				buffer.insert(buffer.end(), read_buffer, read_buffer + bytes_read);
+			}
+			close(poll_fd.fd);
+			poll_fd.fd = -1;
+			--workers_alive;
+
+			if (buffer.size() >= sizeof(unsigned int))
+			{
+				plan_message.resize(buffer.size() / sizeof(unsigned int));
+				memcpy(&plan_message[0], &buffer[0], plan_message.size() * sizeof(unsigned int));
+				if (plan_message[0] == plan_message.size())
+				{
+					found_plan = true;
+				}
+			}
+		}
+
+		// All the workers are done if they are all idle and all the messages sent have been received. To make sure we
+		// do not miss a message which is being processed we need to observe the same state twice.
+		bool all_idle = true;
+		unsigned long messages_sent = 0;
+		unsigned long messages_received = 0;
+		for (unsigned int worker_id = 0; worker_id < workers.size(); ++worker_id)
+		{
+			if (status->idle_[worker_id] == 0)
+			{
+				all_idle = false;
+			}
+			messages_sent += status->messages_sent_[worker_id];
+			messages_received += status->messages_received_[worker_id];
+		}
+
+		if (all_idle && messages_sent == messages_received)
+		{
+			if (last_check_was_idle && last_messages_sent == messages_sent)
+			{
+				break;
+			}
+			last_check_was_idle = true;
+			last_messages_sent = messages_sent;
+		}
+		else
+		{
+			last_check_was_idle = false;
+		}
+	}
+
+	status->terminate_ = 1;
+	for (std::vector<pid_t>::const_iterator ci = workers.begin(); ci != workers.end(); ++ci)
+	{
+		waitpid(*ci, NULL, 0);
+	}
+	for (std::vector<struct pollfd>::const_iterator ci = result_poll_fds.begin(); ci != result_poll_fds.end(); ++ci)
+	{
+		if ((*ci).fd != -1) close((*ci).fd);
+	}
+
+	unsigned long states_visited = 0;
+	for (unsigned int worker_id = 0; worker_id < workers.size(); ++worker_id)
+	{
+		states_visited += status->states_expanded_[worker_id];
+	}
+	munmap(status, sizeof(HDASharedStatus));
+
+	if (!found_plan)
+	{
+		std::cerr << "No plan found by the workers!" << std::endl;
+		return std::make_pair(-1, -1);
+	}
+
+	deserialisePlan(plan, &plan_message[0], term_manager);
+	return std::make_pair(states_visited, plan.size());
+}
+
+void HashDistributedPlanner::runWorker(unsigned int worker_id, const std::vector<int>& inbound_fds, const std::vector<int>& outbound_fds, int result_fd, HDASharedStatus& status, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions) const
+{
+	// All the grounded atoms that should never be removed.
+	std::vector<const GroundedAtom*> grounded_atoms_not_to_be_removed(initial_facts);
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), goal_facts.begin(), goal_facts.end());
+
+	// States are linked to their parents, the states received from other workers share their common prefixes.
+	State* initial_state = new State(true);
+	std::map<std::pair<const State*, const GroundedAction*>, State*> received_states;
+
+	// All states that have been added to the open list, indexed by their hash. If a state packer has been set only the
+	// packed states are stored.
+	std::map<std::size_t, std::vector<const State*> > seen_states;
+	boost::unordered_set<PackedState> packed_seen_states;
+	std::priority_queue<State*, std::vector<State*>, CompareStates> open_list;
+
+	std::vector<std::vector<char> > inbound_buffers(nr_workers_);
+	std::vector<std::vector<char> > outbound_buffers(nr_workers_);
+
+	std::vector<struct pollfd> inbound_poll_fds;
+	for (unsigned int sender = 0; sender < nr_workers_; ++sender)
+	{
+		if (sender == worker_id) continue;
+		struct pollfd poll_fd;
+		poll_fd.fd = inbound_fds[sender];
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		inbound_poll_fds.push_back(poll_fd);
+	}
+
+	// The states we own which still need to be evaluated, paired with a flag which tells us whether the state can be deleted
+	// if we have seen it before. States received from other workers can be the parent of other received states.
+	std::vector<std::pair<State*, bool> > new_states;
+	if (initial_state->getHash(initial_facts) % nr_workers_ == worker_id)
+	{
+		new_states.push_back(std::make_pair(initial_state, false));
+	}
+
+	std::multimap<const Object*, const Object*> symmetrical_groups;
+	while (status.terminate_ == 0)
+	{
+		// Read the states sent by the other workers.
+		for (unsigned int sender = 0; sender < nr_workers_; ++sender)
+		{
+			if (sender == worker_id) continue;
+			std::vector<char>& buffer = inbound_buffers[sender];
+			char read_buffer[65536];
+			ssize_t bytes_read;
+			while ((bytes_read = read(inbound_fds[sender], read_buffer, sizeof(read_buffer))) > 0)
+			{
+				buffer.insert(buffer.end(), read_buffer, read_buffer + bytes_read);
+			}
+
+			std::size_t offset = 0;
+			while (buffer.size() - offset >= sizeof(unsigned int))
+			{
+				unsigned int message_size;
+				memcpy(&message_size, &buffer[offset], sizeof(unsigned int));
+				if (buffer.size() - offset < message_size * sizeof(unsigned int))
+				{
+					break;
+				}
+
+				std::vector<unsigned int> message(message_size);
+				memcpy(&message[0], &buffer[offset], message_size * sizeof(unsigned int));
+				offset += message_size * sizeof(unsigned int);
+
+				// Reconstruct the state by following the actions from the initial state.
+				std::vector<const GroundedAction*> path;
+				deserialisePlan(path, &message[0], term_manager);
+				State* state = initial_state;
+				for (std::vector<const GroundedAction*>::const_iterator ci = path.begin(); ci != path.end(); ++ci)
+				{
+					std::map<std::pair<const State*, const GroundedAction*>, State*>::const_iterator state_ci = received_states.find(std::make_pair(state, *ci));
+					if (state_ci != received_states.end())
+					{
+						state = (*state_ci).second;
+					}
+					else
+					{
+						State* child_state = new State(*state, **ci, true);
+						received_states[std::make_pair(state, *ci)] = child_state;
+						state = child_state;
+					}
+				}
+
+				status.idle_[worker_id] = 0;
+				new_states.push_back(std::make_pair(state, false));
+				++status.messages_received_[worker_id];
+			}
+			buffer.erase(buffer.begin(), buffer.begin() + offset);
+		}
+
+		// Evaluate the states we own and add them to the open list, unless we have seen them before.
+		for (std::vector<std::pair<State*, bool> >::const_iterator ci = new_states.begin(); ci != new_states.end(); ++ci)
+		{
+			State* state = (*ci).first;
+			bool can_be_deleted = (*ci).second;
+			bool already_seen = false;
+			if (state_packer_ != NULL)
+			{
+				std::vector<const GroundedAtom*> state_facts;
+				state->getFacts(initial_facts, state_facts);
+
+				PackedState packed_state;
+				state_packer_->pack(packed_state, state_facts);
+				already_seen = !packed_seen_states.insert(packed_state).second;
+			}
+			else
+			{
+				std::vector<const State*>& states_with_same_hash = seen_states[state->getHash(initial_facts)];
+				for (std::vector<const State*>::const_iterator ci = states_with_same_hash.begin(); ci != states_with_same_hash.end(); ++ci)
+				{
+					if (state->isEqualTo(**ci, initial_facts))
+					{
+						already_seen = true;
+						break;
+					}
+				}
+
+				if (!already_seen)
+				{
+					states_with_same_hash.push_back(state);
+				}
+			}
+
+			if (already_seen)
+			{
+				if (can_be_deleted)
+				{
+					delete state;
+				}
+				continue;
+			}
+
+			heuristic_->setHeuristicForState(*state, initial_facts, goal_facts, term_manager, false, false);
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			if (state->getHeuristic() != std::numeric_limits<unsigned int>::max())
+			{
+				open_list.push(state);
+			}
+		}
+		new_states.clear();
+
+		// Send the states owned by other workers.
+		bool all_messages_sent = true;
+		for (unsigned int receiver = 0; receiver < nr_workers_; ++receiver)
+		{
+			std::vector<char>& buffer = outbound_buffers[receiver];
+			if (buffer.empty()) continue;
+			ssize_t bytes_written = write(outbound_fds[receiver], &buffer[0], buffer.size());
+			if (bytes_written > 0)
+			{
+				buffer.erase(buffer.begin(), buffer.begin() + bytes_written);
+			}
+			if (!buffer.empty())
+			{
+				all_messages_sent = false;
+			}
+		}
+
+		if (open_list.empty())
+		{
+			if (all_messages_sent)
+			{
+				status.idle_[worker_id] = 1;
+			}
+			poll(inbound_poll_fds.empty() ? NULL : &inbound_poll_fds[0], inbound_poll_fds.size(), 10);
+			continue;
+		}
+		status.idle_[worker_id] = 0;
+
+		State* state = open_list.top();
+		open_list.pop();
+		++status.states_expanded_[worker_id];
+
+		if (state->isSuperSetOf(initial_facts, goal_facts))
+		{
+#ifdef MYPOP_HDA_PLANNER_COMMENTS
+			std::cout << "Worker " << worker_id << " found a goal state!" << std::endl;
+#endif
+			std::vector<unsigned int> message;
+			serialiseState(message, *state);
+			const char* data = reinterpret_cast<const char*>(&message[0]);
+			std::size_t bytes_left = message.size() * sizeof(unsigned int);
+			while (bytes_left > 0)
+			{
+				ssize_t bytes_written = write(result_fd, data, bytes_left);
+				if (bytes_written == -1)
+				{
+					if (errno == EINTR) continue;
+					break;
+				}
+				data += bytes_written;
+				bytes_left -= bytes_written;
+			}
+			return;
+		}
+
+		if (prune_unhelpful_actions)
+		{
+			heuristic_->setHeuristicForState(*state, initial_facts, goal_facts, term_manager, true, false);
+		}
+		else
+		{
+			heuristic_->deleteHelpfulActions();
+		}
+
+		symmetrical_groups.clear();
+		heuristic_->getFunctionalSymmetricSets(symmetrical_groups, *state, initial_facts, goal_facts, term_manager);
+		GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+
+		std::vector<State*> successor_states;
+		StateStoreListener listener(successor_states);
+		state->getSuccessors(listener, symmetrical_groups, *action_manager_, *type_manager_, prune_unhelpful_actions, initial_facts, heuristic_->getHelpfulActions());
+
+		for (std::vector<State*>::const_iterator ci = successor_states.begin(); ci != successor_states.end(); ++ci)
+		{
+			State* successor_state = *ci;
+			unsigned int owner = successor_state->getHash(initial_facts) % nr_workers_;
+			if (owner == worker_id)
+			{
+				new_states.push_back(std::make_pair(successor_state, true));
+				continue;
+			}
+
+			std::vector<unsigned int> message;
+			serialiseState(message, *successor_state);
+			std::vector<char>& buffer = outbound_buffers[owner];
+			const char* data = reinterpret_cast<const char*>(&message[0]);
+			buffer.insert(buffer.end(), data, data + message.size() * sizeof(unsigned int));
+			++status.messages_sent_[worker_id];
+			delete successor_state;
+		}
+	}
+}
+
+void HashDistributedPlanner::serialiseState(std::vector<unsigned int>& message, const State& state) const
+{
+	std::vector<const GroundedAction*> path;
+	const State* parent = &state;
+	while (parent != NULL && parent->getAchievingAction() != NULL)
+	{
+		path.insert(path.begin(), parent->getAchievingAction());
+		parent = parent->getParent();
+	}
+
+	message.push_back(0);
+	message.push_back(path.size());
+	for (std::vector<const GroundedAction*>::const_iterator ci = path.begin(); ci != path.end(); ++ci)
+	{
+		const GroundedAction* grounded_action = *ci;
+		message.push_back(grounded_action->getAction().getId());
+		for (unsigned int i = 0; i < grounded_action->getAction().getVariables().size(); ++i)
+		{
+			message.push_back(grounded_action->getVariablesAssignment(i).getId());
+		}
+	}
+	message[0] = message.size();
+}
+
+void HashDistributedPlanner::deserialisePlan(std::vector<const GroundedAction*>& plan, const unsigned int* message, const TermManager& term_manager) const
+{
+	unsigned int index = 2;
+	for (unsigned int i = 0; i < message[1]; ++i)
+	{
+		const Action& action = action_manager_->getManagableObject(message[index++]);
+		const Object* variables[action.getVariables().size()];
+		for (unsigned int j = 0; j < action.getVariables().size(); ++j)
+		{
+			variables[j] = static_cast<const Object*>(&term_manager.getManagableObject(message[index++]));
+		}
+		plan.push_back(&GroundedAction::getGroundedAction(action, variables));
+	}
+	assert (index == message[0]);
+}
+
+};
@@ -0,0 +1,84 @@
+#ifndef MYPOP_HDA_PLANNER
+#define MYPOP_HDA_PLANNER
+
+#include <vector>
+#include <map>
+
+#include "state_packer.h"
+
+namespace MyPOP
+{
+class ActionManager;
+class Atom;
+class GroundedAction;
+class GroundedAtom;
+class State;
+class TermManager;
+class TypeManager;
+
+namespace HEURISTICS
+{
+class HeuristicInterface;
+};
+
+struct HDASharedStatus;
+
+/**
+ * Hash distributed greedy best first search (HDA*). The state space is partitioned over a number of workers based on the hash
+ * of the states. Every worker has its own open list, closed list and heuristic and only expands the states it owns, the
+ * successors owned by other workers are sent to them.
+ *
+ * The grounded atoms, grounded actions and the data structures of the heuristics are global and not thread safe, so every
+ * worker is a separate process. Workers communicate through pipes and a small block of shared memory, which is also used to
+ * detect when all workers have run out of states. States are sent as the sequence of actions which reach them from the
+ * initial state, so every worker can reconstruct the plan of the states it owns.
+ */
+class HashDistributedPlanner
+{
+public:
+	HashDistributedPlanner(const ActionManager& action_manager, const TypeManager& type_manager, HEURISTICS::HeuristicInterface& heuristic, unsigned int nr_workers);
+
+	virtual ~HashDistributedPlanner();
+
+	/**
+	 * Find a plan using nr_workers worker processes.
+	 * @return The number of states visited by all workers and the length of the plan, or (-1, -1) if no plan could be found.
+	 */
+	std::pair<int, int> findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions);
+
+	/**
+	 * Set the state packer used to detect duplicate states, if no state packer is set the facts of the states are compared.
+	 */
+	void setStatePacker(const StatePacker* state_packer) { state_packer_ = state_packer; }
+
+private:
+
+	/**
+	 * The search performed by a single worker, this method is called in the worker's process.
+	 * @param inbound_fds The pipes from which the worker receives states from other workers, indexed by the sending worker.
+	 * @param outbound_fds The pipes through which the worker sends states to the other workers, indexed by the receiving worker.
+	 * @param result_fd The pipe through which the plan is sent to the parent process.
+	 */
+	void runWorker(unsigned int worker_id, const std::vector<int>& inbound_fds, const std::vector<int>& outbound_fds, int result_fd, HDASharedStatus& status, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool prune_unhelpful_actions) const;
+
+	/**
+	 * Encode the state as the number of words of the message, followed by the number of actions that reach the state and the
+	 * id of every action followed by the ids of the objects assigned to its variables.
+	 */
+	void serialiseState(std::vector<unsigned int>& message, const State& state) const;
+
+	/**
+	 * Decode the actions from the given message.
+	 */
+	void deserialisePlan(std::vector<const GroundedAction*>& plan, const unsigned int* message, const TermManager& term_manager) const;
+
+	const ActionManager* action_manager_;
+	const TypeManager* type_manager_;
+	HEURISTICS::HeuristicInterface* heuristic_;
+	unsigned int nr_workers_;
+	const StatePacker* state_packer_;
+};
+
+};
+
+#endif
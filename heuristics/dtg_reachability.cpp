@@ -1,5 +1,6 @@
 #include <cstring>
 #include <iterator>
+#include <limits>
 #include <sys/time.h>
 #include <boost/bind.hpp>
 #include <queue>
@@ -15,6 +16,8 @@
 #include "term_manager.h"
 #include <fc_planner.h>
 #include "heuristics/fact_set.h"
+#include "parser_utils.h"
+#include "VALfiles/TIM.h"
 
 //#define MYPOP_SAS_PLUS_DTG_REACHABILITY_COMMENT
 //#define MYPOP_SAS_PLUS_DTG_REACHABILITY_PERFORM_REACHABILITY_COMMENT
@@ -76,7 +79,7 @@ std::vector<ReachableFact*> ReachableFact::all_created_reachable_facts_;
 	return *reachable_fact;
 }*/
 	
-ReachableFact& ReachableFact::createReachableFact(const Predicate& predicate, std::vector<EquivalentObjectGroup*>& term_domain_mapping, bool allow_reuse)
+ReachableFact& ReachableFact::createReachableFact(const Predicate& predicate, const std::vector<EquivalentObjectGroup*>& term_domain_mapping, bool allow_reuse)
 {
 	if (allow_reuse)
 	{
@@ -212,10 +215,14 @@ void ReachableFact::deleteAllReachableFacts()
 	assert (term_domain_mapping_->size() == bounded_atom.getAtom().getArity());
 }*/
 
-ReachableFact::ReachableFact(const Predicate& predicate, std::vector<EquivalentObjectGroup*>& term_domain_mapping)
-	: predicate_(&predicate), term_domain_mapping_(&term_domain_mapping), replaced_by_(NULL)
+ReachableFact::ReachableFact(const Predicate& predicate, const std::vector<EquivalentObjectGroup*>& term_domain_mapping)
+	: predicate_(&predicate), term_domain_mapping_(predicate.getArity() <= MAX_INLINE_TERMS ? inline_term_domains_ : new EquivalentObjectGroup*[predicate.getArity()]), replaced_by_(NULL)
 {
 	assert (term_domain_mapping.size() == predicate.getArity());
+	for (unsigned int i = 0; i < predicate.getArity(); i++)
+	{
+		term_domain_mapping_[i] = term_domain_mapping[i];
+	}
 }
 /*
 ReachableFact::ReachableFact(const Atom& atom, EquivalentObjectGroup** term_domain_mapping)
@@ -232,34 +239,29 @@ ReachableFact::ReachableFact(const Atom& atom, EquivalentObjectGroup** term_doma
 }
 */
 ReachableFact::ReachableFact(const GroundedAtom& grounded_atom, const EquivalentObjectGroupManager& eog_manager)
-	: predicate_(&grounded_atom.getPredicate()), replaced_by_(NULL)
+	: predicate_(&grounded_atom.getPredicate()), term_domain_mapping_(grounded_atom.getPredicate().getArity() <= MAX_INLINE_TERMS ? inline_term_domains_ : new EquivalentObjectGroup*[grounded_atom.getPredicate().getArity()]), replaced_by_(NULL)
 {
-//	term_domain_mapping_ = EquivalentObjectGroup::allocateMemory(grounded_atom.getAtom().getArity());
-	term_domain_mapping_ = new std::vector<EquivalentObjectGroup*>(grounded_atom.getPredicate().getArity());
 	for (unsigned int i = 0; i < grounded_atom.getPredicate().getArity(); i++)
 	{
-//		term_domain_mapping_[i] = &eog_manager.getEquivalentObject(grounded_atom.getObject(i)).getEquivalentObjectGroup();
-		(*term_domain_mapping_)[i] = &eog_manager.getEquivalentObject(grounded_atom.getObject(i)).getEquivalentObjectGroup();
-		//term_domain_mapping_.push_back(&eog_manager.getEquivalentObject(grounded_atom.getObject(i)).getEquivalentObjectGroup());
+		term_domain_mapping_[i] = &eog_manager.getEquivalentObject(grounded_atom.getObject(i)).getEquivalentObjectGroup();
 	}
 }
 
 ReachableFact::ReachableFact(const ReachableFact& reachable_fact)
-	: predicate_(&reachable_fact.getPredicate()), replaced_by_(NULL)
+	: predicate_(&reachable_fact.getPredicate()), term_domain_mapping_(reachable_fact.predicate_->getArity() <= MAX_INLINE_TERMS ? inline_term_domains_ : new EquivalentObjectGroup*[reachable_fact.predicate_->getArity()]), replaced_by_(NULL)
 {
-//	term_domain_mapping_ = EquivalentObjectGroup::allocateMemory(reachable_fact.atom_->getArity());
-	term_domain_mapping_ = new std::vector<EquivalentObjectGroup*>(reachable_fact.predicate_->getArity());
 	for (unsigned int i = 0; i < reachable_fact.predicate_->getArity(); i++)
 	{
-//		term_domain_mapping_[i] = reachable_fact.term_domain_mapping_[i];
-		(*term_domain_mapping_)[i] = (*reachable_fact.term_domain_mapping_)[i];
-		//term_domain_mapping_.push_back(reachable_fact.term_domain_mapping_[i]);
+		term_domain_mapping_[i] = reachable_fact.term_domain_mapping_[i];
 	}
 }
 
 ReachableFact::~ReachableFact()
 {
-	delete term_domain_mapping_;
+	if (term_domain_mapping_ != inline_term_domains_)
+	{
+		delete[] term_domain_mapping_;
+	}
 }
 
 /*void* ReachableFact::operator new (size_t size)
@@ -277,10 +279,10 @@ bool ReachableFact::updateTermsToRoot()
 	bool updated_domain = false;
 	for (unsigned int i = 0; i < predicate_->getArity(); i++)
 	{
-		EquivalentObjectGroup& root_node = (*term_domain_mapping_)[i]->getRootNode();
-		if (&root_node != (*term_domain_mapping_)[i])
+		EquivalentObjectGroup& root_node = term_domain_mapping_[i]->getRootNode();
+		if (&root_node != term_domain_mapping_[i])
 		{
-			(*term_domain_mapping_)[i] = &root_node;
+			term_domain_mapping_[i] = &root_node;
 			updated_domain = true;
 		}
 	}
@@ -304,18 +306,18 @@ bool ReachableFact::isEquivalentTo(const ReachableFact& other, const EquivalentO
 	
 	for (unsigned int i = 0; i < predicate_->getArity(); i++)
 	{
-//		if (!(*term_domain_mapping_)[i]->isGrounded() && (*term_domain_mapping_)[i]->isPartOfAPropertyState())
-		if ((*term_domain_mapping_)[i] == &variant_eog)
+//		if (!term_domain_mapping_[i]->isGrounded() && term_domain_mapping_[i]->isPartOfAPropertyState())
+		if (term_domain_mapping_[i] == &variant_eog)
 		{
 			// Make sure the types match up.
-			if (!(*term_domain_mapping_)[i]->hasSameFingerPrint(*(*other.term_domain_mapping_)[i]))
+			if (!term_domain_mapping_[i]->hasSameFingerPrint(*other.term_domain_mapping_[i]))
 			{
 //				std::cout << "The " << i << "th term does not have the same fingerprint!" << std::endl;
 				return false;
 			}
 		}
 
-		else if (!(*term_domain_mapping_)[i]->isIdenticalTo(*(*other.term_domain_mapping_)[i]))
+		else if (!term_domain_mapping_[i]->isIdenticalTo(*other.term_domain_mapping_[i]))
 		{
 //			std::cout << "The " << i << "th term is at odds!" << std::endl;
 			return false;
@@ -338,11 +340,11 @@ bool ReachableFact::isIdenticalTo(const ReachableFact& other) const
 	
 	for (unsigned int i = 0; i < predicate_->getArity(); i++)
 	{
-//		if (&(*term_domain_mapping_)[i]->getRootNode() != &(*other.term_domain_mapping_)[i]->getRootNode())
-		if ((*term_domain_mapping_)[i] != (*other.term_domain_mapping_)[i])
+//		if (&term_domain_mapping_[i]->getRootNode() != &other.term_domain_mapping_[i]->getRootNode())
+		if (term_domain_mapping_[i] != other.term_domain_mapping_[i])
 		{
 #ifdef MYPOP_SAS_PLUS_DTG_REACHABILITY_DEBUG
-			if ((*term_domain_mapping_)[i]->isIdenticalTo(*(*other.term_domain_mapping_)[i]))
+			if (term_domain_mapping_[i]->isIdenticalTo(*other.term_domain_mapping_[i]))
 			{
 				std::cerr << "Could not check if " << *this << " is equivalent to " << other << std::endl;
 				std::cerr << "WRONG!" << std::endl;
@@ -353,7 +355,7 @@ bool ReachableFact::isIdenticalTo(const ReachableFact& other) const
 		}
 		
 #ifdef MYPOP_SAS_PLUS_DTG_REACHABILITY_DEBUG
-		if (!(*term_domain_mapping_)[i]->isIdenticalTo(*(*other.term_domain_mapping_)[i]))
+		if (!term_domain_mapping_[i]->isIdenticalTo(*other.term_domain_mapping_[i]))
 		{
 			std::cerr << "WRONG!" << std::endl;
 			exit(1);
@@ -366,7 +368,7 @@ bool ReachableFact::isIdenticalTo(const ReachableFact& other) const
 EquivalentObjectGroup& ReachableFact::getTermDomain(unsigned int index) const
 {
 	assert (index < predicate_->getArity());
-	EquivalentObjectGroup* eog = (*term_domain_mapping_)[index];
+	EquivalentObjectGroup* eog = term_domain_mapping_[index];
 	assert (eog != NULL);
 	return *eog;
 }
@@ -422,8 +424,8 @@ void ReachableFact::print(std::ostream& os, unsigned int iteration) const
 	for (unsigned int i = 0; i < predicate_->getArity(); i++)
 	{
 		os << "{";
-		(*term_domain_mapping_)[i]->printObjects(os, iteration);
-//		os << "(" << (*term_domain_mapping_)[i] << ")";
+		term_domain_mapping_[i]->printObjects(os, iteration);
+//		os << "(" << term_domain_mapping_[i] << ")";
 		os << "}";
 		if (i + 1 != predicate_->getArity())
 		{
@@ -437,7 +439,7 @@ std::ostream& operator<<(std::ostream& os, const ReachableFact& reachable_fact)
 	os << "Reachable fact: (" << reachable_fact.getPredicate().getName() << "[" << reachable_fact.getPredicate() << "] ";
 	for (unsigned int i = 0; i < reachable_fact.getPredicate().getArity(); i++)
 	{
-		const std::vector<EquivalentObject*>& objects = (*reachable_fact.term_domain_mapping_)[i]->getEquivalentObjects();
+		const std::vector<EquivalentObject*>& objects = reachable_fact.term_domain_mapping_[i]->getEquivalentObjects();
 		os << "{";
 		for (std::vector<EquivalentObject*>::const_iterator ci = objects.begin(); ci != objects.end(); ci++)
 		{
@@ -2082,10 +2084,225 @@ std::ostream& operator<<(std::ostream& os, const AchievingTransition& executed_a
 	return os;
 }
 
-ReachableTransition::ReachableTransition(const MyPOP::HEURISTICS::LiftedTransition& lifted_transition, const std::vector< MyPOP::REACHABILITY::ReachableSet* >& preconditions, const std::vector< MyPOP::REACHABILITY::ReachableSet* >& effects)
-	: transition_(&lifted_transition), preconditions_reachable_sets_(&preconditions), effect_reachable_sets_(&effects)
+const unsigned int PropertySpaceMutexes::NO_PROPERTY_SPACE = std::numeric_limits<unsigned int>::max();
+
+PropertySpaceMutexes::PropertySpaceMutexes(const TermManager& term_manager)
 {
+	for (std::vector<TIM::PropertySpace*>::const_iterator ci = TIM::TA->pbegin(); ci != TIM::TA->pend(); ++ci)
+	{
+		const TIM::PropertySpace* property_space = *ci;
+		if (!property_space->isState() || property_space->isStatic())
+		{
+			continue;
+		}
+		
+		// The atoms are only mutually exclusive if no property state contains more than a single property.
+		bool is_mutex = true;
+		std::set<std::pair<std::string, unsigned int> > properties;
+		for (TIM::PropertySpace::SIterator ci = property_space->begin(); ci != property_space->end(); ++ci)
+		{
+			const TIM::PropertyState* property_state = *ci;
+			if (property_state->size() > 1)
+			{
+				is_mutex = false;
+				break;
+			}
+			
+			for (TIM::PropertyState::PSIterator ci = property_state->begin(); ci != property_state->end(); ++ci)
+			{
+				const TIM::Property* property = *ci;
+				properties.insert(std::make_pair(property->root()->getName(), property->aPosn()));
+			}
+		}
+		
+		if (!is_mutex || properties.empty())
+		{
+			continue;
+		}
+		
+		unsigned int property_space_index = objects_.size();
+		for (std::set<std::pair<std::string, unsigned int> >::const_iterator ci = properties.begin(); ci != properties.end(); ++ci)
+		{
+			property_spaces_.insert(std::make_pair(*ci, property_space_index));
+		}
+		
+		objects_.push_back(std::set<const Object*>());
+		for (TIM::PropertySpace::OIterator ci = property_space->obegin(); ci != property_space->oend(); ++ci)
+		{
+			objects_.back().insert(&term_manager.getObject((*ci)->getName()));
+		}
+	}
+}
+
+unsigned int PropertySpaceMutexes::getPropertySpace(const std::string& predicate_name, unsigned int position) const
+{
+	std::map<std::pair<std::string, unsigned int>, unsigned int>::const_iterator ci = property_spaces_.find(std::make_pair(predicate_name, position));
+	if (ci == property_spaces_.end())
+	{
+		return NO_PROPERTY_SPACE;
+	}
+	return (*ci).second;
+}
 
+bool PropertySpaceMutexes::isPartOf(const EquivalentObjectGroup& eog, unsigned int property_space) const
+{
+	const std::set<const Object*>& objects = objects_[property_space];
+	for (std::vector<EquivalentObject*>::const_iterator ci = eog.getEquivalentObjects().begin(); ci != eog.getEquivalentObjects().end(); ++ci)
+	{
+		if (objects.count(&(*ci)->getObject()) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+ReachableTransition::ReachableTransition(const MyPOP::HEURISTICS::LiftedTransition& lifted_transition, const std::vector< MyPOP::REACHABILITY::ReachableSet* >& preconditions, const std::vector< MyPOP::REACHABILITY::ReachableSet* >& effects, const PropertySpaceMutexes& property_space_mutexes)
+	: transition_(&lifted_transition), preconditions_reachable_sets_(&preconditions), effect_reachable_sets_(&effects), property_space_mutexes_(&property_space_mutexes)
+{
+	for (std::vector<ReachableSet*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+	{
+		precondition_mappings_.push_back((*transition_->getPreconditionMappings().find(&(*ci)->getFactSet())).second);
+	}
+	
+	for (std::vector<ReachableSet*>::const_iterator ci = effects.begin(); ci != effects.end(); ++ci)
+	{
+		effect_mappings_.push_back((*transition_->getEffectMappings().find(&(*ci)->getFactSet())).second);
+	}
+	
+	const Action& action = transition_->getAction();
+	for (std::vector<const Atom*>::const_iterator ci = action.getEffects().begin(); ci != action.getEffects().end(); ++ci)
+	{
+		const Atom* effect = *ci;
+		if (!effect->isNegative())
+		{
+			continue;
+		}
+		
+		NegativeEffect negative_effect;
+		negative_effect.predicate_ = &effect->getPredicate();
+		for (unsigned int term_index = 0; term_index < effect->getArity(); ++term_index)
+		{
+			negative_effect.action_variables_.push_back(action.getActionVariable(*effect->getTerms()[term_index]));
+		}
+		negative_effects_.push_back(negative_effect);
+	}
+	
+	// Find all pairs of preconditions which have terms at the positions of properties of the same property space, these 
+	// preconditions are mutually exclusive if the same object is assigned to both terms.
+	std::vector<const Atom*> action_preconditions;
+	Utility::convertFormula(action_preconditions, &action.getPrecondition());
+	for (std::vector<const Atom*>::const_iterator ci = action_preconditions.begin(); ci != action_preconditions.end(); ++ci)
+	{
+		const Atom* lhs = *ci;
+		if (lhs->isNegative())
+		{
+			continue;
+		}
+		
+		for (std::vector<const Atom*>::const_iterator ci2 = ci + 1; ci2 != action_preconditions.end(); ++ci2)
+		{
+			const Atom* rhs = *ci2;
+			if (rhs->isNegative())
+			{
+				continue;
+			}
+			
+			for (unsigned int lhs_position = 0; lhs_position < lhs->getArity(); ++lhs_position)
+			{
+				unsigned int property_space = property_space_mutexes.getPropertySpace(lhs->getPredicate().getName(), lhs_position);
+				if (property_space == PropertySpaceMutexes::NO_PROPERTY_SPACE)
+				{
+					continue;
+				}
+				
+				for (unsigned int rhs_position = 0; rhs_position < rhs->getArity(); ++rhs_position)
+				{
+					if (property_space_mutexes.getPropertySpace(rhs->getPredicate().getName(), rhs_position) != property_space)
+					{
+						continue;
+					}
+					
+					MutexPreconditions mutex_preconditions;
+					for (unsigned int term_index = 0; term_index < lhs->getArity(); ++term_index)
+					{
+						mutex_preconditions.lhs_action_variables_.push_back(action.getActionVariable(*lhs->getTerms()[term_index]));
+					}
+					for (unsigned int term_index = 0; term_index < rhs->getArity(); ++term_index)
+					{
+						mutex_preconditions.rhs_action_variables_.push_back(action.getActionVariable(*rhs->getTerms()[term_index]));
+					}
+					mutex_preconditions.lhs_position_ = lhs_position;
+					mutex_preconditions.rhs_position_ = rhs_position;
+					mutex_preconditions.property_space_ = property_space;
+					mutex_preconditions.is_same_property_ = lhs->getPredicate().getName() == rhs->getPredicate().getName() && lhs_position == rhs_position;
+					
+					// Constants are not tracked by the variable assignments.
+					if (mutex_preconditions.lhs_action_variables_[lhs_position] == std::numeric_limits<unsigned int>::max() ||
+					    mutex_preconditions.rhs_action_variables_[rhs_position] == std::numeric_limits<unsigned int>::max())
+					{
+						continue;
+					}
+					mutex_preconditions_.push_back(mutex_preconditions);
+				}
+			}
+		}
+	}
+}
+
+bool ReachableTransition::isMutex(const std::vector<EquivalentObjectGroup*>& variable_assignments) const
+{
+	for (std::vector<MutexPreconditions>::const_iterator ci = mutex_preconditions_.begin(); ci != mutex_preconditions_.end(); ++ci)
+	{
+		const MutexPreconditions& mutex_preconditions = *ci;
+		unsigned int lhs_variable = mutex_preconditions.lhs_action_variables_[mutex_preconditions.lhs_position_];
+		unsigned int rhs_variable = mutex_preconditions.rhs_action_variables_[mutex_preconditions.rhs_position_];
+		if (variable_assignments[lhs_variable] == NULL || variable_assignments[rhs_variable] == NULL)
+		{
+			continue;
+		}
+		
+		// Both terms must be the same object. Different variables are only known to be the same object if they are assigned 
+		// the same EOG which contains a single object.
+		EquivalentObjectGroup& lhs_eog = variable_assignments[lhs_variable]->getRootNode();
+		EquivalentObjectGroup& rhs_eog = variable_assignments[rhs_variable]->getRootNode();
+		if (lhs_variable != rhs_variable && (&lhs_eog != &rhs_eog || lhs_eog.getEquivalentObjects().size() != 1))
+		{
+			continue;
+		}
+		
+		if (!property_space_mutexes_->isPartOf(lhs_eog, mutex_preconditions.property_space_))
+		{
+			continue;
+		}
+		
+		if (!mutex_preconditions.is_same_property_)
+		{
+			return true;
+		}
+		
+		// Both preconditions are mutually exclusive unless they are the same atom, which they are not if one of the other terms 
+		// is assigned a different EOG.
+		for (unsigned int term_index = 0; term_index < mutex_preconditions.lhs_action_variables_.size(); ++term_index)
+		{
+			unsigned int lhs_term_variable = mutex_preconditions.lhs_action_variables_[term_index];
+			unsigned int rhs_term_variable = mutex_preconditions.rhs_action_variables_[term_index];
+			if (lhs_term_variable == rhs_term_variable ||
+			    lhs_term_variable == std::numeric_limits<unsigned int>::max() ||
+			    rhs_term_variable == std::numeric_limits<unsigned int>::max() ||
+			    variable_assignments[lhs_term_variable] == NULL ||
+			    variable_assignments[rhs_term_variable] == NULL)
+			{
+				continue;
+			}
+			
+			if (&variable_assignments[lhs_term_variable]->getRootNode() != &variable_assignments[rhs_term_variable]->getRootNode())
+			{
+				return true;
+			}
+		}
+	}
+	return false;
 }
 	
 ReachableTransition::~ReachableTransition()
@@ -2194,9 +2411,28 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 
 	std::vector<EquivalentObjectGroup*> variable_assignments(transition_->getAction().getVariables().size(), NULL);
 	std::vector<const ReachableFact*> preconditions;
+	std::vector<std::pair<const ReachableFact*, const NegativeEffect*> > deletable_persistent_facts;
+	getDeletablePersistentFacts(deletable_persistent_facts, persistent_facts);
 	//std::vector<const AchievingTransition*> newly_created_reachable_facts;
 	//generateReachableFacts(eog_manager, newly_created_reachable_facts, preconditions, variable_assignments, 0, *fact_layer.getPreviousLayer());
-	return generateReachableFacts(eog_manager, preconditions, variable_assignments, 0, fact_layer, persistent_facts);
+	return generateReachableFacts(eog_manager, preconditions, variable_assignments, 0, fact_layer, deletable_persistent_facts);
+}
+
+void ReachableTransition::getDeletablePersistentFacts(std::vector<std::pair<const ReachableFact*, const NegativeEffect*> >& deletable_facts, const std::vector<const ReachableFact*>& persistent_facts) const
+{
+	for (std::vector<NegativeEffect>::const_iterator ci = negative_effects_.begin(); ci != negative_effects_.end(); ++ci)
+	{
+		const NegativeEffect& negative_effect = *ci;
+		for (std::vector<const ReachableFact*>::const_iterator ci = persistent_facts.begin(); ci != persistent_facts.end(); ++ci)
+		{
+			const ReachableFact* persistent_fact = *ci;
+			if (persistent_fact->getPredicate().getArity() == negative_effect.predicate_->getArity() &&
+			    persistent_fact->getPredicate().getName() == negative_effect.predicate_->getName())
+			{
+				deletable_facts.push_back(std::make_pair(persistent_fact, &negative_effect));
+			}
+		}
+	}
 }
 
 /*
@@ -2408,7 +2644,7 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 }
 */
 
-bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupManager& eog_manager, std::vector<const ReachableFact*>& preconditions, std::vector<EquivalentObjectGroup*>& current_variable_assignments, unsigned int precondition_index, MyPOP::REACHABILITY::ReachableFactLayer& new_fact_layer, const std::vector<const ReachableFact*>& persistent_facts)
+bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupManager& eog_manager, std::vector<const ReachableFact*>& preconditions, std::vector<EquivalentObjectGroup*>& current_variable_assignments, unsigned int precondition_index, MyPOP::REACHABILITY::ReachableFactLayer& new_fact_layer, const std::vector<std::pair<const ReachableFact*, const NegativeEffect*> >& deletable_persistent_facts)
 {
 #ifdef MYPOP_SAS_PLUS_DTG_REACHABILITY_PERFORM_REACHABILITY_COMMENT
 	std::cout << "[ReachableTransition::generateReachableFacts] (" << transition_->getAction().getPredicate();
@@ -2520,45 +2756,24 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 		 * Check if this action destroys any persistent facts.
 		 */
 		bool deletes_persistent_node = false;
-		for (std::vector<const ReachableFact*>::const_iterator ci = persistent_facts.begin(); ci != persistent_facts.end(); ++ci)
+		for (std::vector<std::pair<const ReachableFact*, const NegativeEffect*> >::const_iterator ci = deletable_persistent_facts.begin(); ci != deletable_persistent_facts.end(); ++ci)
 		{
-			const ReachableFact* persistent_fact = *ci;
+			const ReachableFact* persistent_fact = (*ci).first;
+			const NegativeEffect* negative_effect = (*ci).second;
 			
-			for (std::vector<const Atom*>::const_iterator ci = at->getAchiever()->getTransition().getAction().getEffects().begin(); ci != at->getAchiever()->getTransition().getAction().getEffects().end(); ++ci) 
+			bool terms_match = true;
+			for (unsigned int term_index = 0; term_index < negative_effect->action_variables_.size(); ++term_index)
 			{
-				const Atom* effect = *ci;
-				if (!effect->isNegative())
+				if (&persistent_fact->getTermDomain(term_index) != current_variable_assignments[negative_effect->action_variables_[term_index]])
 				{
-					continue;
-				}
-				
-				if (effect->getArity() != persistent_fact->getPredicate().getArity() ||
-				    effect->getPredicate().getName() != persistent_fact->getPredicate().getName())
-				{
-					continue;
-				}
-				
-				bool terms_match = true;
-				for (unsigned int term_index = 0; term_index < effect->getArity(); ++term_index)
-				{
-					const EquivalentObjectGroup& persistent_term_eog = persistent_fact->getTermDomain(term_index);
-					const EquivalentObjectGroup* effect_term_eog = current_variable_assignments[at->getAchiever()->getTransition().getAction().getActionVariable(*effect->getTerms()[term_index])];
-					
-					if (&persistent_term_eog != effect_term_eog)
-					{
-						terms_match = false;
-						break;
-					}
-				}
-				
-				if (terms_match)
-				{
-					deletes_persistent_node = true;
+					terms_match = false;
 					break;
 				}
 			}
-			if (deletes_persistent_node)
+			
+			if (terms_match)
 			{
+				deletes_persistent_node = true;
 				break;
 			}
 		}
@@ -2577,7 +2792,7 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 			//ReachableSet* effect = *ci;
 			ReachableSet* effect = (*effect_reachable_sets_)[fact_set_index];
 			const HEURISTICS::FactSet& effect_fact_set = effect->getFactSet();
-			std::vector<std::vector<unsigned int>* >* effects_mappings = (*transition_->getEffectMappings().find(&effect_fact_set)).second;
+			const std::vector<std::vector<unsigned int>* >* effects_mappings = effect_mappings_[fact_set_index];
 			
 			for (unsigned int fact_index = 0; fact_index < effect_fact_set.getFacts().size(); ++fact_index)
 			{
@@ -2621,15 +2836,15 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 				unsigned int counter[fact->getVariableDomains().size()];
 				memset(&counter, 0, sizeof(unsigned int) * fact->getVariableDomains().size());
 				
+				std::vector<EquivalentObjectGroup*> variable_domains(fact->getVariableDomains().size());
 				bool created_all_possible_facts = false;
 				while (!created_all_possible_facts)
 				{
 					created_all_possible_facts = true;
 					
-					std::vector<EquivalentObjectGroup*>* variable_domains = new std::vector<EquivalentObjectGroup*>();
 					for (unsigned int i = 0; i < fact->getVariableDomains().size(); ++i)
 					{
-						variable_domains->push_back((*possible_domains_per_term[i])[counter[i]]);
+						variable_domains[i] = (*possible_domains_per_term[i])[counter[i]];
 /*
 						std::cout << "Possible domains for term index: " << i << ": ";
 						(*possible_domains_per_term[i])[counter[i]]->printObjects(std::cout);
@@ -2652,7 +2867,7 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 						bool terms_match = true;
 						for (unsigned int term_index = 0; term_index < fact->getPredicate().getArity(); ++term_index)
 						{
-							if ((*variable_domains)[term_index] != &existing_effect_item->getReachableFactCopy().getTermDomain(term_index))
+							if (variable_domains[term_index] != &existing_effect_item->getReachableFactCopy().getTermDomain(term_index))
 							{
 								terms_match = false;
 							}
@@ -2667,7 +2882,7 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 					
 					if (new_effect_layer_item == NULL)
 					{
-						ReachableFact& new_effect = ReachableFact::createReachableFact(fact->getPredicate(), *variable_domains);
+						ReachableFact& new_effect = ReachableFact::createReachableFact(fact->getPredicate(), variable_domains);
 						new_effect_layer_item = new ReachableFactLayerItem(new_fact_layer, new_effect);
 						created_new_effect = true;
 						if (new_effect.getPredicate().getArity() != 0)
@@ -2749,10 +2964,6 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 						}
 */
 					}
-					else
-					{
-						delete variable_domains;
-					}
 					
 					new_effect_layer_item->addAchiever(*at, fact_set_index, fact_index);
 					at->addEffect(*new_effect_layer_item, fact_set_index, fact_index);
@@ -2815,7 +3026,7 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 	}
 	
 	ReachableSet* precondition_reachable_set = (*preconditions_reachable_sets_)[precondition_index];
-	std::vector<std::vector<unsigned int>* >* precondition_mappings = (*transition_->getPreconditionMappings().find(&precondition_reachable_set->getFactSet())).second;
+	const std::vector<std::vector<unsigned int>* >* precondition_mappings = precondition_mappings_[precondition_index];
 	
 	for (unsigned int tree_index = 0; tree_index < precondition_reachable_set->getCachedReachableTreesSize(); ++tree_index)
 	{
@@ -2845,7 +3056,13 @@ bool ReachableTransition::generateReachableFacts(const EquivalentObjectGroupMana
 				leaf_node = leaf_node->getParent();
 			}
 			
-			if (generateReachableFacts(eog_manager, new_preconditions, tmp_current_variable_assignments, precondition_index + 1, new_fact_layer, persistent_facts))
+			// Ignore combinations of preconditions which can never be true at the same time.
+			if (!mutex_preconditions_.empty() && isMutex(tmp_current_variable_assignments))
+			{
+				continue;
+			}
+			
+			if (generateReachableFacts(eog_manager, new_preconditions, tmp_current_variable_assignments, precondition_index + 1, new_fact_layer, deletable_persistent_facts))
 			{
 				created_new_effect = true;
 			}
@@ -3798,6 +4015,8 @@ DTGReachability::DTGReachability(const std::vector< MyPOP::HEURISTICS::LiftedTra
 	// Initialise the individual groups per object.
 	equivalent_object_manager_ = new EquivalentObjectGroupManager(fact_sets, term_manager, predicate_manager);
 	
+	property_space_mutexes_ = new PropertySpaceMutexes(term_manager);
+	
 	// Create the reachable facts.
 	std::vector<ReachableSet*> all_reachable_sets;
 	for (std::vector<const HEURISTICS::FactSet*>::const_iterator ci = fact_sets.begin(); ci != fact_sets.end(); ++ci)
@@ -3828,7 +4047,7 @@ DTGReachability::DTGReachability(const std::vector< MyPOP::HEURISTICS::LiftedTra
 			effect_reachable_sets->push_back(fact_set_to_reachable_set_[*ci]);
 		}
 		
-		reachable_transition_.push_back(new ReachableTransition(*lifted_transition, *precondition_reachable_sets, *effect_reachable_sets));
+		reachable_transition_.push_back(new ReachableTransition(*lifted_transition, *precondition_reachable_sets, *effect_reachable_sets, *property_space_mutexes_));
 	}
 	
 	// Cache predicate ids to reachable sets which contain said predicate.
@@ -3876,6 +4095,7 @@ DTGReachability::~DTGReachability()
 	{
 		delete *ci;
 	}
+	delete property_space_mutexes_;
 	
 	for (std::map<const HEURISTICS::FactSet*, ReachableSet*>::const_iterator ci = fact_set_to_reachable_set_.begin(); ci != fact_set_to_reachable_set_.end(); ++ci)
 	{
@@ -4188,17 +4408,19 @@ void DTGReachability::setHeuristicForState(MyPOP::State& state, const std::vecto
 	
 	std::vector<const GroundedAtom*> state_facts;
 	state.getFacts(initial_facts, state_facts);
+	
+	// States whose facts are all reachable from a known dead end can only reach a subset of those facts.
+	if (nogood_store_.isDeadEnd(state_facts))
+	{
+		state.setDistanceToGoal(std::numeric_limits<unsigned int>::max());
+		return;
+	}
+	
 	///for (std::vector<const GroundedAtom*>::const_iterator ci = state.getFacts().begin(); ci != state.getFacts().end(); ci++)
 	for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ci++)
 	{
 		const GroundedAtom* grounded_atom = *ci;
-		std::vector<REACHABILITY::EquivalentObjectGroup*>* variables = new std::vector<REACHABILITY::EquivalentObjectGroup*>(grounded_atom->getPredicate().getArity());
-		for (unsigned int i = 0; i < grounded_atom->getPredicate().getArity(); i++)
-		{
-			(*variables)[i] = &getEquivalentObjectGroupManager().getEquivalentObject(grounded_atom->getObject(i)).getEquivalentObjectGroup();
-		}
-		
-		reachable_facts.push_back(&REACHABILITY::ReachableFact::createReachableFact(grounded_atom->getPredicate(), *variables));
+		reachable_facts.push_back(&REACHABILITY::ReachableFact::createReachableFact(*grounded_atom, getEquivalentObjectGroupManager()));
 	}
 
 #ifdef MYPOP_FORWARD_CHAIN_PLANNER_COMMENTS
@@ -4294,13 +4516,7 @@ void DTGReachability::setHeuristicForState(MyPOP::State& state, const std::vecto
 		for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ci++)
 		{
 			const GroundedAtom* grounded_atom = *ci;
-			std::vector<REACHABILITY::EquivalentObjectGroup*>* variables = new std::vector<REACHABILITY::EquivalentObjectGroup*>(grounded_atom->getPredicate().getArity());
-			for (unsigned int i = 0; i < grounded_atom->getPredicate().getArity(); i++)
-			{
-				(*variables)[i] = &getEquivalentObjectGroupManager().getEquivalentObject(grounded_atom->getObject(i)).getEquivalentObjectGroup();
-			}
-			
-			reachable_facts.push_back(&REACHABILITY::ReachableFact::createReachableFact(grounded_atom->getPredicate(), *variables));
+			reachable_facts.push_back(&REACHABILITY::ReachableFact::createReachableFact(*grounded_atom, getEquivalentObjectGroupManager()));
 		}
 //		std::cerr << "!";
 		performReachabilityAnalysis(result, reachable_facts, persistent_facts);
@@ -4312,6 +4528,28 @@ void DTGReachability::setHeuristicForState(MyPOP::State& state, const std::vecto
 	
 	unsigned int heuristic_value = getHeuristic(goal_facts, allow_new_goals_to_be_added, find_helpful_actions);
 	state.setDistanceToGoal(heuristic_value);
+	
+	// The analysis without persistent facts is a plain delete relaxation, so the facts it reached form a nogood.
+	if (!all_goal_facts_are_achieved && heuristic_value == std::numeric_limits<unsigned int>::max())
+	{
+		HEURISTICS::Nogood* nogood = new HEURISTICS::Nogood();
+		for (std::vector<const REACHABILITY::ReachableFact*>::const_iterator ci = result.begin(); ci != result.end(); ++ci)
+		{
+			const REACHABILITY::ReachableFact* reachable_fact = *ci;
+			std::vector<std::vector<unsigned int> > object_ids(reachable_fact->getPredicate().getArity());
+			for (unsigned int i = 0; i < reachable_fact->getPredicate().getArity(); ++i)
+			{
+				const std::vector<EquivalentObject*>& equivalent_objects = reachable_fact->getTermDomain(i).getEquivalentObjects();
+				for (std::vector<EquivalentObject*>::const_iterator ci = equivalent_objects.begin(); ci != equivalent_objects.end(); ++ci)
+				{
+					object_ids[i].push_back((*ci)->getObject().getId());
+				}
+				std::sort(object_ids[i].begin(), object_ids[i].end());
+			}
+			nogood->addFact(reachable_fact->getPredicate().getName(), object_ids);
+		}
+		nogood_store_.addNogood(*nogood);
+	}
 /*
 //	std::cerr << analyst.getHelpfulActions().size() << std::endl;
 	if (find_helpful_actions)
@@ -4780,9 +5018,9 @@ void DTGReachability::substitute(const EquivalentObject& lhs, const EquivalentOb
 		const ReachableFactLayerItem* initial_item = *ci;
 		bool contains_lhs = false;
 		
-		for (std::vector<EquivalentObjectGroup*>::const_iterator ci = initial_item->getReachableFactCopy().getTermDomains().begin(); ci != initial_item->getReachableFactCopy().getTermDomains().end(); ++ci)
+		for (unsigned int term_index = 0; term_index < initial_item->getReachableFactCopy().getPredicate().getArity(); ++term_index)
 		{
-			EquivalentObjectGroup* eog = *ci;
+			EquivalentObjectGroup* eog = &initial_item->getReachableFactCopy().getTermDomain(term_index);
 			if (eog->contains(lhs.getObject(), 0))
 			{
 				contains_lhs = true;
@@ -4795,24 +5033,23 @@ void DTGReachability::substitute(const EquivalentObject& lhs, const EquivalentOb
 			continue;
 		}
 		
-		std::vector<EquivalentObjectGroup*>* domains = new std::vector<EquivalentObjectGroup*>();
+		std::vector<EquivalentObjectGroup*> domains;
 		
-		std::vector<const Object*>** variable_domains = new std::vector<const Object*>*[initial_item->getReachableFactCopy().getTermDomains().size()];
+		std::vector<const Object*>** variable_domains = new std::vector<const Object*>*[initial_item->getReachableFactCopy().getPredicate().getArity()];
 		
-		for (std::vector<EquivalentObjectGroup*>::const_iterator ci = initial_item->getReachableFactCopy().getTermDomains().begin(); ci != initial_item->getReachableFactCopy().getTermDomains().end(); ++ci)
+		for (unsigned int term_index = 0; term_index < initial_item->getReachableFactCopy().getPredicate().getArity(); ++term_index)
 		{
-			unsigned int term_index = std::distance(initial_item->getReachableFactCopy().getTermDomains().begin(), ci);
 			std::vector<const Object*>* variable_domain = new std::vector<const Object*>();
 			variable_domains[term_index] = variable_domain;
-			EquivalentObjectGroup* eog = *ci;
+			EquivalentObjectGroup* eog = &initial_item->getReachableFactCopy().getTermDomain(term_index);
 			if (eog->contains(lhs.getObject(), 0))
 			{
-				domains->push_back(&rhs.getEquivalentObjectGroup());
+				domains.push_back(&rhs.getEquivalentObjectGroup());
 				variable_domain->push_back(&rhs.getObject());
 			}
 			else
 			{
-				domains->push_back(eog);
+				domains.push_back(eog);
 				for (std::vector<EquivalentObject*>::const_iterator ci = eog->begin(0); ci != eog->end(0); ++ci)
 				{
 					variable_domain->push_back(&(*ci)->getObject());
@@ -4820,7 +5057,7 @@ void DTGReachability::substitute(const EquivalentObject& lhs, const EquivalentOb
 			}
 		}
 			
-		ReachableFact reachable_fact(initial_item->getReachableFactCopy().getPredicate(), *domains);
+		ReachableFact reachable_fact(initial_item->getReachableFactCopy().getPredicate(), domains);
 		
 		// Find a fact layer where this reachable fact is true.
 		const ReachableFactLayerItem* found_layer_item = NULL;
@@ -5316,7 +5553,7 @@ unsigned int DTGReachability::getHeuristic(const std::vector<const GroundedAtom*
 			
 			for (unsigned int term_index = 0; term_index < precondition_item->getReachableFactCopy().getPredicate().getArity(); ++term_index)
 			{
-				EquivalentObjectGroup* fact_layer_precondition_eog = precondition_item->getReachableFactCopy().getTermDomains()[term_index];
+				EquivalentObjectGroup* fact_layer_precondition_eog = &precondition_item->getReachableFactCopy().getTermDomain(term_index);
 
 				std::vector<const Object*>* precondition_term_domain = new std::vector<const Object*>();
 				precondition_object_bindings[term_index] = precondition_term_domain;
@@ -5396,10 +5633,12 @@ unsigned int DTGReachability::getHeuristic(const std::vector<const GroundedAtom*
 						}
 						else
 						{
+							std::vector<const Object*> objects;
 							for (std::vector<EquivalentObject*>::const_iterator ci = eog->begin(0); ci != eog->end(0); ++ci)
 							{
-								vd->addObject((*ci)->getObject());
+								objects.push_back(&(*ci)->getObject());
 							}
+							vd->set(objects);
 						}
 						new_variable_domains->push_back(vd);
 					}
@@ -5,6 +5,7 @@
 #include <vector>
 #include <iosfwd>
 #include <set>
+#include <string>
 #include <assert.h>
 #include <stdio.h>
 #include <queue>
@@ -14,6 +15,7 @@
 #include "utility/memory_pool.h"
 #include "reachable_tree.h"
 #include "heuristic_interface.h"
+#include "nogood_store.h"
 
 namespace MyPOP {
 
@@ -70,7 +72,10 @@ class ReachableFact
 public:
 //	static ReachableFact& createReachableFact(const SAS_Plus::BoundedAtom& bounded_atom, const Bindings& bindings, const EquivalentObjectGroupManager& eog_manager);
 	
-	static ReachableFact& createReachableFact(const Predicate& predicate, std::vector<EquivalentObjectGroup*>& term_domain_mapping, bool allow_reuse = false);
+	/**
+	 * Create a reachable fact, the term domains are copied.
+	 */
+	static ReachableFact& createReachableFact(const Predicate& predicate, const std::vector<EquivalentObjectGroup*>& term_domain_mapping, bool allow_reuse = false);
 	
 	static ReachableFact& createReachableFact(const GroundedAtom& grounded_atom, const EquivalentObjectGroupManager& eog_manager, bool allow_reuse = false);
 	
@@ -114,8 +119,6 @@ public:
 	
 	EquivalentObjectGroup& getTermDomain(unsigned int index) const;
 	
-//	EquivalentObjectGroup** getTermDomains() const { return term_domain_mapping_; }
-	const std::vector<EquivalentObjectGroup*>& getTermDomains() const { return *term_domain_mapping_; }
 	
 //	const Atom& getAtom() const { return *atom_; }
 	const Predicate& getPredicate() const { return *predicate_; }
@@ -142,7 +145,7 @@ public:
 	
 	void print(std::ostream& os, unsigned int iteration) const;
 	
-	ReachableFact(const Predicate& predicate, std::vector<EquivalentObjectGroup*>& term_domain_mapping);
+	ReachableFact(const Predicate& predicate, const std::vector<EquivalentObjectGroup*>& term_domain_mapping);
 	
 private:
 	
@@ -160,8 +163,10 @@ private:
 
 	const Predicate* predicate_;
 	
-	//EquivalentObjectGroup** term_domain_mapping_;
-	std::vector<EquivalentObjectGroup*>* term_domain_mapping_;
+	// Facts with at most MAX_INLINE_TERMS terms store their term domains inline, so they do not need a separate allocation.
+	static const unsigned int MAX_INLINE_TERMS = 4;
+	EquivalentObjectGroup* inline_term_domains_[MAX_INLINE_TERMS];
+	EquivalentObjectGroup** term_domain_mapping_;
 	
 	// During the construction of the reachability graph terms can be merged and because of that some reachable facts are
 	// removed because they have become identical to others. E.g. consider the following two reachable facts:
@@ -481,10 +486,38 @@ std::ostream& operator<<(std::ostream& os, const AchievingTransition& executed_a
  * we need to know the value of driver which - in this case - is bounded by the precondition (at driver loc). Since loc is 
  * grounded we only need to lookup all the values of driver at that location and insert it.
  */
+/**
+ * The invariants found by TIM: in a property space where every property state contains at most a single property, every 
+ * object of that property space makes at most one of the atoms true in which it appears at the position of one of these 
+ * properties. For example, a truck can only be at a single location.
+ */
+class PropertySpaceMutexes
+{
+public:
+	static const unsigned int NO_PROPERTY_SPACE;
+	
+	PropertySpaceMutexes(const TermManager& term_manager);
+	
+	/**
+	 * @return The index of the property space the property is part of, or NO_PROPERTY_SPACE if it is not part of a property 
+	 * space with this invariant.
+	 */
+	unsigned int getPropertySpace(const std::string& predicate_name, unsigned int position) const;
+	
+	/**
+	 * @return True if all the objects of the EOG are part of the property space.
+	 */
+	bool isPartOf(const EquivalentObjectGroup& eog, unsigned int property_space) const;
+	
+private:
+	std::map<std::pair<std::string, unsigned int>, unsigned int> property_spaces_;
+	std::vector<std::set<const Object*> > objects_;
+};
+
 class ReachableTransition
 {
 public:
-	ReachableTransition(const HEURISTICS::LiftedTransition& lifted_transition, const std::vector<ReachableSet*>& preconditions, const std::vector<ReachableSet*>& effects);
+	ReachableTransition(const HEURISTICS::LiftedTransition& lifted_transition, const std::vector<ReachableSet*>& preconditions, const std::vector<ReachableSet*>& effects, const PropertySpaceMutexes& property_space_mutexes);
 	
 	~ReachableTransition();
 	
@@ -504,13 +537,59 @@ public:
 	
 	//void print(std::ostream& os) const;
 private:
-	bool generateReachableFacts(const EquivalentObjectGroupManager& eog_manager, std::vector<const ReachableFact*>& preconditions, std::vector<EquivalentObjectGroup*>& current_variable_assignments, unsigned int precondition_index, MyPOP::REACHABILITY::ReachableFactLayer& new_fact_layer, const std::vector<const ReachableFact*>& persistent_facts);
+	
+	/**
+	 * A negative effect of the transition with its terms mapped to the action variables.
+	 */
+	struct NegativeEffect
+	{
+		const Predicate* predicate_;
+		std::vector<unsigned int> action_variables_;
+	};
+	
+	/**
+	 * Find the persistent facts which can be deleted by one of the negative effects, paired with that effect.
+	 */
+	void getDeletablePersistentFacts(std::vector<std::pair<const ReachableFact*, const NegativeEffect*> >& deletable_facts, const std::vector<const ReachableFact*>& persistent_facts) const;
+	
+	bool generateReachableFacts(const EquivalentObjectGroupManager& eog_manager, std::vector<const ReachableFact*>& preconditions, std::vector<EquivalentObjectGroup*>& current_variable_assignments, unsigned int precondition_index, MyPOP::REACHABILITY::ReachableFactLayer& new_fact_layer, const std::vector<std::pair<const ReachableFact*, const NegativeEffect*> >& deletable_persistent_facts);
+	
+	/**
+	 * Two preconditions of the transition which cannot both be true if the same object of a property space appears at the 
+	 * positions of properties of that space. Unless both preconditions are the same atom.
+	 */
+	struct MutexPreconditions
+	{
+		std::vector<unsigned int> lhs_action_variables_;
+		std::vector<unsigned int> rhs_action_variables_;
+		unsigned int lhs_position_;
+		unsigned int rhs_position_;
+		unsigned int property_space_;
+		
+		// If the preconditions share the property they can only be both true if they are the same atom.
+		bool is_same_property_;
+	};
+	
+	/**
+	 * @return True if the assignments make two preconditions true which are mutually exclusive.
+	 */
+	bool isMutex(const std::vector<EquivalentObjectGroup*>& variable_assignments) const;
 //	void generateReachableFacts(const MyPOP::REACHABILITY::EquivalentObjectGroupManager& eog_manager, std::vector< const MyPOP::REACHABILITY::AchievingTransition* >& newly_created_reachable_facts, std::vector< const MyPOP::REACHABILITY::ReachableFact* >& preconditions, std::vector< MyPOP::REACHABILITY::EquivalentObjectGroup* >& current_variable_assignments, unsigned int precondition_index, const MyPOP::REACHABILITY::ReachableFactLayer& fact_layer);
 	
 	const HEURISTICS::LiftedTransition* transition_;
 	const std::vector<ReachableSet*>* preconditions_reachable_sets_;
 	const std::vector<ReachableSet*>* effect_reachable_sets_;
 	
+	// The mappings from the terms of the facts to the action variables, indexed like the precondition and effect reachable sets. 
+	// These are looked up once when the transition is created, so the joins do not have to search for them.
+	std::vector<const std::vector<std::vector<unsigned int>* >*> precondition_mappings_;
+	std::vector<const std::vector<std::vector<unsigned int>* >*> effect_mappings_;
+	
+	std::vector<NegativeEffect> negative_effects_;
+	
+	const PropertySpaceMutexes* property_space_mutexes_;
+	std::vector<MutexPreconditions> mutex_preconditions_;
+	
 	// Cache all the groups which have been processed so we do not create the same reachable facts from this
 	// node over and over again.
 	std::vector<const std::vector<EquivalentObjectGroup*>*> processed_groups_;
@@ -679,6 +758,8 @@ private:
 
 	EquivalentObjectGroupManager* equivalent_object_manager_;
 	
+	PropertySpaceMutexes* property_space_mutexes_;
+	
 	ReachableFactLayer* current_fact_layer_;
 	
 	std::map<const HEURISTICS::FactSet*, ReachableSet*> fact_set_to_reachable_set_;
@@ -686,6 +767,9 @@ private:
 	const PredicateManager* predicate_manager_;
 	
 	bool fully_grounded_;
+	
+	// The facts reachable from the dead ends found so far, states covered by these are dead ends as well.
+	HEURISTICS::NogoodStore nogood_store_;
 };
 
 };
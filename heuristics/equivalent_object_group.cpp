@@ -1,6 +1,7 @@
 #include <cstring>
 #include <iterator>
 #include <sys/time.h>
+#include <boost/functional/hash.hpp>
 
 #include "equivalent_object_group.h"
 #include "dtg_reachability.h"
@@ -169,18 +170,20 @@ EquivalentObjectGroup::EquivalentObjectGroup(const std::vector<EquivalentObjectG
 */
 
 EquivalentObjectGroup::EquivalentObjectGroup(const std::vector<const HEURISTICS::FactSet*>& all_fact_sets, const std::vector<EquivalentObjectGroup*>& all_eogs, const Object* object)
-	: is_not_part_of_property_state_(true), link_(NULL), finger_print_(NULL), merged_at_iteration_(std::numeric_limits<unsigned int>::max()), can_merge_(true)
+	: is_not_part_of_property_state_(true), link_(NULL), finger_print_(NULL), finger_print_hash_(0), merged_at_iteration_(std::numeric_limits<unsigned int>::max()), nr_iterations_(0), can_merge_(true)
 {
 	finger_print_id_ = std::numeric_limits<unsigned int>::max();
 	if (object != NULL)
 	{
 		initialiseFingerPrint(all_fact_sets, *object);
 		
-		// Check if another EOG exists with the same finger print.
+		// Check if another EOG exists with the same finger print, the hashes rule out most EOGs without comparing the finger prints.
 		for (std::vector<EquivalentObjectGroup*>::const_iterator ci = all_eogs.begin(); ci != all_eogs.end(); ci++)
 		{
-			if (finger_print_size_ == (*ci)->finger_print_size_ &&
-			    memcmp(finger_print_, (*ci)->finger_print_, finger_print_size_ * sizeof(bool)) == 0)
+			if (finger_print_hash_ == (*ci)->finger_print_hash_ &&
+			    (*ci)->finger_print_ != NULL &&
+			    finger_print_size_ == (*ci)->finger_print_size_ &&
+			    memcmp(finger_print_, (*ci)->finger_print_, getNumberOfFingerPrintWords(finger_print_size_) * sizeof(unsigned long)) == 0)
 			{
 				finger_print_id_ = (*ci)->finger_print_id_;
 				break;
@@ -224,7 +227,8 @@ void EquivalentObjectGroup::reset()
 	
 	merged_at_iteration_ = std::numeric_limits<unsigned int>::max();
 	reachable_facts_.clear();
-	size_per_iteration_.clear();
+	size_before_iteration_.clear();
+	nr_iterations_ = 0;
 	can_merge_ = true;
 }
 /*
@@ -301,8 +305,9 @@ bool EquivalentObjectGroup::contains(const Object& object, unsigned int iteratio
 	}
 	else
 	{
-		assert (size_per_iteration_.size() > iteration);
-		for (unsigned int i = 0; i < size_per_iteration_[iteration]; i++)
+		assert (nr_iterations_ > iteration);
+		unsigned int size = getSizeAtLayer(iteration);
+		for (unsigned int i = 0; i < size; i++)
 		{
 			if (&equivalent_objects_[i]->getObject() == &object) return true;
 		}
@@ -336,6 +341,11 @@ bool EquivalentObjectGroup::hasSameFingerPrint(const EquivalentObjectGroup& othe
 //	return true;
 }
 
+unsigned int EquivalentObjectGroup::getNumberOfFingerPrintWords(unsigned int finger_print_size)
+{
+	return (finger_print_size + sizeof(unsigned long) * 8 - 1) / (sizeof(unsigned long) * 8);
+}
+
 void EquivalentObjectGroup::initialiseFingerPrint(const std::vector<const HEURISTICS::FactSet*>& fact_sets, const Object& object)
 {
 	// Check the DTG graph and check which DTG nodes an object can be part of based on its type.
@@ -362,8 +372,9 @@ void EquivalentObjectGroup::initialiseFingerPrint(const std::vector<const HEURIS
 */
 
 	finger_print_size_ = number_of_facts;
-	finger_print_ = new bool[number_of_facts];
-	memset(&finger_print_[0], false, sizeof(bool) * number_of_facts);
+	unsigned int number_of_words = getNumberOfFingerPrintWords(number_of_facts);
+	finger_print_ = new unsigned long[number_of_words];
+	memset(&finger_print_[0], 0, sizeof(unsigned long) * number_of_words);
 	
 	number_of_facts = 0;
 	
@@ -379,7 +390,7 @@ void EquivalentObjectGroup::initialiseFingerPrint(const std::vector<const HEURIS
 				const HEURISTICS::VariableDomain* variable_domain = *ci;
 				if (variable_domain->contains(object))
 				{
-					finger_print_[number_of_facts] = true;
+					finger_print_[number_of_facts / (sizeof(unsigned long) * 8)] |= 1UL << (number_of_facts % (sizeof(unsigned long) * 8));
 				}
 				
 				++number_of_facts;
@@ -387,6 +398,8 @@ void EquivalentObjectGroup::initialiseFingerPrint(const std::vector<const HEURIS
 		}
 	}
 	
+	finger_print_hash_ = boost::hash_range(finger_print_, finger_print_ + number_of_words);
+	
 /*
 	for (std::vector<SAS_Plus::DomainTransitionGraphNode*>::const_iterator ci = dtg_graph.getNodes().begin(); ci != dtg_graph.getNodes().end(); ci++)
 	{
@@ -546,8 +559,17 @@ bool EquivalentObjectGroup::tryToMergeWith(EquivalentObjectGroup& other_group, s
 		return false;
 	}
 	
-	merge(other_group, affected_groups);
-	other_group.merged_at_iteration_ = iteration;
+	// Link the smaller group to the larger one to keep the chains of links short.
+	if (other_group.equivalent_objects_.size() > equivalent_objects_.size())
+	{
+		other_group.merge(*this, affected_groups, iteration);
+		merged_at_iteration_ = iteration;
+	}
+	else
+	{
+		merge(other_group, affected_groups, iteration);
+		other_group.merged_at_iteration_ = iteration;
+	}
 	return true;
 }
 
@@ -589,15 +611,16 @@ void EquivalentObjectGroup::printObjects(std::ostream& os, unsigned int iteratio
 	}
 	else
 	{
-		if (size_per_iteration_.size() <= iteration)
+		if (nr_iterations_ <= iteration)
 		{
-			std::cout << "Check for the objects at iteration: " << iteration << " but " << *this << " only has " << size_per_iteration_.size() << " iterations!" << std::endl;
+			std::cout << "Check for the objects at iteration: " << iteration << " but " << *this << " only has " << nr_iterations_ << " iterations!" << std::endl;
 			assert (false);
 		}
-		for (unsigned int i = 0; i < size_per_iteration_[iteration]; i++)
+		unsigned int size = getSizeAtLayer(iteration);
+		for (unsigned int i = 0; i < size; i++)
 		{
 			os << equivalent_objects_[i]->getObject();
-			if (i + 1 != size_per_iteration_[iteration])
+			if (i + 1 != size)
 			{
 				os << ", ";
 			}
@@ -613,7 +636,7 @@ void EquivalentObjectGroup::printGrounded(std::ostream& os) const
 //	}
 }
 */
-void EquivalentObjectGroup::merge(EquivalentObjectGroup& other_group, std::vector<EquivalentObjectGroup*>& affected_groups)
+void EquivalentObjectGroup::merge(EquivalentObjectGroup& other_group, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration)
 {
 	assert (other_group.link_ == NULL);
 	
@@ -621,6 +644,10 @@ void EquivalentObjectGroup::merge(EquivalentObjectGroup& other_group, std::vecto
 	std::cout << "Merging " << *this << "(" << this << ") with " << other_group << "." << std::endl;
 #endif
 	assert (finger_print_ != NULL);
+	if (size_before_iteration_.empty() || size_before_iteration_.back().first != iteration)
+	{
+		size_before_iteration_.push_back(std::make_pair(iteration, equivalent_objects_.size()));
+	}
 	equivalent_objects_.insert(equivalent_objects_.end(), other_group.equivalent_objects_.begin(), other_group.equivalent_objects_.end());
 	other_group.link_ = this;
 	
@@ -746,13 +773,13 @@ void EquivalentObjectGroup::deleteRemovedFacts()
 	}
 }
 
-void EquivalentObjectGroup::updateEquivalences(const std::vector<EquivalentObjectGroup*>& all_eogs, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration)
+void EquivalentObjectGroup::updateEquivalences(const std::vector<EquivalentObjectGroup*>& candidate_eogs, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration)
 {
 	// If we are not a root node, we cannot merge this EOG.
 	if (isRootNode())
 	{
 		// Try to merge this EOG with any other root EOG.
-		for (std::vector<EquivalentObjectGroup*>::const_iterator ci = all_eogs.begin(); ci != all_eogs.end(); ci++)
+		for (std::vector<EquivalentObjectGroup*>::const_iterator ci = candidate_eogs.begin(); ci != candidate_eogs.end(); ci++)
 		{
 			EquivalentObjectGroup* eog = *ci;
 			if (!eog->isRootNode()) continue;
@@ -761,68 +788,61 @@ void EquivalentObjectGroup::updateEquivalences(const std::vector<EquivalentObjec
 		}
 	}
 	
-	assert (size_per_iteration_.size() == iteration);
-	size_per_iteration_.push_back(equivalent_objects_.size());
+	assert (nr_iterations_ == iteration);
+	++nr_iterations_;
 }
 
-std::vector<EquivalentObject*>::const_iterator EquivalentObjectGroup::begin(unsigned int layer_level) const
+unsigned int EquivalentObjectGroup::getSizeAtLayer(unsigned int layer_level) const
 {
-	if (merged_at_iteration_ <= layer_level)
-	{
-		assert (link_ != NULL);
-		return link_->begin(layer_level);
-	}
-	else
+	// Find the first iteration after the given layer in which other groups were merged with this one.
+	unsigned int low = 0;
+	unsigned int high = size_before_iteration_.size();
+	while (low < high)
 	{
-		if (size_per_iteration_.size() <= layer_level)
+		unsigned int middle = (low + high) / 2;
+		if (size_before_iteration_[middle].first <= layer_level)
 		{
-			std::cout << "Check for the objects at iteration: " << layer_level << " but " << *this << " only has " << size_per_iteration_.size() << " iterations!" << std::endl;
-			assert (false);
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
 		}
-		return equivalent_objects_.begin();
 	}
+	
+	if (low == size_before_iteration_.size())
+	{
+		return equivalent_objects_.size();
+	}
+	return size_before_iteration_[low].second;
+}
+
+std::vector<EquivalentObject*>::const_iterator EquivalentObjectGroup::begin(unsigned int layer_level) const
+{
+	return getEOGAtLayer(layer_level).equivalent_objects_.begin();
 }
 
 std::vector<EquivalentObject*>::const_iterator EquivalentObjectGroup::end(unsigned int layer_level) const
 {
-	if (merged_at_iteration_ <= layer_level)
-	{
-		assert (link_ != NULL);
-		return link_->end(layer_level);
-	}
-	else
-	{
-		if (size_per_iteration_.size() <= layer_level)
-		{
-			std::cout << "Check for the objects at iteration: " << layer_level << " but " << *this << " only has " << size_per_iteration_.size() << " iterations!" << std::endl;
-			assert (false);
-		}
-		if (equivalent_objects_.size() < size_per_iteration_[layer_level])
-		{
-			std::cout << "Problem with: " << *this << std::endl;
-			printObjects(std::cout, layer_level);
-			std::cout << "We claim to have " << size_per_iteration_[layer_level] << " but in actuality there are " << equivalent_objects_.size() << std::endl;
-			assert (false);
-		}
-		return equivalent_objects_.begin() + size_per_iteration_[layer_level];
-	}
+	const EquivalentObjectGroup& eog = getEOGAtLayer(layer_level);
+	return eog.equivalent_objects_.begin() + eog.getSizeAtLayer(layer_level);
 }
 
 const EquivalentObjectGroup& EquivalentObjectGroup::getEOGAtLayer(unsigned int layer_level) const
 {
-	if (merged_at_iteration_ <= layer_level)
+	const EquivalentObjectGroup* eog = this;
+	while (eog->merged_at_iteration_ <= layer_level)
 	{
-		return link_->getEOGAtLayer(layer_level);
+		assert (eog->link_ != NULL);
+		eog = eog->link_;
 	}
-	else
+	
+	if (eog->nr_iterations_ <= layer_level)
 	{
-		if (size_per_iteration_.size() <= layer_level)
-		{
-			std::cout << "Check for the objects at iteration: " << layer_level << " but " << *this << " only has " << size_per_iteration_.size() << " iterations!" << std::endl;
-			assert (false);
-		}
-		return *this;
+		std::cout << "Check for the objects at iteration: " << layer_level << " but " << *eog << " only has " << eog->nr_iterations_ << " iterations!" << std::endl;
+		assert (false);
 	}
+	return *eog;
 }
 
 EquivalentObjectGroup& EquivalentObjectGroup::getRootNode()
@@ -863,9 +883,9 @@ std::ostream& operator<<(std::ostream& os, const EquivalentObjectGroup& group)
 	
 	/*
 	os << "Merged at iteration: " << group.merged_at_iteration_ << std::endl;
-	for (std::vector<unsigned int>::const_iterator ci = group.size_per_iteration_.begin(); ci != group.size_per_iteration_.end(); ci++)
+	for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator ci = group.size_before_iteration_.begin(); ci != group.size_before_iteration_.end(); ci++)
 	{
-		os << "PI: " << *ci << std::endl;
+		os << "Size before " << (*ci).first << ": " << (*ci).second << std::endl;
 	}
 	
 
@@ -933,6 +953,12 @@ EquivalentObjectGroupManager::EquivalentObjectGroupManager(const std::vector<con
 	zero_arity_equivalent_object_group_ = new EquivalentObjectGroup(all_fact_sets, equivalent_groups_, NULL);
 	equivalent_groups_.push_back(zero_arity_equivalent_object_group_);
 	
+	// EOGs can only be merged if their finger prints match, so we only need to try to merge EOGs in the same bucket.
+	for (std::vector<EquivalentObjectGroup*>::const_iterator ci = equivalent_groups_.begin(); ci != equivalent_groups_.end(); ci++)
+	{
+		finger_print_buckets_[(*ci)->getFingerPrintId()].push_back(*ci);
+	}
+	
 #ifdef MYPOP_SAS_PLUS_EQUIAVLENT_OBJECT_COMMENT
 	std::cout << "Done initialising data structures." << std::endl;
 #endif
@@ -988,7 +1014,7 @@ void EquivalentObjectGroupManager::updateEquivalences(unsigned int iteration)
 	for (std::vector<EquivalentObjectGroup*>::const_iterator ci = equivalent_groups_.begin(); ci != equivalent_groups_.end(); ci++)
 	{
 		EquivalentObjectGroup* eog = *ci;
-		eog->updateEquivalences(equivalent_groups_, affected_groups, iteration);
+		eog->updateEquivalences(finger_print_buckets_[eog->getFingerPrintId()], affected_groups, iteration);
 	}
 
 	for (std::vector<EquivalentObjectGroup*>::const_iterator ci = affected_groups.begin(); ci != affected_groups.end(); ci++)
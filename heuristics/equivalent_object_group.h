@@ -7,6 +7,7 @@
 #include <set>
 #include <assert.h>
 #include <stdio.h>
+#include <cstddef>
 
 namespace MyPOP {
 
@@ -111,6 +112,11 @@ public:
 	
 	bool hasSameFingerPrint(const EquivalentObjectGroup& other) const;
 	
+	/**
+	 * Groups with the same finger print share the same id, only those groups can be merged.
+	 */
+	unsigned int getFingerPrintId() const { return finger_print_id_; }
+	
 	const std::vector<ReachableFact*>& getReachableFacts() const { return reachable_facts_; }
 	
 	bool operator==(const EquivalentObjectGroup& other) const;
@@ -129,11 +135,19 @@ public:
 	 */
 	void deleteRemovedFacts();
 	
-	void updateEquivalences(const std::vector<EquivalentObjectGroup*>& all_eogs, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration);
+	/**
+	 * Try to merge this EOG with the given candidates, these should have the same finger print as this EOG.
+	 */
+	void updateEquivalences(const std::vector<EquivalentObjectGroup*>& candidate_eogs, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration);
 	
 	std::vector<EquivalentObject*>::const_iterator begin(unsigned int layer_level) const;
 	std::vector<EquivalentObject*>::const_iterator end(unsigned int layer_level) const;
 	//unsigned int getNumberOfEquivalentObjects(unsigned int layer_level) const;
+	
+	/**
+	 * Groups are merged by size, so the chain of links to follow is at most logarithmic in the number of objects.
+	 * @return The root node of this EOG at the given layer.
+	 */
 	const EquivalentObjectGroup& getEOGAtLayer(unsigned int layer_level) const;
 	
 	/**
@@ -183,20 +197,30 @@ private:
 	/**
 	 * Merge the given group with this group.
 	 */
-	void merge(EquivalentObjectGroup& other_group, std::vector<EquivalentObjectGroup*>& affected_groups);
+	void merge(EquivalentObjectGroup& other_group, std::vector<EquivalentObjectGroup*>& affected_groups, unsigned int iteration);
+	
+	/**
+	 * @return The number of equivalent objects of this EOG at the given layer, this EOG must be a root node at that layer.
+	 */
+	unsigned int getSizeAtLayer(unsigned int layer_level) const;
 	
 	// We only allow objects to be made equivalent if their finger prints match. The finger print is based on the object's membership in the 
-	// lifted transition graph nodes.
-	bool* finger_print_;
+	// lifted transition graph nodes, every membership is a bit which are packed into words.
+	unsigned long* finger_print_;
 	unsigned int finger_print_size_;
+	std::size_t finger_print_hash_;
+	
+	static unsigned int getNumberOfFingerPrintWords(unsigned int finger_print_size);
 	
 	static unsigned int max_finger_print_id_;
 	unsigned int finger_print_id_;
 	
 	// We keep track of both the size and when this EOG was merged. That way we can reconstruct the reachable facts 
-	// which have been made true during each iteration.
+	// which have been made true during each iteration. The size only changes when other groups are merged into this 
+	// one, so we only store the iterations in which that happened together with the size before the first merge.
 	unsigned int merged_at_iteration_;
-	std::vector<unsigned int> size_per_iteration_;
+	std::vector<std::pair<unsigned int, unsigned int> > size_before_iteration_;
+	unsigned int nr_iterations_;
 	
 	bool can_merge_;
 
@@ -254,6 +278,9 @@ private:
 	std::map<const Object*, EquivalentObject*> object_to_equivalent_object_mapping_;
 	std::vector<EquivalentObjectGroup*> equivalent_groups_;
 	
+	// The EOGs bucketed by their finger print id, only EOGs in the same bucket can ever be merged.
+	std::map<unsigned int, std::vector<EquivalentObjectGroup*> > finger_print_buckets_;
+	
 	EquivalentObjectGroup* zero_arity_equivalent_object_group_;
 	
 	friend std::ostream& operator<<(std::ostream& os, const EquivalentObjectGroupManager& group);
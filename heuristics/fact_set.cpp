@@ -8,6 +8,10 @@
 
 #include <set>
 #include <map>
+#include <iterator>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
 #include <predicate_manager.h>
 
 //#define MYPOP_HEURISTICS_LIFTED_TRANSITION_COMMENTS
@@ -17,78 +21,195 @@ namespace MyPOP {
 
 namespace HEURISTICS {
 
-VariableDomain::VariableDomain()
+namespace {
+
+// The number of pairs of domains for which a result is cached before the cache is cleared.
+const std::size_t MAX_CACHED_PAIRS = 1 << 20;
+
+// The number of interned sets before the unused sets are removed for the first time.
+const std::size_t MIN_INTERNED_DOMAINS = 1 << 12;
+
+};
+
+const VariableDomain::InternedDomain& VariableDomain::intern(const std::vector<const Object*>& objects)
 {
+	// The map is node based, so the interned domains can point to its keys.
+	static boost::unordered_map<std::vector<const Object*>, InternedDomain> interned_domains;
+	static std::size_t next_id = 0;
+	static std::size_t max_interned_domains = MIN_INTERNED_DOMAINS;
+	
+	boost::unordered_map<std::vector<const Object*>, InternedDomain>::iterator i = interned_domains.find(objects);
+	if (i != interned_domains.end())
+	{
+		return (*i).second;
+	}
+	
+	// Remove the sets which are no longer used, the limit grows with the sets which are still used so every set is checked
+	// a constant number of times on average.
+	if (interned_domains.size() >= max_interned_domains)
+	{
+		for (boost::unordered_map<std::vector<const Object*>, InternedDomain>::iterator domain_i = interned_domains.begin(); domain_i != interned_domains.end();)
+		{
+			if ((*domain_i).second.references_ == 0)
+			{
+				domain_i = interned_domains.erase(domain_i);
+			}
+			else
+			{
+				++domain_i;
+			}
+		}
+		max_interned_domains = std::max(MIN_INTERNED_DOMAINS, 2 * interned_domains.size());
+	}
 	
+	i = interned_domains.insert(std::make_pair(objects, InternedDomain())).first;
+	(*i).second.objects_ = &(*i).first;
+	(*i).second.hash_ = boost::hash_range(objects.begin(), objects.end());
+	(*i).second.id_ = next_id++;
+	(*i).second.references_ = 0;
+	return (*i).second;
+}
+
+VariableDomain::VariableDomain()
+	: domain_(NULL)
+{
+	setDomain(intern(std::vector<const Object*>()));
 }
 
 VariableDomain::VariableDomain(const std::vector<const Object*>& variable_domain)
+	: domain_(NULL)
+{
+	set(variable_domain);
+}
+
+VariableDomain::VariableDomain(const VariableDomain& other)
+	: domain_(NULL)
 {
-	variable_domain_.insert(variable_domain_.end(), variable_domain.begin(), variable_domain.end());
-	std::sort(variable_domain_.begin(), variable_domain_.end());
+	setDomain(*other.domain_);
 }
 
 VariableDomain::~VariableDomain()
 {
-	
+	--domain_->references_;
 }
 
-bool VariableDomain::sharesObjectsWith(const VariableDomain& rhs) const
+VariableDomain& VariableDomain::operator=(const VariableDomain& rhs)
 {
-	for (std::vector<const Object*>::const_iterator ci = variable_domain_.begin(); ci != variable_domain_.end(); ++ci)
+	setDomain(*rhs.domain_);
+	return *this;
+}
+
+void VariableDomain::setDomain(const InternedDomain& domain)
+{
+	++domain.references_;
+	if (domain_ != NULL)
 	{
-		const Object* object = *ci;
-		if (rhs.contains(*object))
-		{
-			return true;
-		}
+		--domain_->references_;
 	}
-	return false;
+	domain_ = &domain;
 }
 
-void VariableDomain::getIntersection(VariableDomain& result, const VariableDomain& rhs) const
+bool VariableDomain::sharesObjectsWith(const VariableDomain& rhs) const
 {
-	for (std::vector<const Object*>::const_iterator ci = variable_domain_.begin(); ci != variable_domain_.end(); ++ci)
+	static boost::unordered_map<std::pair<std::size_t, std::size_t>, bool> shares_objects_cache;
+	
+	std::pair<std::size_t, std::size_t> key(std::min(domain_->id_, rhs.domain_->id_), std::max(domain_->id_, rhs.domain_->id_));
+	boost::unordered_map<std::pair<std::size_t, std::size_t>, bool>::const_iterator ci = shares_objects_cache.find(key);
+	if (ci != shares_objects_cache.end())
 	{
-		const Object* object = *ci;
-		if (rhs.contains(*object))
+		return (*ci).second;
+	}
+	
+	// Both domains are ordered, so a single pass suffices.
+	bool shares_objects = false;
+	std::vector<const Object*>::const_iterator lhs_ci = domain_->objects_->begin();
+	std::vector<const Object*>::const_iterator rhs_ci = rhs.domain_->objects_->begin();
+	while (lhs_ci != domain_->objects_->end() && rhs_ci != rhs.domain_->objects_->end())
+	{
+		if (*lhs_ci < *rhs_ci)
+		{
+			++lhs_ci;
+		}
+		else if (*rhs_ci < *lhs_ci)
 		{
-			result.addObject(*object);
+			++rhs_ci;
+		}
+		else
+		{
+			shares_objects = true;
+			break;
 		}
 	}
+	
+	if (shares_objects_cache.size() >= MAX_CACHED_PAIRS)
+	{
+		shares_objects_cache.clear();
+	}
+	shares_objects_cache[key] = shares_objects;
+	return shares_objects;
 }
 
-bool VariableDomain::contains(const Object& object) const
+void VariableDomain::getIntersection(VariableDomain& result, const VariableDomain& rhs) const
 {
-	for (std::vector<const Object*>::const_iterator ci = variable_domain_.begin(); ci != variable_domain_.end(); ++ci)
+	// The cached intersections are variable domains themselves, so they are not removed while they are part of the cache.
+	static boost::unordered_map<std::pair<std::size_t, std::size_t>, VariableDomain> intersection_cache;
+	
+	std::pair<std::size_t, std::size_t> key(std::min(domain_->id_, rhs.domain_->id_), std::max(domain_->id_, rhs.domain_->id_));
+	boost::unordered_map<std::pair<std::size_t, std::size_t>, VariableDomain>::const_iterator ci = intersection_cache.find(key);
+	const InternedDomain* intersection = NULL;
+	if (ci != intersection_cache.end())
 	{
-		if (*ci == &object)
+		intersection = (*ci).second.domain_;
+	}
+	else
+	{
+		std::vector<const Object*> objects;
+		std::set_intersection(domain_->objects_->begin(), domain_->objects_->end(), rhs.domain_->objects_->begin(), rhs.domain_->objects_->end(), std::back_inserter(objects));
+		if (intersection_cache.size() >= MAX_CACHED_PAIRS)
 		{
-			return true;
+			intersection_cache.clear();
 		}
+		VariableDomain& cached_intersection = intersection_cache[key];
+		cached_intersection.setDomain(intern(objects));
+		intersection = cached_intersection.domain_;
 	}
 	
-	return false;
+	// The objects are added to the result.
+	if (result.size() == 0)
+	{
+		result.setDomain(*intersection);
+	}
+	else
+	{
+		std::vector<const Object*> objects;
+		std::set_union(result.domain_->objects_->begin(), result.domain_->objects_->end(), intersection->objects_->begin(), intersection->objects_->end(), std::back_inserter(objects));
+		result.setDomain(intern(objects));
+	}
+}
+
+bool VariableDomain::contains(const Object& object) const
+{
+	return std::binary_search(domain_->objects_->begin(), domain_->objects_->end(), &object);
 }
 
 void VariableDomain::set(const Object& object)
 {
-	variable_domain_.clear();
-	variable_domain_.push_back(&object);
+	setDomain(intern(std::vector<const Object*>(1, &object)));
 }
 
 void VariableDomain::set(const std::vector<const Object*>&  set)
 {
-	variable_domain_.clear();
-	variable_domain_.insert(variable_domain_.end(), set.begin(), set.end());
-	std::sort(variable_domain_.begin(), variable_domain_.end());
+	std::vector<const Object*> objects(set);
+	std::sort(objects.begin(), objects.end());
+	setDomain(intern(objects));
 }
 
 void VariableDomain::addObject(const Object& object)
 {
-	assert (std::find(variable_domain_.begin(), variable_domain_.end(), &object) == variable_domain_.end());
-	variable_domain_.push_back(&object);
-	std::sort(variable_domain_.begin(), variable_domain_.end());
+	assert (!contains(object));
+	std::vector<const Object*> objects(*domain_->objects_);
+	objects.insert(std::upper_bound(objects.begin(), objects.end(), &object), &object);
+	setDomain(intern(objects));
 }
 
 bool VariableDomain::operator!=(const VariableDomain& rhs) const
@@ -98,20 +219,7 @@ bool VariableDomain::operator!=(const VariableDomain& rhs) const
 
 bool VariableDomain::operator==(const VariableDomain& rhs) const
 {
-	if (variable_domain_.size() != rhs.variable_domain_.size())
-	{
-		return false;
-	}
-	
-	for (unsigned int i = 0; i < variable_domain_.size(); ++i)
-	{
-		if (variable_domain_[i] != rhs.variable_domain_[i])
-		{
-			return false;
-		}
-	}
-	
-	return true;
+	return domain_ == rhs.domain_;
 }
 
 std::ostream& operator<<(std::ostream& os, const VariableDomain& variable_domain)
@@ -450,7 +558,7 @@ std::ostream& operator<<(std::ostream& os, const FactSet& fact_set)
 	return os;
 }
 
-void LiftedTransition::createLiftedTransitions(std::vector<LiftedTransition*>& created_lifted_transitions, const PredicateManager& predicate_manager, const TermManager& term_manager, const TypeManager& type_manager, const Action& action, const std::vector<const Atom*>& initial_facts, const std::vector<const Object*>& part_of_property_state)
+void LiftedTransition::createLiftedTransitions(std::vector<LiftedTransition*>& created_lifted_transitions, const PredicateManager& predicate_manager, const TermManager& term_manager, const TypeManager& type_manager, const Action& action, const std::vector<const Atom*>& initial_facts, const std::vector<const Object*>& part_of_property_state, const std::set<const Object*>& irrelevant_objects)
 {
 #ifdef MYPOP_HEURISTICS_LIFTED_TRANSITION_COMMENTS
 	std::cout << "Create lifted transitions from the action: " << action << std::endl;
@@ -595,8 +703,8 @@ void LiftedTransition::createLiftedTransitions(std::vector<LiftedTransition*>& c
 	for (std::vector<const Variable*>::const_iterator ci = action.getVariables().begin(); ci != action.getVariables().end(); ++ci)
 	{
 		const Variable* action_variable = *ci;
-		std::vector<const Object*> objects_of_type;
-		type_manager.getObjectsOfType(objects_of_type, *action_variable->getType());
+		std::vector<const Object*>::const_iterator objects_of_type_begin, objects_of_type_end;
+		type_manager.getObjectsOfType(objects_of_type_begin, objects_of_type_end, *action_variable->getType());
 		
 		std::vector<const VariableDomain*>* action_variable_domain = new std::vector<const VariableDomain*>();
 		partially_grounded_action_variable_domains.push_back(action_variable_domain);
@@ -605,21 +713,20 @@ void LiftedTransition::createLiftedTransitions(std::vector<LiftedTransition*>& c
 		
 		// Split the objects up.
 		std::set<const Object*> processed_objects;
-		for (std::vector<const Object*>::const_iterator ci = objects_of_type.begin(); ci != objects_of_type.end(); ++ci)
+		for (std::vector<const Object*>::const_iterator ci = objects_of_type_begin; ci != objects_of_type_end; ++ci)
 		{
 			const Object* current_object = *ci;
 			
-			if (processed_objects.count(current_object) > 0)
+			// Objects which cannot contribute to the goals are not part of any variable domain.
+			if (processed_objects.count(current_object) > 0 || irrelevant_objects.count(current_object) > 0)
 			{
 				continue;
 			}
 			
 			processed_objects.insert(current_object);
 			
-			VariableDomain* current_variable_domain = new VariableDomain();
-			current_variable_domain->addObject(*current_object);
-			
-			action_variable_domain->push_back(current_variable_domain);
+			std::vector<const Object*> current_objects;
+			current_objects.push_back(current_object);
 			
 			// Find all objects which are equivalent to current_object.
 			std::pair<std::multimap<const Object*, const Object*>::const_iterator, std::multimap<const Object*, const Object*>::const_iterator > eq_objects_range;
@@ -632,14 +739,18 @@ void LiftedTransition::createLiftedTransitions(std::vector<LiftedTransition*>& c
 				const Object* equivalent_object = (*ci).second;
 				
 				if (equivalent_object->getType() != current_object->getType() ||
-				    processed_objects.count(equivalent_object) > 0)
+				    processed_objects.count(equivalent_object) > 0 ||
+				    irrelevant_objects.count(equivalent_object) > 0)
 				{
 					continue;
 				}
 				
-				current_variable_domain->addObject(*equivalent_object);
+				current_objects.push_back(equivalent_object);
 				processed_objects.insert(equivalent_object);
 			}
+			
+			// Intern the domain once instead of every time an object is added.
+			action_variable_domain->push_back(new VariableDomain(current_objects));
 		}
 	}
 	
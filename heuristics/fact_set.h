@@ -3,7 +3,9 @@
 
 #include <ostream>
 #include <map>
+#include <set>
 #include <vector>
+#include <cstddef>
 
 namespace MyPOP {
 
@@ -20,17 +22,36 @@ class GroundedAtom;
 
 namespace HEURISTICS {
 
+/**
+ * A set of objects a variable can be assigned to. The sets are interned: every distinct set of objects is stored once 
+ * together with its hash and never changes, variable domains only point to them. Two domains are equal iff they point to the
+ * same set and the results of sharesObjectsWith and getIntersection are cached for pairs of sets.
+ *
+ * The sets which no variable domain points to anymore are removed whenever the number of interned sets has doubled. The
+ * caches refer to the sets by an id which is never reused, so a removed set cannot be mistaken for a new one, and a cache is
+ * cleared once it holds too many pairs.
+ */
 class VariableDomain
 {
 public:
 	VariableDomain();
 	VariableDomain(const std::vector<const Object*>& variable_domain);
 	
+	VariableDomain(const VariableDomain& other);
+	
 	~VariableDomain();
 	
+	VariableDomain& operator=(const VariableDomain& rhs);
+	
 	void addObject(const Object& object);
-	unsigned int size() const { return variable_domain_.size(); }
-	const std::vector<const Object*>& getVariableDomain() const { return variable_domain_; }
+	unsigned int size() const { return domain_->objects_->size(); }
+	
+	/**
+	 * @return The objects of this domain, ordered by their address.
+	 */
+	const std::vector<const Object*>& getVariableDomain() const { return *domain_->objects_; }
+	
+	std::size_t getHash() const { return domain_->hash_; }
 	
 	bool sharesObjectsWith(const VariableDomain& rhs) const;
 	
@@ -45,7 +66,31 @@ public:
 	bool operator!=(const VariableDomain& rhs) const;
 	
 private:
-	std::vector<const Object*> variable_domain_;
+	
+	struct InternedDomain
+	{
+		const std::vector<const Object*>* objects_;
+		std::size_t hash_;
+		
+		// Unique for every set which has been interned.
+		std::size_t id_;
+		
+		// The number of variable domains which point to this set, the set is removed once it is no longer used.
+		mutable unsigned int references_;
+	};
+	
+	/**
+	 * @param objects A set of objects, ordered by their address.
+	 * @return The interned copy of the set.
+	 */
+	static const InternedDomain& intern(const std::vector<const Object*>& objects);
+	
+	/**
+	 * Point this domain to the given set, the set it pointed to before is removed if no other domain points to it.
+	 */
+	void setDomain(const InternedDomain& domain);
+	
+	const InternedDomain* domain_;
 	
 	friend std::ostream& operator<<(std::ostream& os, const VariableDomain& variable_domain);
 };
@@ -141,7 +186,7 @@ class LiftedTransition
 public:
 	~LiftedTransition();
 	
-	static void createLiftedTransitions(std::vector<LiftedTransition*>& created_lifted_transitions, const PredicateManager& predicate_manager, const TermManager& term_manager, const TypeManager& type_manager, const Action& action, const std::vector<const Atom*>& initial_facts, const std::vector<const Object*>& part_of_property_state);
+	static void createLiftedTransitions(std::vector<LiftedTransition*>& created_lifted_transitions, const PredicateManager& predicate_manager, const TermManager& term_manager, const TypeManager& type_manager, const Action& action, const std::vector<const Atom*>& initial_facts, const std::vector<const Object*>& part_of_property_state, const std::set<const Object*>& irrelevant_objects);
 	
 	static void mergeFactSets(const std::vector<LiftedTransition*>& all_lifted_transitions);
 	
@@ -39,6 +39,12 @@ void HeuristicInterface::deleteHelpfulActions()
 	helpful_actions_.clear();
 }
 
+void HeuristicInterface::takeHelpfulActions(HeuristicInterface& heuristic)
+{
+	deleteHelpfulActions();
+	helpful_actions_.swap(heuristic.helpful_actions_);
+}
+
 };
 
 };
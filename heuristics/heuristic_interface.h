@@ -32,6 +32,11 @@ public:
 	
 protected:
 	
+	/**
+	 * Replace the helpful actions of this heuristic by those of the given heuristic, which will no longer have any.
+	 */
+	void takeHelpfulActions(HeuristicInterface& heuristic);
+	
 	std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > > helpful_actions_;
 };
 
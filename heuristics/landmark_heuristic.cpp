@@ -0,0 +1,480 @@
+#include "landmark_heuristic.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstring>
+#include <iostream>
+
+#include "dtg_reachability.h"
+#include "fc_planner.h"
+#include "action_manager.h"
+#include "formula.h"
+#include "parser_utils.h"
+#include "predicate_manager.h"
+#include "term_manager.h"
+#include "type_manager.h"
+
+//#define MYPOP_HEURISTICS_LANDMARK_HEURISTIC_COMMENTS
+
+namespace MyPOP {
+
+namespace HEURISTICS {
+
+LandmarkHeuristic::LandmarkHeuristic(REACHABILITY::DTGReachability& reachability, const ActionManager& action_manager, bool combine_with_ff)
+	: reachability_(&reachability), action_manager_(&action_manager), combine_with_ff_(combine_with_ff)
+{
+
+}
+
+LandmarkHeuristic::~LandmarkHeuristic()
+{
+	deleteHelpfulActions();
+	delete reachability_;
+}
+
+void LandmarkHeuristic::setHeuristicForState(MyPOP::State& state, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added)
+{
+	// The helpful actions are only replaced if they are asked for, the planner uses those of the state it expands while the
+	// successors of that state are evaluated.
+	if (combine_with_ff_)
+	{
+		reachability_->setHeuristicForState(state, initial_facts, goal_facts, term_manager, find_helpful_actions, allow_new_goals_to_be_added);
+		if (find_helpful_actions)
+		{
+			takeHelpfulActions(*reachability_);
+		}
+	}
+	else if (find_helpful_actions)
+	{
+		deleteHelpfulActions();
+	}
+
+	// The landmarks only need to be extracted again if the goals change, e.g. when following a goal agenda.
+	std::vector<unsigned int> goal_ids;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+	{
+		goal_ids.push_back((*ci)->getId());
+	}
+	std::sort(goal_ids.begin(), goal_ids.end());
+
+	if (goal_ids != goal_ids_)
+	{
+		// The lifted relaxed planning graph is needed to ignore achievers which can never be executed.
+		if (!combine_with_ff_)
+		{
+			reachability_->setHeuristicForState(state, initial_facts, goal_facts, term_manager, false, allow_new_goals_to_be_added);
+			reachability_->deleteHelpfulActions();
+		}
+
+		std::vector<const GroundedAtom*> state_facts;
+		state.getFacts(initial_facts, state_facts);
+		extractLandmarks(state_facts, goal_facts);
+		goal_ids_.swap(goal_ids);
+	}
+
+	boost::dynamic_bitset<> accepted;
+	getAcceptedLandmarks(accepted, state, initial_facts);
+	state.setAcceptedLandmarks(accepted);
+	
+	unsigned int h = getLandmarkCount(state, accepted, initial_facts);
+	if (combine_with_ff_)
+	{
+		h = std::max(h, state.getHeuristic());
+	}
+	state.setDistanceToGoal(h);
+}
+
+void LandmarkHeuristic::getFunctionalSymmetricSets(std::multimap<const Object*, const Object*>& symmetrical_groups, const State& state, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager) const
+{
+	reachability_->getFunctionalSymmetricSets(symmetrical_groups, state, initial_facts, goal_facts, term_manager);
+}
+
+void LandmarkHeuristic::extractLandmarks(const std::vector<const GroundedAtom*>& state_facts, const std::vector<const GroundedAtom*>& goal_facts)
+{
+	landmarks_.clear();
+	landmark_indexes_.clear();
+	predecessors_.clear();
+	is_goal_.clear();
+	is_reachable_.clear();
+	predicates_in_graph_.clear();
+
+	for (const REACHABILITY::ReachableFactLayer* fact_layer = reachability_->getLastFactLayer(); fact_layer != NULL; fact_layer = fact_layer->getPreviousLayer())
+	{
+		for (std::vector<REACHABILITY::ReachableFactLayerItem*>::const_iterator ci = fact_layer->getReachableFacts().begin(); ci != fact_layer->getReachableFacts().end(); ++ci)
+		{
+			predicates_in_graph_.insert((*ci)->getReachableFactCopy().getPredicate().getName());
+		}
+	}
+
+	// The grounded atoms of the landmarks, indexed by the landmark index.
+	std::vector<const GroundedAtom*> landmark_facts;
+	std::vector<unsigned int> open_list;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+	{
+		bool is_new;
+		unsigned int landmark_index = addLandmark(**ci, is_new);
+		is_goal_[landmark_index] = true;
+		if (is_new)
+		{
+			landmark_facts.push_back(*ci);
+			open_list.push_back(landmark_index);
+		}
+	}
+
+	unsigned int nr_orderings = 0;
+	while (!open_list.empty())
+	{
+		unsigned int landmark_index = open_list.back();
+		open_list.pop_back();
+		const GroundedAtom* landmark = landmark_facts[landmark_index];
+
+		// Landmarks which are already true do not need to be achieved.
+		if (std::binary_search(state_facts.begin(), state_facts.end(), landmark))
+		{
+			continue;
+		}
+
+		std::vector<const GroundedAtom*> shared_preconditions;
+		if (!getSharedPreconditions(shared_preconditions, *landmark, state_facts))
+		{
+#ifdef MYPOP_HEURISTICS_LANDMARK_HEURISTIC_COMMENTS
+			std::cout << "The landmark " << *landmark << " has no achievers." << std::endl;
+#endif
+			continue;
+		}
+
+		for (std::vector<const GroundedAtom*>::const_iterator ci = shared_preconditions.begin(); ci != shared_preconditions.end(); ++ci)
+		{
+			const GroundedAtom* precondition = *ci;
+			if (precondition == landmark)
+			{
+				continue;
+			}
+
+			bool is_new;
+			unsigned int precondition_index = addLandmark(*precondition, is_new);
+			if (is_new)
+			{
+				landmark_facts.push_back(precondition);
+				open_list.push_back(precondition_index);
+			}
+
+			if (std::find(predecessors_[landmark_index].begin(), predecessors_[landmark_index].end(), precondition_index) == predecessors_[landmark_index].end())
+			{
+				predecessors_[landmark_index].push_back(precondition_index);
+				++nr_orderings;
+			}
+		}
+	}
+
+#ifdef MYPOP_HEURISTICS_LANDMARK_HEURISTIC_COMMENTS
+	std::cout << "Landmarks: " << landmarks_.size() << "; orderings: " << nr_orderings << "." << std::endl;
+	std::cout << *this << std::endl;
+#endif
+}
+
+bool LandmarkHeuristic::getSharedPreconditions(std::vector<const GroundedAtom*>& shared_preconditions, const GroundedAtom& landmark, const std::vector<const GroundedAtom*>& state_facts)
+{
+	bool found_achiever = false;
+	for (std::vector<Action*>::const_iterator ci = action_manager_->getManagableObjects().begin(); ci != action_manager_->getManagableObjects().end(); ++ci)
+	{
+		const Action* action = *ci;
+
+		std::vector<const Atom*> preconditions;
+		Utility::convertFormula(preconditions, &action->getPrecondition());
+
+		for (std::vector<const Atom*>::const_iterator ci = action->getEffects().begin(); ci != action->getEffects().end(); ++ci)
+		{
+			const Atom* effect = *ci;
+			if (effect->isNegative() ||
+			    effect->getArity() != landmark.getPredicate().getArity() ||
+			    effect->getPredicate().getName() != landmark.getPredicate().getName())
+			{
+				continue;
+			}
+
+			// Bind the action variables to the objects of the landmark.
+			const Object* assigned_variables[action->getVariables().size()];
+			memset(assigned_variables, 0, sizeof(Object*) * action->getVariables().size());
+			bool can_unify = true;
+			for (unsigned int term_index = 0; term_index < effect->getArity(); ++term_index)
+			{
+				const Object& object = landmark.getObject(term_index);
+				const Term* term = effect->getTerms()[term_index];
+				unsigned int action_variable_index = action->getActionVariable(*term);
+
+				if (action_variable_index == std::numeric_limits<unsigned int>::max())
+				{
+					can_unify = term == &object;
+				}
+				else if (assigned_variables[action_variable_index] != NULL)
+				{
+					can_unify = assigned_variables[action_variable_index] == &object;
+				}
+				else
+				{
+					const Type* type = action->getVariables()[action_variable_index]->getType();
+					can_unify = type == NULL || object.getType() == NULL || object.getType()->isEqual(*type) || object.getType()->isSubtypeOf(*type);
+					assigned_variables[action_variable_index] = &object;
+				}
+
+				if (!can_unify)
+				{
+					break;
+				}
+			}
+
+			if (!can_unify)
+			{
+				continue;
+			}
+
+			// The preconditions whose variables are all bound are shared by all the groundings of this achiever.
+			std::vector<const GroundedAtom*> achiever_preconditions;
+			bool is_executable = true;
+			for (std::vector<const Atom*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+			{
+				const Atom* precondition = *ci;
+				if (precondition->isNegative())
+				{
+					continue;
+				}
+
+				const Object* precondition_objects[precondition->getArity()];
+				bool is_bound = true;
+				for (unsigned int term_index = 0; term_index < precondition->getArity(); ++term_index)
+				{
+					const Term* term = precondition->getTerms()[term_index];
+					unsigned int action_variable_index = action->getActionVariable(*term);
+					if (action_variable_index == std::numeric_limits<unsigned int>::max())
+					{
+						precondition_objects[term_index] = static_cast<const Object*>(term);
+					}
+					else if (assigned_variables[action_variable_index] != NULL)
+					{
+						precondition_objects[term_index] = assigned_variables[action_variable_index];
+					}
+					else
+					{
+						is_bound = false;
+						break;
+					}
+				}
+
+				if (!is_bound)
+				{
+					continue;
+				}
+
+				const GroundedAtom& grounded_precondition = GroundedAtom::getGroundedAtom(precondition->getPredicate(), precondition_objects);
+				if (!isReachable(grounded_precondition, state_facts))
+				{
+					is_executable = false;
+					break;
+				}
+				achiever_preconditions.push_back(&grounded_precondition);
+			}
+
+			if (!is_executable)
+			{
+				continue;
+			}
+
+			std::sort(achiever_preconditions.begin(), achiever_preconditions.end());
+			achiever_preconditions.erase(std::unique(achiever_preconditions.begin(), achiever_preconditions.end()), achiever_preconditions.end());
+
+			if (!found_achiever)
+			{
+				shared_preconditions.swap(achiever_preconditions);
+				found_achiever = true;
+			}
+			else
+			{
+				std::vector<const GroundedAtom*> intersection;
+				std::set_intersection(shared_preconditions.begin(), shared_preconditions.end(), achiever_preconditions.begin(), achiever_preconditions.end(), std::back_inserter(intersection));
+				shared_preconditions.swap(intersection);
+			}
+		}
+	}
+	return found_achiever;
+}
+
+bool LandmarkHeuristic::isReachable(const GroundedAtom& fact, const std::vector<const GroundedAtom*>& state_facts)
+{
+	boost::unordered_map<unsigned int, bool>::const_iterator ci = is_reachable_.find(fact.getId());
+	if (ci != is_reachable_.end())
+	{
+		return (*ci).second;
+	}
+
+	bool is_reachable = std::binary_search(state_facts.begin(), state_facts.end(), &fact) || predicates_in_graph_.count(fact.getPredicate().getName()) == 0;
+	for (const REACHABILITY::ReachableFactLayer* fact_layer = reachability_->getLastFactLayer(); fact_layer != NULL && !is_reachable; fact_layer = fact_layer->getPreviousLayer())
+	{
+		is_reachable = fact_layer->contains(fact) != NULL;
+	}
+
+	is_reachable_[fact.getId()] = is_reachable;
+	return is_reachable;
+}
+
+unsigned int LandmarkHeuristic::addLandmark(const GroundedAtom& fact, bool& is_new)
+{
+	boost::unordered_map<unsigned int, unsigned int>::const_iterator ci = landmark_indexes_.find(fact.getId());
+	if (ci != landmark_indexes_.end())
+	{
+		is_new = false;
+		return (*ci).second;
+	}
+
+	is_new = true;
+	unsigned int landmark_index = landmarks_.size();
+	landmarks_.push_back(fact.getId());
+	landmark_indexes_[fact.getId()] = landmark_index;
+	predecessors_.push_back(std::vector<unsigned int>());
+	is_goal_.push_back(false);
+	return landmark_index;
+}
+
+void LandmarkHeuristic::getAcceptedLandmarks(boost::dynamic_bitset<>& accepted, const State& state, const std::vector<const GroundedAtom*>& initial_facts) const
+{
+	// States whose heuristic value is taken from a transposition table have not stored their accepted landmarks, and those
+	// stored before the landmarks were extracted again are of no use.
+	std::vector<const State*> path;
+	const State* path_state = &state;
+	while (!hasAcceptedLandmarks(*path_state) && path_state->getParent() != NULL)
+	{
+		path.push_back(path_state);
+		path_state = path_state->getParent();
+	}
+
+	if (hasAcceptedLandmarks(*path_state))
+	{
+		accepted = *path_state->getAcceptedLandmarks();
+	}
+	else
+	{
+		// All the landmarks which are true at the start of the search are accepted.
+		accepted.resize(landmarks_.size());
+		accepted.reset();
+		std::vector<const GroundedAtom*> root_facts;
+		path_state->getFacts(initial_facts, root_facts);
+		for (std::vector<const GroundedAtom*>::const_iterator ci = root_facts.begin(); ci != root_facts.end(); ++ci)
+		{
+			boost::unordered_map<unsigned int, unsigned int>::const_iterator landmark_ci = landmark_indexes_.find((*ci)->getId());
+			if (landmark_ci != landmark_indexes_.end())
+			{
+				accepted.set((*landmark_ci).second);
+			}
+		}
+	}
+
+	for (std::vector<const State*>::reverse_iterator ri = path.rbegin(); ri != path.rend(); ++ri)
+	{
+		acceptLandmarks(accepted, *(*ri)->getAchievingAction());
+	}
+}
+
+bool LandmarkHeuristic::hasAcceptedLandmarks(const State& state) const
+{
+	return state.getAcceptedLandmarks() != NULL && state.getAcceptedLandmarks()->size() == landmarks_.size();
+}
+
+void LandmarkHeuristic::acceptLandmarks(boost::dynamic_bitset<>& accepted, const GroundedAction& action) const
+{
+	std::vector<unsigned int> add_effects;
+	action.getAddEffects(add_effects);
+	for (std::vector<unsigned int>::const_iterator ci = add_effects.begin(); ci != add_effects.end(); ++ci)
+	{
+		boost::unordered_map<unsigned int, unsigned int>::const_iterator landmark_ci = landmark_indexes_.find(*ci);
+		if (landmark_ci == landmark_indexes_.end() || accepted[(*landmark_ci).second])
+		{
+			continue;
+		}
+
+		const std::vector<unsigned int>& predecessors = predecessors_[(*landmark_ci).second];
+		bool predecessors_accepted = true;
+		for (std::vector<unsigned int>::const_iterator ci = predecessors.begin(); ci != predecessors.end(); ++ci)
+		{
+			if (!accepted[*ci])
+			{
+				predecessors_accepted = false;
+				break;
+			}
+		}
+
+		if (predecessors_accepted)
+		{
+			accepted.set((*landmark_ci).second);
+		}
+	}
+}
+
+unsigned int LandmarkHeuristic::getLandmarkCount(const State& state, const boost::dynamic_bitset<>& accepted, const std::vector<const GroundedAtom*>& initial_facts) const
+{
+	boost::dynamic_bitset<> is_true(landmarks_.size());
+	std::vector<const GroundedAtom*> state_facts;
+	state.getFacts(initial_facts, state_facts);
+	for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ++ci)
+	{
+		boost::unordered_map<unsigned int, unsigned int>::const_iterator landmark_ci = landmark_indexes_.find((*ci)->getId());
+		if (landmark_ci != landmark_indexes_.end())
+		{
+			is_true.set((*landmark_ci).second);
+		}
+	}
+
+	// Landmarks which are not accepted still need to be achieved, and so do the landmarks which must be true before them.
+	unsigned int h = 0;
+	boost::dynamic_bitset<> is_required(landmarks_.size());
+	for (unsigned int i = 0; i < landmarks_.size(); ++i)
+	{
+		if (accepted[i])
+		{
+			continue;
+		}
+		++h;
+		for (std::vector<unsigned int>::const_iterator ci = predecessors_[i].begin(); ci != predecessors_[i].end(); ++ci)
+		{
+			is_required.set(*ci);
+		}
+	}
+
+	// Accepted landmarks which are required again.
+	for (unsigned int i = 0; i < landmarks_.size(); ++i)
+	{
+		if (accepted[i] && !is_true[i] && (is_goal_[i] || is_required[i]))
+		{
+			++h;
+		}
+	}
+	return h;
+}
+
+std::ostream& operator<<(std::ostream& os, const LandmarkHeuristic& heuristic)
+{
+	os << " === Landmarks === " << std::endl;
+	for (unsigned int i = 0; i < heuristic.landmarks_.size(); ++i)
+	{
+		const GroundedAtom* landmark = GroundedAtom::getInstantiatedGroundedAtom(heuristic.landmarks_[i]);
+		if (landmark != NULL)
+		{
+			os << *landmark;
+		}
+		else
+		{
+			os << "#" << heuristic.landmarks_[i];
+		}
+		os << (heuristic.is_goal_[i] ? " (goal)" : "") << " after {";
+		for (std::vector<unsigned int>::const_iterator ci = heuristic.predecessors_[i].begin(); ci != heuristic.predecessors_[i].end(); ++ci)
+		{
+			os << " " << *ci;
+		}
+		os << " }" << std::endl;
+	}
+	return os;
+}
+
+};
+
+};
@@ -0,0 +1,132 @@
+#ifndef MYPOP_HEURISTICS_LANDMARK_HEURISTIC_H
+#define MYPOP_HEURISTICS_LANDMARK_HEURISTIC_H
+
+#include <vector>
+#include <set>
+#include <string>
+#include <iosfwd>
+#include <boost/unordered_map.hpp>
+#include <boost/dynamic_bitset.hpp>
+
+#include "heuristic_interface.h"
+
+namespace MyPOP {
+
+class ActionManager;
+class GroundedAction;
+class GroundedAtom;
+class State;
+
+namespace REACHABILITY {
+class DTGReachability;
+};
+
+namespace HEURISTICS {
+
+/**
+ * The landmark count heuristic. The fact landmarks and the greedy necessary orderings between them are extracted once for
+ * every set of goals by backchaining from the goals: the preconditions shared by all achievers of a landmark are landmarks
+ * too and must be true before it is achieved. The achievers are the lifted actions whose effects can be unified with the
+ * landmark, achievers with a precondition which is not reachable in the lifted relaxed planning graph are ignored.
+ *
+ * A landmark is accepted once it is true and all the landmarks ordered before it have been accepted. The accepted landmarks
+ * are stored with every state evaluated, so those of a successor are found by applying the add effects of the last action to
+ * the accepted landmarks of its parent. The heuristic value is the number of landmarks which
+ * are not accepted plus the number of accepted landmarks which are required again: goals and landmarks which must be true
+ * before a landmark which is not yet accepted, which are not true in the state.
+ *
+ * The heuristic can either be used on its own, in which case the lifted FF heuristic is only used to extract the landmarks,
+ * or combined with the lifted FF heuristic, in which case the maximum of both values is used together with the helpful
+ * actions of lifted FF.
+ */
+class LandmarkHeuristic : public HeuristicInterface
+{
+public:
+	/**
+	 * @param reachability The lifted FF heuristic, it is deleted by this heuristic.
+	 * @param combine_with_ff If true the heuristic value is the maximum of the landmark count and lifted FF.
+	 */
+	LandmarkHeuristic(REACHABILITY::DTGReachability& reachability, const ActionManager& action_manager, bool combine_with_ff);
+
+	~LandmarkHeuristic();
+
+	void setHeuristicForState(MyPOP::State& state, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, bool find_helpful_actions, bool allow_new_goals_to_be_added);
+
+	void getFunctionalSymmetricSets(std::multimap<const Object*, const Object*>& symmetrical_groups, const State& state, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager) const;
+
+	unsigned int getNumberOfLandmarks() const { return landmarks_.size(); }
+
+private:
+
+	/**
+	 * Find the landmarks and orderings for the given goals, using the lifted relaxed planning graph of the given state.
+	 */
+	void extractLandmarks(const std::vector<const GroundedAtom*>& state_facts, const std::vector<const GroundedAtom*>& goal_facts);
+
+	/**
+	 * Find the preconditions which are shared by all achievers of the landmark.
+	 * @return False if the landmark has no achievers.
+	 */
+	bool getSharedPreconditions(std::vector<const GroundedAtom*>& shared_preconditions, const GroundedAtom& landmark, const std::vector<const GroundedAtom*>& state_facts);
+
+	/**
+	 * @return True if the fact is true in the state or is part of the lifted relaxed planning graph. Facts whose predicate does
+	 * not appear in the lifted relaxed planning graph at all are assumed to be reachable.
+	 */
+	bool isReachable(const GroundedAtom& fact, const std::vector<const GroundedAtom*>& state_facts);
+
+	/**
+	 * @return The index of the landmark, it is added if it is not yet a landmark.
+	 */
+	unsigned int addLandmark(const GroundedAtom& fact, bool& is_new);
+
+	/**
+	 * Find the landmarks which have been accepted on the path to the state. The actions are only replayed from the last
+	 * ancestor whose accepted landmarks have been stored, which is normally the parent of the state.
+	 */
+	void getAcceptedLandmarks(boost::dynamic_bitset<>& accepted, const State& state, const std::vector<const GroundedAtom*>& initial_facts) const;
+
+	/**
+	 * @return True if the state has stored the landmarks accepted on its path for the current landmarks.
+	 */
+	bool hasAcceptedLandmarks(const State& state) const;
+
+	/**
+	 * Accept the landmarks added by the action whose predecessors have all been accepted.
+	 */
+	void acceptLandmarks(boost::dynamic_bitset<>& accepted, const GroundedAction& action) const;
+
+	unsigned int getLandmarkCount(const State& state, const boost::dynamic_bitset<>& accepted, const std::vector<const GroundedAtom*>& initial_facts) const;
+
+	REACHABILITY::DTGReachability* reachability_;
+	const ActionManager* action_manager_;
+	bool combine_with_ff_;
+
+	// The ids of the grounded atoms which are landmarks, these do not change when the grounded atoms are removed.
+	std::vector<unsigned int> landmarks_;
+	boost::unordered_map<unsigned int, unsigned int> landmark_indexes_;
+
+	// For every landmark, the landmarks which must be true before it is achieved.
+	std::vector<std::vector<unsigned int> > predecessors_;
+
+	std::vector<bool> is_goal_;
+
+	// The goals the landmarks have been extracted for.
+	std::vector<unsigned int> goal_ids_;
+
+	// Cache of the facts which have been checked for reachability during the extraction.
+	boost::unordered_map<unsigned int, bool> is_reachable_;
+	
+	// The names of the predicates which appear in the lifted relaxed planning graph.
+	std::set<std::string> predicates_in_graph_;
+
+	friend std::ostream& operator<<(std::ostream& os, const LandmarkHeuristic& heuristic);
+};
+
+std::ostream& operator<<(std::ostream& os, const LandmarkHeuristic& heuristic);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "nogood_store.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "fc_planner.h"
+#include "predicate_manager.h"
+#include "term_manager.h"
+
+//#define MYPOP_HEURISTICS_NOGOOD_STORE_COMMENTS
+
+namespace MyPOP {
+
+namespace HEURISTICS {
+
+namespace {
+
+// The maximum number of nogoods which are kept.
+const unsigned int MAX_NOGOODS = 32;
+
+};
+
+Nogood::Nogood()
+{
+
+}
+
+void Nogood::addFact(const std::string& predicate_name, const std::vector<std::vector<unsigned int> >& object_ids)
+{
+	facts_[predicate_name].push_back(object_ids);
+}
+
+bool Nogood::contains(const GroundedAtom& fact) const
+{
+	if (contains_atom_.size() <= fact.getId())
+	{
+		contains_atom_.resize(fact.getId() + 1, 0);
+	}
+
+	char& contains_atom = contains_atom_[fact.getId()];
+	if (contains_atom != 0)
+	{
+		return contains_atom == 1;
+	}
+
+	contains_atom = 2;
+	std::map<std::string, std::vector<std::vector<std::vector<unsigned int> > > >::const_iterator facts_ci = facts_.find(fact.getPredicate().getName());
+	if (facts_ci == facts_.end())
+	{
+		return false;
+	}
+
+	for (std::vector<std::vector<std::vector<unsigned int> > >::const_iterator ci = (*facts_ci).second.begin(); ci != (*facts_ci).second.end(); ++ci)
+	{
+		const std::vector<std::vector<unsigned int> >& object_ids = *ci;
+		if (object_ids.size() != fact.getPredicate().getArity())
+		{
+			continue;
+		}
+
+		bool terms_match = true;
+		for (unsigned int i = 0; i < object_ids.size(); ++i)
+		{
+			if (!std::binary_search(object_ids[i].begin(), object_ids[i].end(), fact.getObject(i).getId()))
+			{
+				terms_match = false;
+				break;
+			}
+		}
+
+		if (terms_match)
+		{
+			contains_atom = 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Nogood::covers(const std::vector<const GroundedAtom*>& facts) const
+{
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		const GroundedAtom* fact = *ci;
+		if (!fact->getPredicate().isStatic() && !contains(*fact))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+NogoodStore::NogoodStore()
+	: nr_dead_ends_detected_(0)
+{
+
+}
+
+NogoodStore::~NogoodStore()
+{
+	for (std::vector<Nogood*>::const_iterator ci = nogoods_.begin(); ci != nogoods_.end(); ++ci)
+	{
+		delete *ci;
+	}
+}
+
+void NogoodStore::addNogood(Nogood& nogood)
+{
+	if (nogoods_.size() == MAX_NOGOODS)
+	{
+		delete nogoods_.back();
+		nogoods_.pop_back();
+	}
+	nogoods_.insert(nogoods_.begin(), &nogood);
+}
+
+bool NogoodStore::isDeadEnd(const std::vector<const GroundedAtom*>& facts)
+{
+	for (std::vector<Nogood*>::iterator i = nogoods_.begin(); i != nogoods_.end(); ++i)
+	{
+		if (!(*i)->covers(facts))
+		{
+			continue;
+		}
+
+		// Move the nogood to the front, dead ends tend to be found in clusters.
+		std::rotate(nogoods_.begin(), i, i + 1);
+		++nr_dead_ends_detected_;
+
+#ifdef MYPOP_HEURISTICS_NOGOOD_STORE_COMMENTS
+		std::cout << "Dead end detected by a nogood (" << nr_dead_ends_detected_ << ")." << std::endl;
+#endif
+		return true;
+	}
+	return false;
+}
+
+};
+
+};
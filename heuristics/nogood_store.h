@@ -0,0 +1,80 @@
+#ifndef MYPOP_HEURISTICS_NOGOOD_STORE_H
+#define MYPOP_HEURISTICS_NOGOOD_STORE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MyPOP {
+
+class GroundedAtom;
+
+namespace HEURISTICS {
+
+/**
+ * The facts which are reachable under the delete relaxation from a state from which the goal cannot be reached. Every state
+ * whose facts are all part of a nogood can only reach a subset of these facts, so it is a dead end as well.
+ *
+ * The facts are stored lifted: a predicate and for every term the ids of the objects it can be bound to.
+ */
+class Nogood
+{
+public:
+	Nogood();
+
+	/**
+	 * Add a reachable fact.
+	 * @param object_ids For every term the ids of the objects it can be bound to, sorted.
+	 */
+	void addFact(const std::string& predicate_name, const std::vector<std::vector<unsigned int> >& object_ids);
+
+	/**
+	 * @return True if all the facts are part of this nogood, facts of static predicates are ignored.
+	 */
+	bool covers(const std::vector<const GroundedAtom*>& facts) const;
+
+private:
+	bool contains(const GroundedAtom& fact) const;
+
+	// The reachable facts indexed by the name of their predicate.
+	std::map<std::string, std::vector<std::vector<std::vector<unsigned int> > > > facts_;
+
+	// For every grounded atom id whether it is part of this nogood, 0 if this has not been determined yet, 1 if it is part of
+	// this nogood and 2 otherwise.
+	mutable std::vector<char> contains_atom_;
+};
+
+/**
+ * A bounded store of nogoods, the nogood which detected a dead end most recently is checked first. Once the store is full
+ * the nogood which has not detected a dead end for the longest time is removed.
+ */
+class NogoodStore
+{
+public:
+	NogoodStore();
+
+	~NogoodStore();
+
+	/**
+	 * Add a nogood, the store takes ownership.
+	 */
+	void addNogood(Nogood& nogood);
+
+	/**
+	 * @return True if the facts are covered by one of the nogoods.
+	 */
+	bool isDeadEnd(const std::vector<const GroundedAtom*>& facts);
+
+	unsigned int getNumberOfDeadEndsDetected() const { return nr_dead_ends_detected_; }
+
+private:
+	std::vector<Nogood*> nogoods_;
+
+	unsigned int nr_dead_ends_detected_;
+};
+
+};
+
+};
+
+#endif
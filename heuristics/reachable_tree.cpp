@@ -256,7 +256,7 @@ bool ReachableTreeNode::canSatisfyConstraints(const ReachableFact& reachable_fac
 	}
 	std::cout << "." << std::endl;
 */
-	for (unsigned int reachable_fact_term_index = 0; reachable_fact_term_index < reachable_fact.getTermDomains().size(); ++reachable_fact_term_index)
+	for (unsigned int reachable_fact_term_index = 0; reachable_fact_term_index < reachable_fact.getPredicate().getArity(); ++reachable_fact_term_index)
 	{
 		unsigned int fact_index = (*constraints[level])[reachable_fact_term_index].first;
 		unsigned int variable_index = (*constraints[level])[reachable_fact_term_index].second;
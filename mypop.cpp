@@ -29,9 +29,18 @@
 #include "heuristics/dtg_reachability.h"
 #include "heuristics/equivalent_object_group.h"
 #include "fc_planner.h"
+#include "width_planner.h"
+#include "hda_planner.h"
+#include "portfolio_planner.h"
+#include "state_packer.h"
+#include "transposition_table.h"
+#include "plan_optimiser.h"
+#include "relevance_analysis.h"
+#include "goal_agenda.h"
 #include "heuristics/fact_set.h"
 #include "sas/lifted_dtg.h"
 #include "heuristics/cg_heuristic.h"
+#include "heuristics/landmark_heuristic.h"
 
 ///#define MYPOP_COMMENTS
 #define MYPOP_KEEP_TIME
@@ -57,7 +66,116 @@ namespace VAL {
 //using namespace VAL;
 using namespace MyPOP;
 
-enum PLANNER_CONFIG { LIFTED_FF, LIFTED_CG, GROUNDED_FF };
+/**
+ * Creates the heuristics for the planner, for the lifted FF heuristics the lifted transitions are created from scratch for
+ * every heuristic. Actions which are marked as irrelevant and irrelevant objects are left out of the lifted transitions.
+ */
+class PlannerHeuristicFactory : public HeuristicFactory
+{
+public:
+	PlannerHeuristicFactory(const VAL::domain& domain, PredicateManager& predicate_manager, TypeManager& type_manager, ActionManager& action_manager, TermManager& term_manager, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const std::set<const Object*>& irrelevant_objects)
+		: domain_(&domain), predicate_manager_(&predicate_manager), type_manager_(&type_manager), action_manager_(&action_manager), term_manager_(&term_manager), initial_facts_(&initial_facts), goal_facts_(&goal_facts), irrelevant_objects_(&irrelevant_objects)
+	{
+		
+	}
+	
+	HEURISTICS::HeuristicInterface* createHeuristic(PLANNER_CONFIG planner_config)
+	{
+		if (planner_config == LIFTED_CG)
+		{
+			std::vector<SAS_Plus::LiftedDTG*>* lifted_dtgs = new std::vector<SAS_Plus::LiftedDTG*>();
+			SAS_Plus::LiftedDTG::createLiftedDTGs(*lifted_dtgs, *domain_->types, *predicate_manager_, *type_manager_, *action_manager_, *term_manager_, *initial_facts_);
+			Graphviz::printToDot(*lifted_dtgs);
+			
+			std::vector<const GroundedAtom*> grounded_goal_facts;
+			for (std::vector<const Atom*>::const_iterator ci = goal_facts_->begin(); ci != goal_facts_->end(); ++ci)
+			{
+				const Atom* goal = *ci;
+				const Object* variables[goal->getArity()];
+				for (unsigned int term_index = 0; term_index < goal->getArity(); ++term_index)
+				{
+					variables[term_index] = static_cast<const Object*>(goal->getTerms()[term_index]);
+				}
+				grounded_goal_facts.push_back(&GroundedAtom::getGroundedAtom(goal->getPredicate(), variables));
+			}
+			
+			std::vector<const GroundedAtom*> grounded_initial_facts;
+			for (std::vector<const Atom*>::const_iterator ci = initial_facts_->begin(); ci != initial_facts_->end(); ++ci)
+			{
+				const Atom* init = *ci;
+				const Object* variables[init->getArity()];
+				for (unsigned int term_index = 0; term_index < init->getArity(); ++term_index)
+				{
+					variables[term_index] = static_cast<const Object*>(init->getTerms()[term_index]);
+				}
+				grounded_initial_facts.push_back(&GroundedAtom::getGroundedAtom(init->getPredicate(), variables));
+			}
+			
+			return new HEURISTICS::LiftedCausalGraphHeuristic(*lifted_dtgs, *action_manager_, *predicate_manager_, grounded_goal_facts);
+		}
+		
+		// Split up the actions into lifted actions.
+		std::vector<const Object*> objects_part_of_property_state;
+		for (std::vector<TIM::PropertySpace*>::const_iterator property_space_i = TIM::TA->pbegin(); property_space_i != TIM::TA->pend(); ++property_space_i)
+		{
+			TIM::PropertySpace* property_space = *property_space_i;
+			for (TIM::PropertySpace::OIterator object_i = property_space->obegin(); object_i != property_space->oend(); ++object_i)
+			{
+				TIM::TIMobjectSymbol* tim_object = *object_i;
+				
+				const Object& object = term_manager_->getObject(tim_object->getName());
+				if (std::find(objects_part_of_property_state.begin(), objects_part_of_property_state.end(), &object) == objects_part_of_property_state.end())
+				{
+					objects_part_of_property_state.push_back(&object);
+				}
+			}
+		}
+
+		std::vector<HEURISTICS::LiftedTransition*> lifted_transitions;
+		for (std::vector<Action*>::const_iterator ci = action_manager_->getManagableObjects().begin(); ci != action_manager_->getManagableObjects().end(); ++ci)
+		{
+			const Action* action = *ci;
+			if (!action_manager_->isRelevant(*action))
+			{
+				continue;
+			}
+			HEURISTICS::LiftedTransition::createLiftedTransitions(lifted_transitions, *predicate_manager_, *term_manager_, *type_manager_, *action, *initial_facts_, objects_part_of_property_state, *irrelevant_objects_);
+		}
+		std::cerr << "Lifted transitions: " << lifted_transitions.size() << std::endl;
+		HEURISTICS::LiftedTransition::mergeFactSets(lifted_transitions);
+
+		// Do the reachability analysis.
+#ifdef MYPOP_KEEP_TIME
+		struct timeval start_time_prepare_reachability;
+		gettimeofday(&start_time_prepare_reachability, NULL);
+#endif
+
+		REACHABILITY::DTGReachability* reachability = new REACHABILITY::DTGReachability(lifted_transitions, *term_manager_, *predicate_manager_, planner_config == GROUNDED_FF);
+		HEURISTICS::HeuristicInterface* heuristic_interface = reachability;
+		if (planner_config == LANDMARK_COUNT || planner_config == LANDMARK_COUNT_FF)
+		{
+			heuristic_interface = new HEURISTICS::LandmarkHeuristic(*reachability, *action_manager_, planner_config == LANDMARK_COUNT_FF);
+		}
+#ifdef MYPOP_KEEP_TIME
+		struct timeval end_time_prepare_reachability;
+		gettimeofday(&end_time_prepare_reachability, NULL);	
+		
+		double time_spend_preparing = end_time_prepare_reachability.tv_sec - start_time_prepare_reachability.tv_sec + (end_time_prepare_reachability.tv_usec - start_time_prepare_reachability.tv_usec) / 1000000.0;
+		std::cerr << "Prepare reachability analysis: " << time_spend_preparing << " seconds" << std::endl;
+#endif
+		return heuristic_interface;
+	}
+	
+private:
+	const VAL::domain* domain_;
+	PredicateManager* predicate_manager_;
+	TypeManager* type_manager_;
+	ActionManager* action_manager_;
+	TermManager* term_manager_;
+	const std::vector<const Atom*>* initial_facts_;
+	const std::vector<const Atom*>* goal_facts_;
+	const std::set<const Object*>* irrelevant_objects_;
+};
 
 int main(int argc,char * argv[])
 {
@@ -69,7 +187,24 @@ int main(int argc,char * argv[])
 		std::cout << "\t-cg  - Lifted Causal Graph Heuristic." << std::endl;
 		std::cout << "\t-ff  - Lifted Fast Forward. (default)" << std::endl;
 		std::cout << "\t-gff - Grounded Fast Forward." << std::endl;
+		std::cout << "\t-lm  - Landmark count heuristic." << std::endl;
+		std::cout << "\t-lmff - Maximum of the landmark count and Lifted Fast Forward." << std::endl;
 		std::cout << "\t-r   - Allow restarts. (default = false)" << std::endl;
+		std::cout << "\t-ehc - Use enforced hill climbing before greedy best first search." << std::endl;
+		std::cout << "\t-iw1 - Use IW(1) before greedy best first search." << std::endl;
+		std::cout << "\t-iw2 - Use IW(2) before greedy best first search." << std::endl;
+		std::cout << "\t-siw - Use serialised IW before greedy best first search." << std::endl;
+		std::cout << "\t-bfws - Use best first width search before greedy best first search." << std::endl;
+		std::cout << "\t-hda <n> - Use hash distributed greedy best first search with n worker processes." << std::endl;
+		std::cout << "\t-portfolio - Run several configurations in parallel, the first valid plan found is used." << std::endl;
+		std::cout << "\t-seed <n> - The seed used to break ties between states. (default = 0)" << std::endl;
+		std::cout << "\t-pack - Detect duplicate states by packing them into the finite domain variables found by TIM." << std::endl;
+		std::cout << "\t-extmem <MB> - Keep at most MB megabytes of the closed list in memory, the rest is spilled to disk." << std::endl;
+		std::cout << "\t-tt <MB> - Store the heuristic values of up to MB megabytes of states, they are reused after restarts." << std::endl;
+		std::cout << "\t-agenda - Achieve the goals in the order derived from the causal graph before greedy best first search." << std::endl;
+		std::cout << "\t-anytime <seconds> - Search for shorter plans after the first plan is found." << std::endl;
+		std::cout << "\t-val - Validate the plan with VAL instead of the built-in validator." << std::endl;
+		std::cout << "\t-relevance - Remove the actions, objects, and facts which cannot contribute to the goals." << std::endl;
 		exit(1);
 	}
 
@@ -78,6 +213,19 @@ int main(int argc,char * argv[])
 
 	PLANNER_CONFIG planner_config = LIFTED_FF;
 	bool allow_restarts = true;
+	bool use_enforced_hill_climbing = false;
+	bool use_width_search = false;
+	WIDTH_SEARCH_MODE width_search_mode = SERIALISED_IW;
+	unsigned int nr_hda_workers = 0;
+	bool use_portfolio = false;
+	unsigned int seed = 0;
+	bool use_state_packing = false;
+	unsigned int external_memory_budget = 0;
+	unsigned int transposition_table_budget = 0;
+	bool use_goal_agenda = false;
+	unsigned int anytime_budget = 0;
+	bool use_val = false;
+	bool use_relevance_analysis = false;
 	
 	//bool use_ff = true;
 	//bool use_grounded_ff = false;
@@ -97,10 +245,82 @@ int main(int argc,char * argv[])
 		{
 			planner_config = GROUNDED_FF;
 		}
+		else if (command_line == "-lm")
+		{
+			planner_config = LANDMARK_COUNT;
+		}
+		else if (command_line == "-lmff")
+		{
+			planner_config = LANDMARK_COUNT_FF;
+		}
 		else if (command_line == "-nr")
 		{
 			allow_restarts = false;
 		}
+		else if (command_line == "-ehc")
+		{
+			use_enforced_hill_climbing = true;
+		}
+		else if (command_line == "-iw1")
+		{
+			use_width_search = true;
+			width_search_mode = IW_1;
+		}
+		else if (command_line == "-iw2")
+		{
+			use_width_search = true;
+			width_search_mode = IW_2;
+		}
+		else if (command_line == "-siw")
+		{
+			use_width_search = true;
+			width_search_mode = SERIALISED_IW;
+		}
+		else if (command_line == "-bfws")
+		{
+			use_width_search = true;
+			width_search_mode = BEST_FIRST_WIDTH_SEARCH;
+		}
+		else if (command_line == "-hda" && i + 1 < argc - 2)
+		{
+			nr_hda_workers = atoi(argv[++i]);
+		}
+		else if (command_line == "-portfolio")
+		{
+			use_portfolio = true;
+		}
+		else if (command_line == "-seed" && i + 1 < argc - 2)
+		{
+			seed = atoi(argv[++i]);
+		}
+		else if (command_line == "-pack")
+		{
+			use_state_packing = true;
+		}
+		else if (command_line == "-extmem" && i + 1 < argc - 2)
+		{
+			external_memory_budget = atoi(argv[++i]);
+		}
+		else if (command_line == "-tt" && i + 1 < argc - 2)
+		{
+			transposition_table_budget = atoi(argv[++i]);
+		}
+		else if (command_line == "-agenda")
+		{
+			use_goal_agenda = true;
+		}
+		else if (command_line == "-anytime" && i + 1 < argc - 2)
+		{
+			anytime_budget = atoi(argv[++i]);
+		}
+		else if (command_line == "-val")
+		{
+			use_val = true;
+		}
+		else if (command_line == "-relevance")
+		{
+			use_relevance_analysis = true;
+		}
 		else
 		{
 			std::cerr << "Unknown option " << command_line << std::endl << std::endl;
@@ -109,7 +329,24 @@ int main(int argc,char * argv[])
 			std::cerr << "\t-cg  - Lifted Causal Graph Heuristic." << std::endl;
 			std::cerr << "\t-ff  - Lifted Fast Forward. (default)" << std::endl;
 			std::cerr << "\t-gff - Grounded Fast Forward." << std::endl;
+			std::cerr << "\t-lm  - Landmark count heuristic." << std::endl;
+			std::cerr << "\t-lmff - Maximum of the landmark count and Lifted Fast Forward." << std::endl;
 			std::cerr << "\t-nr  - Disable restarts." << std::endl;
+			std::cerr << "\t-ehc - Use enforced hill climbing before greedy best first search." << std::endl;
+			std::cerr << "\t-iw1 - Use IW(1) before greedy best first search." << std::endl;
+			std::cerr << "\t-iw2 - Use IW(2) before greedy best first search." << std::endl;
+			std::cerr << "\t-siw - Use serialised IW before greedy best first search." << std::endl;
+			std::cerr << "\t-bfws - Use best first width search before greedy best first search." << std::endl;
+			std::cerr << "\t-hda <n> - Use hash distributed greedy best first search with n worker processes." << std::endl;
+			std::cerr << "\t-portfolio - Run several configurations in parallel, the first valid plan found is used." << std::endl;
+			std::cerr << "\t-seed <n> - The seed used to break ties between states. (default = 0)" << std::endl;
+			std::cerr << "\t-pack - Detect duplicate states by packing them into the finite domain variables found by TIM." << std::endl;
+			std::cerr << "\t-extmem <MB> - Keep at most MB megabytes of the closed list in memory, the rest is spilled to disk." << std::endl;
+			std::cerr << "\t-tt <MB> - Store the heuristic values of up to MB megabytes of states, they are reused after restarts." << std::endl;
+			std::cerr << "\t-agenda - Achieve the goals in the order derived from the causal graph before greedy best first search." << std::endl;
+			std::cerr << "\t-anytime <seconds> - Search for shorter plans after the first plan is found." << std::endl;
+			std::cerr << "\t-val - Validate the plan with VAL instead of the built-in validator." << std::endl;
+			std::cerr << "\t-relevance - Remove the actions, objects, and facts which cannot contribute to the goals." << std::endl;
 			exit(1);
 		}
 	}
@@ -218,17 +455,11 @@ int main(int argc,char * argv[])
 	TypeManager type_manager;
 	type_manager.processTypes(*the_domain->types);
 
-	// Process the objects.
+	// Process the objects and the constants (if any).
 	TermManager term_manager(type_manager);
-	type_manager.processObjects(term_manager, *the_problem->objects);
+	type_manager.processObjects(term_manager, *the_problem->objects, the_domain->constants);
 ///	term_manager.processActionVariables(*the_domain->ops);
 
-	// Process the constants (if any).
-	if (the_domain->constants != NULL)
-	{
-		type_manager.processObjects(term_manager, *the_domain->constants);
-	}
-
 	std::cout << term_manager << std::endl;
 
 	// Process the predicates.
@@ -270,102 +501,180 @@ int main(int argc,char * argv[])
 
 	std::vector<const Atom*> goal_facts;
 	Utility::convertFormula(goal_facts, goal);
+	
+	// Remove everything which cannot contribute to the goals before the heuristics and the search see it.
+	std::set<const Object*> irrelevant_objects;
+	if (use_relevance_analysis)
+	{
+		RelevanceAnalysis relevance_analysis(action_manager, type_manager, term_manager, goal_facts);
+		unsigned int nr_irrelevant_actions = 0;
+		for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ++ci)
+		{
+			if (!relevance_analysis.isRelevant(**ci))
+			{
+				action_manager.setIrrelevant(**ci);
+				++nr_irrelevant_actions;
+			}
+		}
+		irrelevant_objects = relevance_analysis.getIrrelevantObjects();
+		unsigned int nr_irrelevant_facts = relevance_analysis.pruneFacts(initial_facts);
+		std::cerr << "Irrelevant actions: " << nr_irrelevant_actions << "; objects: " << irrelevant_objects.size() << "; initial facts: " << nr_irrelevant_facts << std::endl;
+	}
 
+	PlannerHeuristicFactory heuristic_factory(*the_domain, predicate_manager, type_manager, action_manager, term_manager, initial_facts, goal_facts, irrelevant_objects);
 	HEURISTICS::HeuristicInterface* heuristic_interface = NULL;
 	
-	if (planner_config == LIFTED_CG)
+	std::vector<const GroundedAction*> found_plan;
+	std::pair<int, int> result(-1, -1);
+	
+	// Every worker of the portfolio creates its own heuristic.
+	if (use_portfolio)
 	{
-		std::vector<SAS_Plus::LiftedDTG*>* lifted_dtgs = new std::vector<SAS_Plus::LiftedDTG*>();
-		SAS_Plus::LiftedDTG::createLiftedDTGs(*lifted_dtgs, *the_domain->types, predicate_manager, type_manager, action_manager, term_manager, initial_facts);
-		Graphviz::printToDot(*lifted_dtgs);
+		PortfolioPlanner portfolio_planner(action_manager, predicate_manager, type_manager, heuristic_factory);
+		portfolio_planner.addConfiguration(PortfolioConfiguration(LIFTED_FF, true, true, seed));
+		portfolio_planner.addConfiguration(PortfolioConfiguration(LIFTED_CG, true, true, seed + 1));
+		portfolio_planner.addConfiguration(PortfolioConfiguration(LIFTED_FF, true, false, seed + 2));
+		portfolio_planner.addConfiguration(PortfolioConfiguration(GROUNDED_FF, true, true, seed + 3));
+		portfolio_planner.addConfiguration(PortfolioConfiguration(LIFTED_FF, false, true, seed + 4));
+		result = portfolio_planner.findPlan(found_plan, initial_facts, goal_facts, term_manager);
+	}
+	else
+	{
+		heuristic_interface = heuristic_factory.createHeuristic(planner_config);
+		StatePacker* state_packer = NULL;
+		if (use_state_packing)
+		{
+			state_packer = new StatePacker(predicate_manager, type_manager, term_manager);
+		}
 		
-		std::vector<const GroundedAtom*> grounded_goal_facts;
-		for (std::vector<const Atom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+		TranspositionTable* transposition_table = NULL;
+		if (transposition_table_budget > 0)
 		{
-			const Atom* goal = *ci;
-			const Object** variables = new const Object*[goal->getArity()];
-			for (unsigned int term_index = 0; term_index < goal->getArity(); ++term_index)
+			transposition_table = new TranspositionTable(static_cast<std::size_t>(transposition_table_budget) * 1024 * 1024);
+		}
+		
+		ForwardChainingPlanner fcp(action_manager, predicate_manager, type_manager, *heuristic_interface);
+		fcp.setSeed(seed);
+		fcp.setStatePacker(state_packer);
+		fcp.setTranspositionTable(transposition_table);
+		if (external_memory_budget > 0)
+		{
+			const char* temp_directory = getenv("TMPDIR");
+			fcp.setExternalClosedList(static_cast<std::size_t>(external_memory_budget) * 1024 * 1024, temp_directory != NULL ? temp_directory : "/tmp");
+		}
+		
+		if (use_width_search)
+		{
+			WidthBasedPlanner width_based_planner(action_manager, type_manager, *heuristic_interface);
+			width_based_planner.setStatePacker(state_packer);
+			result = width_based_planner.findPlan(found_plan, initial_facts, goal_facts, term_manager, width_search_mode);
+		
+			// If the width based search failed, fall back to the other search methods.
+			if (result.first == -1)
 			{
-				variables[term_index] = static_cast<const Object*>(goal->getTerms()[term_index]);
+				found_plan.clear();
+				GroundedAtom::removeInstantiatedGroundedAtom();
+				GroundedAction::removeInstantiatedGroundedActions();
 			}
-			grounded_goal_facts.push_back(&GroundedAtom::getGroundedAtom(goal->getPredicate(), variables));
 		}
-		
-		std::vector<const GroundedAtom*> grounded_initial_facts;
-		for (std::vector<const Atom*>::const_iterator ci = initial_facts.begin(); ci != initial_facts.end(); ++ci)
+	
+		if (result.first == -1 && use_enforced_hill_climbing)
 		{
-			const Atom* init = *ci;
-			const Object** variables = new const Object*[init->getArity()];
-			for (unsigned int term_index = 0; term_index < init->getArity(); ++term_index)
+			result = fcp.findPlanEHC(found_plan, initial_facts, goal_facts, term_manager, false);
+		
+			// If enforced hill climbing failed, fall back to greedy best first search.
+			if (result.first == -1)
 			{
-				variables[term_index] = static_cast<const Object*>(init->getTerms()[term_index]);
+				found_plan.clear();
+				GroundedAtom::removeInstantiatedGroundedAtom();
+				GroundedAction::removeInstantiatedGroundedActions();
 			}
-			grounded_initial_facts.push_back(&GroundedAtom::getGroundedAtom(init->getPredicate(), variables));
 		}
+	
+		if (result.first == -1 && nr_hda_workers > 0)
+		{
+			HashDistributedPlanner hda_planner(action_manager, type_manager, *heuristic_interface, nr_hda_workers);
+			hda_planner.setStatePacker(state_packer);
+			result = hda_planner.findPlan(found_plan, initial_facts, goal_facts, term_manager, true);
 		
-		heuristic_interface = new HEURISTICS::LiftedCausalGraphHeuristic(*lifted_dtgs, action_manager, predicate_manager, grounded_goal_facts);
-	}
-	else
-	{
-		// Split up the actions into lifted actions.
-		std::vector<const Object*> objects_part_of_property_state;
-		for (std::vector<TIM::PropertySpace*>::const_iterator property_space_i = TIM::TA->pbegin(); property_space_i != TIM::TA->pend(); ++property_space_i)
+			// If the parallel search failed, fall back to the sequential search.
+			if (result.first == -1)
+			{
+				found_plan.clear();
+				GroundedAtom::removeInstantiatedGroundedAtom();
+				GroundedAction::removeInstantiatedGroundedActions();
+			}
+		}
+	
+		if (result.first == -1 && use_goal_agenda)
 		{
-			TIM::PropertySpace* property_space = *property_space_i;
-			for (TIM::PropertySpace::OIterator object_i = property_space->obegin(); object_i != property_space->oend(); ++object_i)
+			std::vector<SAS_Plus::LiftedDTG*> lifted_dtgs;
+			SAS_Plus::LiftedDTG::createLiftedDTGs(lifted_dtgs, *the_domain->types, predicate_manager, type_manager, action_manager, term_manager, initial_facts);
+			SAS_Plus::CausalGraph causal_graph(lifted_dtgs, action_manager, predicate_manager);
+			
+			GoalAgenda goal_agenda(causal_graph, predicate_manager);
+			std::vector<std::vector<const Atom*> > goal_subsets;
+			goal_agenda.getGoalSubsets(goal_subsets, goal_facts);
+			std::cerr << "Goal agenda: " << goal_subsets.size() << " goal subsets." << std::endl;
+			
+			// A single subset is the same as a normal search.
+			if (goal_subsets.size() > 1)
 			{
-				TIM::TIMobjectSymbol* tim_object = *object_i;
+				result = fcp.findPlanWithGoalAgenda(found_plan, initial_facts, goal_subsets, term_manager, true, allow_restarts, false);
 				
-				const Object& object = term_manager.getObject(tim_object->getName());
-				if (std::find(objects_part_of_property_state.begin(), objects_part_of_property_state.end(), &object) == objects_part_of_property_state.end())
+				// If the goal agenda failed, fall back to the search for all goals at once.
+				if (result.first == -1)
 				{
-					objects_part_of_property_state.push_back(&object);
+					found_plan.clear();
+					GroundedAtom::removeInstantiatedGroundedAtom();
+					GroundedAction::removeInstantiatedGroundedActions();
 				}
 			}
+			
+			for (std::vector<SAS_Plus::LiftedDTG*>::const_iterator ci = lifted_dtgs.begin(); ci != lifted_dtgs.end(); ++ci)
+			{
+				delete *ci;
+			}
 		}
-
-		std::vector<HEURISTICS::LiftedTransition*> lifted_transitions;
-		for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ++ci)
+	
+		if (result.first == -1)
 		{
-			const Action* action = *ci;
-			HEURISTICS::LiftedTransition::createLiftedTransitions(lifted_transitions, predicate_manager, term_manager, type_manager, *action, initial_facts, objects_part_of_property_state);
+			result = fcp.findPlan(found_plan, initial_facts, goal_facts, term_manager, true, allow_restarts, false);
+		}
+	
+		// If the greedy method failed, try the non greedy method!
+		if (result.first == -1)
+		{
+			found_plan.clear();
+			GroundedAtom::removeInstantiatedGroundedAtom();
+			GroundedAction::removeInstantiatedGroundedActions();
+			result = fcp.findPlan(found_plan, initial_facts, goal_facts, term_manager, false, allow_restarts, false);
 		}
-		std::cerr << "Lifted transitions: " << lifted_transitions.size() << std::endl;
-		HEURISTICS::LiftedTransition::mergeFactSets(lifted_transitions);
-//	std::cerr << "Total number of transitions: " << nr_transitions << "; Total of DTGs: " << dtg_manager->getManagableObjects().size() << "." << std::endl;
-
-
-	// Do the reachability analysis.
-#ifdef MYPOP_KEEP_TIME
-		struct timeval start_time_prepare_reachability;
-		gettimeofday(&start_time_prepare_reachability, NULL);
-#endif
-
-		heuristic_interface = new REACHABILITY::DTGReachability(lifted_transitions, term_manager, predicate_manager, planner_config == GROUNDED_FF);
-#ifdef MYPOP_KEEP_TIME
-		struct timeval end_time_prepare_reachability;
-		gettimeofday(&end_time_prepare_reachability, NULL);	
 		
-		double time_spend_preparing = end_time_prepare_reachability.tv_sec - start_time_prepare_reachability.tv_sec + (end_time_prepare_reachability.tv_usec - start_time_prepare_reachability.tv_usec) / 1000000.0;
-		std::cerr << "Prepare reachability analysis: " << time_spend_preparing << " seconds" << std::endl;
-#endif
+		// Use the remaining time to find shorter plans.
+		if (result.first != -1 && anytime_budget > 0)
+		{
+			result.first += fcp.improvePlan(found_plan, initial_facts, goal_facts, term_manager, anytime_budget);
+			result.second = found_plan.size();
+		}
+		delete state_packer;
+		
+		if (transposition_table != NULL)
+		{
+			std::cerr << "Transposition table: " << transposition_table->getNumberOfHits() << " hits; " << transposition_table->getNumberOfMisses() << " misses." << std::endl;
+			delete transposition_table;
+		}
 	}
-	
-	std::vector<const GroundedAction*> found_plan;
-	ForwardChainingPlanner fcp(action_manager, predicate_manager, type_manager, *heuristic_interface);
-	std::pair<int, int> result;
-	
-	result = fcp.findPlan(found_plan, initial_facts, goal_facts, term_manager, true, allow_restarts, false);
-	
-	// If the greedy method failed, try the non greedy method!
-	if (result.first == -1)
+		
+	// Remove the redundant actions before the plan is validated.
+	PlanOptimiser plan_optimiser(initial_facts, goal_facts);
+	if (result.first != -1)
 	{
-		found_plan.clear();
-		GroundedAtom::removeInstantiatedGroundedAtom();
-		GroundedAction::removeInstantiatedGroundedActions();
-		result = fcp.findPlan(found_plan, initial_facts, goal_facts, term_manager, false, allow_restarts, false);
+		unsigned int nr_removed_actions = plan_optimiser.optimise(found_plan);
+		std::cerr << "Plan optimisation removed " << nr_removed_actions << " actions." << std::endl;
+		result.second = found_plan.size();
 	}
-		
+	
 	// Validate the plan!
 	std::stringstream plan_stream;
 	for (std::vector<const GroundedAction*>::const_iterator ci = found_plan.begin(); ci != found_plan.end(); ci++)
@@ -373,7 +682,10 @@ int main(int argc,char * argv[])
 		plan_stream << **ci << std::endl;
 		std::cout << **ci << std::endl;
 	}
-	if (VAL::checkPlan(domain_name, problem_name, plan_stream))
+	
+	// VAL parses the domain and problem again, so we only use it if asked. Otherwise the plan is replayed on the grounded atoms.
+	bool is_valid_plan = use_val ? VAL::checkPlan(domain_name, problem_name, plan_stream) : plan_optimiser.isValid(found_plan);
+	if (is_valid_plan)
 	{
 		std::cerr << "Valid plan!" << std::endl;
 		std::cerr << "States visited: " << result.first << std::endl;
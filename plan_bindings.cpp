@@ -60,9 +60,9 @@ VariableDomain::VariableDomain(const VariableDomain& other, const Bindings& bind
 
 void VariableDomain::populate(const Type& type)
 {
-	std::vector<const Object*> values;
-	bindings_->getTermManager().getTypeManager().getObjectsOfType(values, type);
-	domain_.insert(domain_.begin(), values.begin(), values.end());
+	std::vector<const Object*>::const_iterator objects_begin, objects_end;
+	bindings_->getTermManager().getTypeManager().getObjectsOfType(objects_begin, objects_end, type);
+	domain_.insert(domain_.begin(), objects_begin, objects_end);
 }
 
 void VariableDomain::updateBindings(const std::map<const VariableDomain*, VariableDomain*>& old_to_new_domain_mapping)
@@ -0,0 +1,319 @@
+#include "plan_optimiser.h"
+
+#include <map>
+#include <iostream>
+#include <limits>
+
+#include "fc_planner.h"
+#include "formula.h"
+#include "action_manager.h"
+#include "term_manager.h"
+#include "type_manager.h"
+
+//#define MYPOP_PLAN_OPTIMISER_COMMENTS
+
+namespace MyPOP {
+
+PlanOptimiser::PlanOptimiser(const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts)
+{
+	std::vector<const GroundedAtom*> grounded_initial_facts;
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
+	for (std::vector<const GroundedAtom*>::const_iterator ci = grounded_initial_facts.begin(); ci != grounded_initial_facts.end(); ++ci)
+	{
+		initial_facts_.push_back((*ci)->getId());
+	}
+
+	std::vector<const GroundedAtom*> grounded_goal_facts;
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
+	for (std::vector<const GroundedAtom*>::const_iterator ci = grounded_goal_facts.begin(); ci != grounded_goal_facts.end(); ++ci)
+	{
+		goal_facts_.push_back((*ci)->getId());
+	}
+}
+
+unsigned int PlanOptimiser::optimise(std::vector<const GroundedAction*>& plan) const
+{
+	std::vector<SimulatedAction> simulated_plan;
+	getSimulatedPlan(simulated_plan, plan);
+
+	// Grounding the preconditions might have handed out new ids.
+	unsigned int nr_atoms = GroundedAtom::numberOfGroundedAtomIds();
+
+	// Leave the plan alone if the simulator does not agree that it is valid.
+	if (!isValid(plan, simulated_plan, nr_atoms))
+	{
+		std::cerr << "The plan is not valid, it is not optimised." << std::endl;
+		return 0;
+	}
+
+	unsigned int nr_removed_actions = removeLoops(plan, simulated_plan, nr_atoms);
+	nr_removed_actions += eliminateActions(plan, simulated_plan, nr_atoms);
+
+#ifdef MYPOP_PLAN_OPTIMISER_COMMENTS
+	std::cout << "Removed " << nr_removed_actions << " actions from the plan." << std::endl;
+#endif
+	return nr_removed_actions;
+}
+
+bool PlanOptimiser::isValid(const std::vector<const GroundedAction*>& plan) const
+{
+	std::vector<SimulatedAction> simulated_plan;
+	getSimulatedPlan(simulated_plan, plan);
+	return isValid(plan, simulated_plan, GroundedAtom::numberOfGroundedAtomIds());
+}
+
+bool PlanOptimiser::isValid(const std::vector<const GroundedAction*>& plan, const std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const
+{
+	boost::dynamic_bitset<> state;
+	getInitialState(state, nr_atoms);
+	for (unsigned int i = 0; i < simulated_plan.size(); ++i)
+	{
+		const SimulatedAction& action = simulated_plan[i];
+		if (action.ill_typed_variable_ != std::numeric_limits<unsigned int>::max())
+		{
+			const Variable* variable = plan[i]->getAction().getVariables()[action.ill_typed_variable_];
+			const Object& object = plan[i]->getVariablesAssignment(action.ill_typed_variable_);
+			std::cerr << "The object " << object << " assigned to the variable " << variable->getName() << " of step " << i << " is not of the type " << *variable->getType() << "." << std::endl;
+			return false;
+		}
+		
+		if (action.violated_equality_ != NULL)
+		{
+			std::cerr << "The equality constraint ";
+			action.violated_equality_->print(std::cerr);
+			std::cerr << " of step " << i << " is not satisfied." << std::endl;
+			return false;
+		}
+		
+		for (std::vector<unsigned int>::const_iterator ci = action.preconditions_.begin(); ci != action.preconditions_.end(); ++ci)
+		{
+			if (!state[*ci])
+			{
+				std::cerr << "The precondition ";
+				printAtom(std::cerr, *ci);
+				std::cerr << " of step " << i << " is not satisfied." << std::endl;
+				return false;
+			}
+		}
+		
+		for (std::vector<unsigned int>::const_iterator ci = action.negative_preconditions_.begin(); ci != action.negative_preconditions_.end(); ++ci)
+		{
+			if (state[*ci])
+			{
+				std::cerr << "The negative precondition (not ";
+				printAtom(std::cerr, *ci);
+				std::cerr << ") of step " << i << " is not satisfied." << std::endl;
+				return false;
+			}
+		}
+		apply(action, state);
+	}
+
+	for (std::vector<unsigned int>::const_iterator ci = goal_facts_.begin(); ci != goal_facts_.end(); ++ci)
+	{
+		if (!state[*ci])
+		{
+			std::cerr << "The goal ";
+			printAtom(std::cerr, *ci);
+			std::cerr << " is not achieved." << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned int PlanOptimiser::removeLoops(std::vector<const GroundedAction*>& plan, std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const
+{
+	// Map every state visited to the number of actions executed to reach it the first time.
+	std::map<boost::dynamic_bitset<>, unsigned int> visited_states;
+	boost::dynamic_bitset<> state;
+	getInitialState(state, nr_atoms);
+	visited_states[state] = 0;
+
+	std::vector<const GroundedAction*> new_plan;
+	std::vector<SimulatedAction> new_simulated_plan;
+	for (unsigned int i = 0; i < plan.size(); ++i)
+	{
+		apply(simulated_plan[i], state);
+		new_plan.push_back(plan[i]);
+		new_simulated_plan.push_back(simulated_plan[i]);
+
+		std::map<boost::dynamic_bitset<>, unsigned int>::iterator visited_i = visited_states.find(state);
+		if (visited_i == visited_states.end())
+		{
+			visited_states[state] = new_plan.size();
+			continue;
+		}
+
+		// Forget the states visited inside the loop.
+		unsigned int loop_start = (*visited_i).second;
+		for (std::map<boost::dynamic_bitset<>, unsigned int>::iterator i = visited_states.begin(); i != visited_states.end();)
+		{
+			if ((*i).second > loop_start)
+			{
+				visited_states.erase(i++);
+			}
+			else
+			{
+				++i;
+			}
+		}
+		new_plan.resize(loop_start);
+		new_simulated_plan.resize(loop_start);
+	}
+
+	unsigned int nr_removed_actions = plan.size() - new_plan.size();
+	plan.swap(new_plan);
+	simulated_plan.swap(new_simulated_plan);
+	return nr_removed_actions;
+}
+
+unsigned int PlanOptimiser::eliminateActions(std::vector<const GroundedAction*>& plan, std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const
+{
+	std::vector<bool> is_removed(plan.size(), false);
+
+	// The state reached by executing the actions before the action we try to remove.
+	boost::dynamic_bitset<> current_state;
+	getInitialState(current_state, nr_atoms);
+
+	for (unsigned int i = 0; i < plan.size(); ++i)
+	{
+		if (is_removed[i])
+		{
+			continue;
+		}
+
+		// Remove the action and all the later actions which are no longer applicable.
+		std::vector<bool> candidate_removed(is_removed);
+		candidate_removed[i] = true;
+		boost::dynamic_bitset<> state = current_state;
+		for (unsigned int j = i + 1; j < plan.size(); ++j)
+		{
+			if (candidate_removed[j])
+			{
+				continue;
+			}
+
+			if (isApplicable(simulated_plan[j], state))
+			{
+				apply(simulated_plan[j], state);
+			}
+			else
+			{
+				candidate_removed[j] = true;
+			}
+		}
+
+		if (achievesGoals(state))
+		{
+			is_removed.swap(candidate_removed);
+		}
+		else
+		{
+			apply(simulated_plan[i], current_state);
+		}
+	}
+
+	std::vector<const GroundedAction*> new_plan;
+	std::vector<SimulatedAction> new_simulated_plan;
+	for (unsigned int i = 0; i < plan.size(); ++i)
+	{
+		if (!is_removed[i])
+		{
+			new_plan.push_back(plan[i]);
+			new_simulated_plan.push_back(simulated_plan[i]);
+		}
+	}
+
+	unsigned int nr_removed_actions = plan.size() - new_plan.size();
+	plan.swap(new_plan);
+	simulated_plan.swap(new_simulated_plan);
+	return nr_removed_actions;
+}
+
+bool PlanOptimiser::isApplicable(const SimulatedAction& action, const boost::dynamic_bitset<>& state)
+{
+	if (action.violated_equality_ != NULL || action.ill_typed_variable_ != std::numeric_limits<unsigned int>::max())
+	{
+		return false;
+	}
+	
+	for (std::vector<unsigned int>::const_iterator ci = action.preconditions_.begin(); ci != action.preconditions_.end(); ++ci)
+	{
+		if (!state[*ci])
+		{
+			return false;
+		}
+	}
+	
+	for (std::vector<unsigned int>::const_iterator ci = action.negative_preconditions_.begin(); ci != action.negative_preconditions_.end(); ++ci)
+	{
+		if (state[*ci])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PlanOptimiser::achievesGoals(const boost::dynamic_bitset<>& state) const
+{
+	for (std::vector<unsigned int>::const_iterator ci = goal_facts_.begin(); ci != goal_facts_.end(); ++ci)
+	{
+		if (!state[*ci])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void PlanOptimiser::apply(const SimulatedAction& action, boost::dynamic_bitset<>& state)
+{
+	for (std::vector<unsigned int>::const_iterator ci = action.delete_effects_.begin(); ci != action.delete_effects_.end(); ++ci)
+	{
+		state.reset(*ci);
+	}
+	for (std::vector<unsigned int>::const_iterator ci = action.add_effects_.begin(); ci != action.add_effects_.end(); ++ci)
+	{
+		state.set(*ci);
+	}
+}
+
+void PlanOptimiser::getSimulatedPlan(std::vector<SimulatedAction>& simulated_plan, const std::vector<const GroundedAction*>& plan)
+{
+	simulated_plan.resize(plan.size());
+	for (unsigned int i = 0; i < plan.size(); ++i)
+	{
+		plan[i]->getPreconditions(simulated_plan[i].preconditions_, simulated_plan[i].negative_preconditions_);
+		plan[i]->getAddEffects(simulated_plan[i].add_effects_);
+		simulated_plan[i].delete_effects_ = plan[i]->getDeleteEffects();
+		simulated_plan[i].violated_equality_ = plan[i]->getViolatedEquality();
+		simulated_plan[i].ill_typed_variable_ = plan[i]->getIllTypedVariable();
+	}
+}
+
+void PlanOptimiser::printAtom(std::ostream& os, unsigned int atom_id)
+{
+	const GroundedAtom* grounded_atom = GroundedAtom::getInstantiatedGroundedAtom(atom_id);
+	if (grounded_atom != NULL)
+	{
+		os << *grounded_atom;
+	}
+	else
+	{
+		os << "#" << atom_id;
+	}
+}
+
+void PlanOptimiser::getInitialState(boost::dynamic_bitset<>& state, unsigned int nr_atoms) const
+{
+	state.resize(nr_atoms);
+	state.reset();
+	for (std::vector<unsigned int>::const_iterator ci = initial_facts_.begin(); ci != initial_facts_.end(); ++ci)
+	{
+		state.set(*ci);
+	}
+}
+
+};
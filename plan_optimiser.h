@@ -0,0 +1,100 @@
+#ifndef MYPOP_PLAN_OPTIMISER_H
+#define MYPOP_PLAN_OPTIMISER_H
+
+#include <vector>
+#include <iosfwd>
+#include <boost/dynamic_bitset.hpp>
+
+namespace MyPOP
+{
+class Atom;
+class Equality;
+class GroundedAction;
+
+/**
+ * Validates plans and removes redundant actions from them. The plan is simulated on bitsets indexed by the ids of the 
+ * grounded atoms, so validating and optimising a plan is cheap enough to do for every plan we find. Two methods are used
+ * to remove actions:
+ * - Loop removal: if the same state is visited twice, all the actions in between are removed.
+ * - Greedy action elimination: an action is removed together with all later actions whose preconditions are no longer
+ *   satisfied, if the goals are still achieved the removal is kept.
+ */
+class PlanOptimiser
+{
+public:
+	PlanOptimiser(const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts);
+
+	/**
+	 * Remove the redundant actions from the given plan, the resulting plan is still valid.
+	 * @return The number of actions removed.
+	 */
+	unsigned int optimise(std::vector<const GroundedAction*>& plan) const;
+
+	/**
+	 * Check that the objects assigned to every action are of the right types, that its preconditions, including its negative
+	 * preconditions and equality constraints, are satisfied when it is executed and that the goals are achieved at the end of
+	 * the plan. The reason a plan is not valid is printed to std::cerr.
+	 */
+	bool isValid(const std::vector<const GroundedAction*>& plan) const;
+
+private:
+
+	/**
+	 * A grounded action in terms of the ids of the grounded atoms.
+	 */
+	struct SimulatedAction
+	{
+		std::vector<unsigned int> preconditions_;
+		std::vector<unsigned int> negative_preconditions_;
+		std::vector<unsigned int> add_effects_;
+		std::vector<unsigned int> delete_effects_;
+		
+		// The equality constraint which does not hold for the objects of the action, or NULL.
+		const Equality* violated_equality_;
+		
+		// The index of the action variable assigned an object of the wrong type, or std::numeric_limits<unsigned int>::max().
+		unsigned int ill_typed_variable_;
+	};
+
+	static void getSimulatedPlan(std::vector<SimulatedAction>& simulated_plan, const std::vector<const GroundedAction*>& plan);
+
+	bool isValid(const std::vector<const GroundedAction*>& plan, const std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const;
+
+	/**
+	 * Print the grounded atom with the given id, or only its id if it has been removed.
+	 */
+	static void printAtom(std::ostream& os, unsigned int atom_id);
+
+	/**
+	 * Remove all the actions between two visits of the same state.
+	 * @return The number of actions removed.
+	 */
+	unsigned int removeLoops(std::vector<const GroundedAction*>& plan, std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const;
+
+	/**
+	 * Remove the actions which are not necessary to achieve the goals.
+	 * @return The number of actions removed.
+	 */
+	unsigned int eliminateActions(std::vector<const GroundedAction*>& plan, std::vector<SimulatedAction>& simulated_plan, unsigned int nr_atoms) const;
+
+	/**
+	 * @return True if all the preconditions of the action are true in the state and none of its negative preconditions are.
+	 */
+	static bool isApplicable(const SimulatedAction& action, const boost::dynamic_bitset<>& state);
+
+	/**
+	 * @return True if all the goals are true in the state.
+	 */
+	bool achievesGoals(const boost::dynamic_bitset<>& state) const;
+
+	static void apply(const SimulatedAction& action, boost::dynamic_bitset<>& state);
+
+	void getInitialState(boost::dynamic_bitset<>& state, unsigned int nr_atoms) const;
+
+	std::vector<unsigned int> initial_facts_;
+	std::vector<unsigned int> goal_facts_;
+};
+
+};
+
+#endif
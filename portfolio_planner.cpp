@@ -0,0 +1,294 @@
+#include "portfolio_planner.h"
+
+#include <iostream>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "action_manager.h"
+#include "term_manager.h"
+#include "fc_planner.h"
+#include "plan_optimiser.h"
+#include "heuristics/heuristic_interface.h"
+
+//#define MYPOP_PORTFOLIO_PLANNER_COMMENTS
+
+namespace MyPOP {
+
+/**
+ * The status shared between all the workers and the parent process.
+ */
+struct PortfolioSharedStatus
+{
+	volatile sig_atomic_t cancel_;
+};
+
+HeuristicFactory::~HeuristicFactory()
+{
+
+}
+
+PortfolioConfiguration::PortfolioConfiguration(PLANNER_CONFIG planner_config, bool prune_unhelpful_actions, bool allow_restarts, unsigned int seed)
+	: planner_config_(planner_config), prune_unhelpful_actions_(prune_unhelpful_actions), allow_restarts_(allow_restarts), seed_(seed)
+{
+
+}
+
+std::ostream& operator<<(std::ostream& os, const PortfolioConfiguration& configuration)
+{
+	switch (configuration.planner_config_)
+	{
+		case LIFTED_FF:
+			os << "Lifted FF";
+			break;
+		case LIFTED_CG:
+			os << "Lifted CG";
+			break;
+		case GROUNDED_FF:
+			os << "Grounded FF";
+			break;
+		case LANDMARK_COUNT:
+			os << "Landmarks";
+			break;
+		case LANDMARK_COUNT_FF:
+			os << "Landmarks + Lifted FF";
+			break;
+	}
+	os << (configuration.prune_unhelpful_actions_ ? "; helpful actions" : "; all actions") << (configuration.allow_restarts_ ? "; restarts" : "; no restarts") << "; seed = " << configuration.seed_;
+	return os;
+}
+
+PortfolioPlanner::PortfolioPlanner(const ActionManager& action_manager, PredicateManager& predicate_manager, const TypeManager& type_manager, HeuristicFactory& heuristic_factory)
+	: action_manager_(&action_manager), predicate_manager_(&predicate_manager), type_manager_(&type_manager), heuristic_factory_(&heuristic_factory)
+{
+
+}
+
+PortfolioPlanner::~PortfolioPlanner()
+{
+
+}
+
+void PortfolioPlanner::addConfiguration(const PortfolioConfiguration& configuration)
+{
+	configurations_.push_back(configuration);
+}
+
+std::pair<int, int> PortfolioPlanner::findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager)
+{
+	PortfolioSharedStatus* status = static_cast<PortfolioSharedStatus*>(mmap(NULL, sizeof(PortfolioSharedStatus), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+	if (status == MAP_FAILED)
+	{
+		std::cerr << "Could not allocate the shared memory for the workers: " << strerror(errno) << std::endl;
+		return std::make_pair(-1, -1);
+	}
+	status->cancel_ = 0;
+
+	std::cout.flush();
+	std::cerr.flush();
+
+	std::vector<pid_t> workers;
+	std::vector<struct pollfd> result_poll_fds;
+	for (std::vector<PortfolioConfiguration>::const_iterator ci = configurations_.begin(); ci != configurations_.end(); ++ci)
+	{
+		const PortfolioConfiguration& configuration = *ci;
+		int fds[2];
+		if (pipe(fds) != 0)
+		{
+			std::cerr << "Could not create the pipe for the worker: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		pid_t pid = fork();
+		if (pid == -1)
+		{
+			std::cerr << "Could not start the worker for " << configuration << ": " << strerror(errno) << std::endl;
+			close(fds[0]);
+			close(fds[1]);
+			break;
+		}
+
+		if (pid == 0)
+		{
+			// The parent stops reading once a plan has been found, we detect this through failed writes.
+			signal(SIGPIPE, SIG_IGN);
+			close(fds[0]);
+			for (std::vector<struct pollfd>::const_iterator ci = result_poll_fds.begin(); ci != result_poll_fds.end(); ++ci)
+			{
+				close((*ci).fd);
+			}
+
+			runWorker(configuration, fds[1], *status, initial_facts, goal_facts, term_manager);
+			close(fds[1]);
+			std::cout.flush();
+			std::cerr.flush();
+			_exit(0);
+		}
+
+		close(fds[1]);
+		workers.push_back(pid);
+
+		struct pollfd poll_fd;
+		poll_fd.fd = fds[0];
+		poll_fd.events = POLLIN;
+		poll_fd.revents = 0;
+		result_poll_fds.push_back(poll_fd);
+	}
+
+	// Wait until a worker sends a plan or all workers have given up.
+	std::vector<unsigned int> plan_message;
+	unsigned int winner = configurations_.size();
+	unsigned int workers_alive = workers.size();
+	while (winner == configurations_.size() && workers_alive > 0)
+	{
+		if (poll(&result_poll_fds[0], result_poll_fds.size(), -1) == -1)
+		{
+			if (errno == EINTR) continue;
+			std::cerr << "Could not wait for the workers: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		for (unsigned int worker_id = 0; worker_id < result_poll_fds.size() && winner == configurations_.size(); ++worker_id)
+		{
+			struct pollfd& poll_fd = result_poll_fds[worker_id];
+			if (poll_fd.fd == -1 || (poll_fd.revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+			{
+				continue;
+			}
+
+			// A worker only writes to its pipe once it found a valid plan, read until the worker closes the pipe.
+			std::vector<char> buffer;
+			char read_buffer[4096];
+			ssize_t bytes_read;
+			while ((bytes_read = read(poll_fd.fd, read_buffer, sizeof(read_buffer))) != 0)
+			{
+				if (bytes_read == -1)
+				{
+					if (errno == EINTR) continue;
+					break;
+				}
+				buffer.insert(buffer.end(), read_buffer, read_buffer + bytes_read);
+			}
+			close(poll_fd.fd);
+			poll_fd.fd = -1;
+			--workers_alive;
+
+			if (buffer.size() >= sizeof(unsigned int))
+			{
+				plan_message.resize(buffer.size() / sizeof(unsigned int));
+				memcpy(&plan_message[0], &buffer[0], plan_message.size() * sizeof(unsigned int));
+				if (plan_message[0] == plan_message.size())
+				{
+					winner = worker_id;
+				}
+			}
+		}
+	}
+
+	// Tell the remaining workers to stop and wait for them to finish.
+	status->cancel_ = 1;
+	for (std::vector<pid_t>::const_iterator ci = workers.begin(); ci != workers.end(); ++ci)
+	{
+		waitpid(*ci, NULL, 0);
+	}
+	for (std::vector<struct pollfd>::const_iterator ci = result_poll_fds.begin(); ci != result_poll_fds.end(); ++ci)
+	{
+		if ((*ci).fd != -1) close((*ci).fd);
+	}
+	munmap(status, sizeof(PortfolioSharedStatus));
+
+	if (winner == configurations_.size())
+	{
+		std::cerr << "No plan found by the portfolio!" << std::endl;
+		return std::make_pair(-1, -1);
+	}
+
+	std::cerr << "Plan found by: " << configurations_[winner] << std::endl;
+
+	// The message contains its size, the number of states visited, the number of actions and every action followed by
+	// the objects assigned to its variables.
+	unsigned int index = 3;
+	for (unsigned int i = 0; i < plan_message[2]; ++i)
+	{
+		const Action& action = action_manager_->getManagableObject(plan_message[index++]);
+		const Object* variables[action.getVariables().size()];
+		for (unsigned int j = 0; j < action.getVariables().size(); ++j)
+		{
+			variables[j] = static_cast<const Object*>(&term_manager.getManagableObject(plan_message[index++]));
+		}
+		plan.push_back(&GroundedAction::getGroundedAction(action, variables));
+	}
+	assert (index == plan_message[0]);
+	return std::make_pair(plan_message[1], plan.size());
+}
+
+void PortfolioPlanner::runWorker(const PortfolioConfiguration& configuration, int result_fd, const PortfolioSharedStatus& status, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager) const
+{
+	std::cerr << "Start worker: " << configuration << std::endl;
+	HEURISTICS::HeuristicInterface* heuristic = heuristic_factory_->createHeuristic(configuration.planner_config_);
+
+	ForwardChainingPlanner fcp(*action_manager_, *predicate_manager_, *type_manager_, *heuristic);
+	fcp.setSeed(configuration.seed_);
+	fcp.setCancelFlag(&status.cancel_);
+
+	std::vector<const GroundedAction*> plan;
+	std::pair<int, int> result = fcp.findPlan(plan, initial_facts, goal_facts, term_manager, configuration.prune_unhelpful_actions_, configuration.allow_restarts_, false);
+
+	// If the greedy method failed, try the non greedy method!
+	if (result.first == -1 && configuration.prune_unhelpful_actions_ && status.cancel_ == 0)
+	{
+		plan.clear();
+		GroundedAtom::removeInstantiatedGroundedAtom();
+		GroundedAction::removeInstantiatedGroundedActions();
+		result = fcp.findPlan(plan, initial_facts, goal_facts, term_manager, false, configuration.allow_restarts_, false);
+	}
+	delete heuristic;
+
+	if (result.first == -1 || status.cancel_ != 0)
+	{
+		return;
+	}
+
+	PlanOptimiser plan_validator(initial_facts, goal_facts);
+	if (!plan_validator.isValid(plan))
+	{
+		std::cerr << "Invalid plan found by: " << configuration << std::endl;
+		return;
+	}
+
+	std::vector<unsigned int> message;
+	message.push_back(0);
+	message.push_back(result.first);
+	message.push_back(plan.size());
+	for (std::vector<const GroundedAction*>::const_iterator ci = plan.begin(); ci != plan.end(); ++ci)
+	{
+		const GroundedAction* grounded_action = *ci;
+		message.push_back(grounded_action->getAction().getId());
+		for (unsigned int i = 0; i < grounded_action->getAction().getVariables().size(); ++i)
+		{
+			message.push_back(grounded_action->getVariablesAssignment(i).getId());
+		}
+	}
+	message[0] = message.size();
+
+	const char* data = reinterpret_cast<const char*>(&message[0]);
+	std::size_t bytes_left = message.size() * sizeof(unsigned int);
+	while (bytes_left > 0)
+	{
+		ssize_t bytes_written = write(result_fd, data, bytes_left);
+		if (bytes_written == -1)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		data += bytes_written;
+		bytes_left -= bytes_written;
+	}
+}
+
+};
@@ -0,0 +1,105 @@
+#ifndef MYPOP_PORTFOLIO_PLANNER
+#define MYPOP_PORTFOLIO_PLANNER
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+namespace MyPOP
+{
+class ActionManager;
+class Atom;
+class GroundedAction;
+class PredicateManager;
+class TermManager;
+class TypeManager;
+
+namespace HEURISTICS
+{
+class HeuristicInterface;
+};
+
+/**
+ * The heuristics the planner can be configured with.
+ */
+enum PLANNER_CONFIG { LIFTED_FF, LIFTED_CG, GROUNDED_FF, LANDMARK_COUNT, LANDMARK_COUNT_FF };
+
+/**
+ * Creates the heuristics used by the planner.
+ */
+class HeuristicFactory
+{
+public:
+	virtual ~HeuristicFactory();
+
+	/**
+	 * Create a new heuristic, the caller is responsible for deleting it.
+	 */
+	virtual HEURISTICS::HeuristicInterface* createHeuristic(PLANNER_CONFIG planner_config) = 0;
+};
+
+/**
+ * A single configuration of the forward chaining planner which is run as part of the portfolio.
+ */
+struct PortfolioConfiguration
+{
+	PortfolioConfiguration(PLANNER_CONFIG planner_config, bool prune_unhelpful_actions, bool allow_restarts, unsigned int seed);
+
+	PLANNER_CONFIG planner_config_;
+	bool prune_unhelpful_actions_;
+	bool allow_restarts_;
+	unsigned int seed_;
+};
+
+std::ostream& operator<<(std::ostream& os, const PortfolioConfiguration& configuration);
+
+struct PortfolioSharedStatus;
+
+/**
+ * Runs several configurations of the forward chaining planner in parallel, the first configuration that finds a valid plan
+ * wins and all other configurations are cancelled.
+ *
+ * The grounded atoms, grounded actions and the data structures of the heuristics are global and not thread safe, so every
+ * configuration is run in a separate process which creates its own heuristic. The plan is validated by the worker that
+ * found it and sent back through a pipe, cancellation is signalled through a flag in shared memory which is polled by the
+ * search.
+ */
+class PortfolioPlanner
+{
+public:
+	PortfolioPlanner(const ActionManager& action_manager, PredicateManager& predicate_manager, const TypeManager& type_manager, HeuristicFactory& heuristic_factory);
+
+	virtual ~PortfolioPlanner();
+
+	/**
+	 * Add a configuration to the portfolio, every configuration is run by a separate worker.
+	 */
+	void addConfiguration(const PortfolioConfiguration& configuration);
+
+	/**
+	 * Find a plan by running all the configurations in parallel, the plans found by the workers are validated before they
+	 * are accepted.
+	 * @return The number of states visited by the winning configuration and the length of the plan, or (-1, -1) if no
+	 * configuration found a valid plan.
+	 */
+	std::pair<int, int> findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager);
+
+private:
+
+	/**
+	 * Run a single configuration, this method is called in the worker's process.
+	 * @param result_fd The pipe through which the plan is sent to the parent process.
+	 */
+	void runWorker(const PortfolioConfiguration& configuration, int result_fd, const PortfolioSharedStatus& status, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager) const;
+
+	const ActionManager* action_manager_;
+	PredicateManager* predicate_manager_;
+	const TypeManager* type_manager_;
+	HeuristicFactory* heuristic_factory_;
+
+	std::vector<PortfolioConfiguration> configurations_;
+};
+
+};
+
+#endif
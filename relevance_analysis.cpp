@@ -0,0 +1,294 @@
+#include "relevance_analysis.h"
+
+#include <limits>
+#include <iostream>
+
+#include "action_manager.h"
+#include "formula.h"
+#include "parser_utils.h"
+#include "predicate_manager.h"
+#include "term_manager.h"
+#include "type_manager.h"
+
+//#define MYPOP_RELEVANCE_ANALYSIS_COMMENTS
+
+namespace MyPOP {
+
+RelevanceAnalysis::RelevanceAnalysis(const ActionManager& action_manager, const TypeManager& type_manager, const TermManager& term_manager, const std::vector<const Atom*>& goal_facts)
+	: type_manager_(&type_manager), is_enabled_(true), relevant_actions_(action_manager.getManagableObjects().size(), false)
+{
+	// Removing an action can make a negative precondition true, so the analysis is not sound.
+	for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ++ci)
+	{
+		std::vector<const Atom*> preconditions;
+		Utility::convertFormula(preconditions, &(*ci)->getPrecondition());
+		for (std::vector<const Atom*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+		{
+			if ((*ci)->isNegative())
+			{
+				is_enabled_ = false;
+			}
+		}
+	}
+
+	if (!is_enabled_)
+	{
+		std::cerr << "Negative preconditions found, all actions and objects are relevant." << std::endl;
+		relevant_actions_.assign(relevant_actions_.size(), true);
+		relevant_objects_.insert(term_manager.getAllObjects().begin(), term_manager.getAllObjects().end());
+		return;
+	}
+
+	std::vector<std::set<const Object*> > no_domains;
+	for (std::vector<const Atom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+	{
+		const Atom* goal = *ci;
+		addRelevantTerms(*goal, NULL, no_domains);
+		for (std::vector<const Term*>::const_iterator ci = goal->getTerms().begin(); ci != goal->getTerms().end(); ++ci)
+		{
+			relevant_objects_.insert(static_cast<const Object*>(*ci));
+		}
+	}
+
+	// The relevant terms only grow, so keep going until nothing changes.
+	bool new_relevant_terms = true;
+	while (new_relevant_terms)
+	{
+		new_relevant_terms = false;
+		for (std::vector<Action*>::const_iterator ci = action_manager.getManagableObjects().begin(); ci != action_manager.getManagableObjects().end(); ++ci)
+		{
+			const Action* action = *ci;
+			std::vector<std::set<const Object*> > relevant_domains(action->getVariables().size());
+			if (!getRelevantDomains(relevant_domains, *action))
+			{
+				continue;
+			}
+
+			relevant_actions_[action->getId()] = true;
+			for (std::vector<std::set<const Object*> >::const_iterator ci = relevant_domains.begin(); ci != relevant_domains.end(); ++ci)
+			{
+				relevant_objects_.insert((*ci).begin(), (*ci).end());
+			}
+
+			std::vector<const Atom*> preconditions;
+			Utility::convertFormula(preconditions, &action->getPrecondition());
+			for (std::vector<const Atom*>::const_iterator ci = preconditions.begin(); ci != preconditions.end(); ++ci)
+			{
+				if (addRelevantTerms(**ci, action, relevant_domains))
+				{
+					new_relevant_terms = true;
+				}
+			}
+		}
+	}
+
+	for (std::vector<const Object*>::const_iterator ci = term_manager.getAllObjects().begin(); ci != term_manager.getAllObjects().end(); ++ci)
+	{
+		if (relevant_objects_.count(*ci) == 0)
+		{
+			irrelevant_objects_.insert(*ci);
+		}
+	}
+
+#ifdef MYPOP_RELEVANCE_ANALYSIS_COMMENTS
+	std::cout << *this << std::endl;
+#endif
+}
+
+bool RelevanceAnalysis::isRelevant(const Action& action) const
+{
+	return relevant_actions_[action.getId()];
+}
+
+bool RelevanceAnalysis::isRelevant(const Object& object) const
+{
+	return relevant_objects_.count(&object) != 0;
+}
+
+bool RelevanceAnalysis::isRelevant(const Atom& fact) const
+{
+	if (!is_enabled_)
+	{
+		return true;
+	}
+
+	std::map<std::string, std::vector<std::set<const Object*> > >::const_iterator ci = relevant_terms_.find(fact.getPredicate().getName());
+	if (ci == relevant_terms_.end())
+	{
+		return false;
+	}
+
+	const std::vector<std::set<const Object*> >& relevant_terms = (*ci).second;
+	for (unsigned int term_index = 0; term_index < fact.getArity(); ++term_index)
+	{
+		if (relevant_terms[term_index].count(static_cast<const Object*>(fact.getTerms()[term_index])) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned int RelevanceAnalysis::pruneFacts(std::vector<const Atom*>& facts) const
+{
+	std::vector<const Atom*> relevant_facts;
+	for (std::vector<const Atom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		if (isRelevant(**ci))
+		{
+			relevant_facts.push_back(*ci);
+		}
+	}
+
+	unsigned int nr_pruned_facts = facts.size() - relevant_facts.size();
+	facts.swap(relevant_facts);
+	return nr_pruned_facts;
+}
+
+bool RelevanceAnalysis::getRelevantDomains(std::vector<std::set<const Object*> >& relevant_domains, const Action& action) const
+{
+	bool achieves_relevant_fact = false;
+	std::vector<std::set<const Object*> > effect_domains(action.getVariables().size());
+	for (std::vector<const Atom*>::const_iterator ci = action.getEffects().begin(); ci != action.getEffects().end(); ++ci)
+	{
+		const Atom* effect = *ci;
+		if (effect->isNegative())
+		{
+			continue;
+		}
+
+		std::map<std::string, std::vector<std::set<const Object*> > >::const_iterator relevant_terms_ci = relevant_terms_.find(effect->getPredicate().getName());
+		if (relevant_terms_ci == relevant_terms_.end())
+		{
+			continue;
+		}
+		const std::vector<std::set<const Object*> >& relevant_terms = (*relevant_terms_ci).second;
+
+		// Start with all the objects of the right type, the variables which are part of the effect are restricted to the objects
+		// which are relevant for those terms.
+		for (unsigned int action_variable_index = 0; action_variable_index < action.getVariables().size(); ++action_variable_index)
+		{
+			std::vector<const Object*> objects_of_type;
+			type_manager_->getObjectsOfType(objects_of_type, *action.getVariables()[action_variable_index]->getType());
+			effect_domains[action_variable_index].clear();
+			effect_domains[action_variable_index].insert(objects_of_type.begin(), objects_of_type.end());
+		}
+
+		bool is_unifiable = true;
+		for (unsigned int term_index = 0; term_index < effect->getArity(); ++term_index)
+		{
+			const Term* term = effect->getTerms()[term_index];
+			unsigned int action_variable_index = action.getActionVariable(*term);
+			if (action_variable_index == std::numeric_limits<unsigned int>::max())
+			{
+				if (relevant_terms[term_index].count(static_cast<const Object*>(term)) == 0)
+				{
+					is_unifiable = false;
+					break;
+				}
+				continue;
+			}
+
+			std::set<const Object*>& effect_domain = effect_domains[action_variable_index];
+			for (std::set<const Object*>::iterator domain_i = effect_domain.begin(); domain_i != effect_domain.end();)
+			{
+				if (relevant_terms[term_index].count(*domain_i) == 0)
+				{
+					effect_domain.erase(domain_i++);
+				}
+				else
+				{
+					++domain_i;
+				}
+			}
+
+			if (effect_domain.empty())
+			{
+				is_unifiable = false;
+				break;
+			}
+		}
+
+		if (!is_unifiable)
+		{
+			continue;
+		}
+
+		achieves_relevant_fact = true;
+		for (unsigned int action_variable_index = 0; action_variable_index < action.getVariables().size(); ++action_variable_index)
+		{
+			relevant_domains[action_variable_index].insert(effect_domains[action_variable_index].begin(), effect_domains[action_variable_index].end());
+		}
+	}
+	return achieves_relevant_fact;
+}
+
+bool RelevanceAnalysis::addRelevantTerms(const Atom& atom, const Action* action, const std::vector<std::set<const Object*> >& domains)
+{
+	std::map<std::string, std::vector<std::set<const Object*> > >::iterator relevant_terms_i = relevant_terms_.find(atom.getPredicate().getName());
+	bool new_relevant_terms = false;
+	if (relevant_terms_i == relevant_terms_.end())
+	{
+		relevant_terms_i = relevant_terms_.insert(std::make_pair(atom.getPredicate().getName(), std::vector<std::set<const Object*> >(atom.getArity()))).first;
+		new_relevant_terms = true;
+	}
+	std::vector<std::set<const Object*> >& relevant_terms = (*relevant_terms_i).second;
+
+	for (unsigned int term_index = 0; term_index < atom.getArity(); ++term_index)
+	{
+		const Term* term = atom.getTerms()[term_index];
+		unsigned int action_variable_index = action == NULL ? std::numeric_limits<unsigned int>::max() : action->getActionVariable(*term);
+
+		// Goals and constants only make a single object relevant.
+		if (action_variable_index == std::numeric_limits<unsigned int>::max())
+		{
+			if (relevant_terms[term_index].insert(static_cast<const Object*>(term)).second)
+			{
+				new_relevant_terms = true;
+			}
+			continue;
+		}
+
+		const std::set<const Object*>& domain = domains[action_variable_index];
+		for (std::set<const Object*>::const_iterator ci = domain.begin(); ci != domain.end(); ++ci)
+		{
+			if (relevant_terms[term_index].insert(*ci).second)
+			{
+				new_relevant_terms = true;
+			}
+		}
+	}
+	return new_relevant_terms;
+}
+
+std::ostream& operator<<(std::ostream& os, const RelevanceAnalysis& relevance_analysis)
+{
+	os << "Relevant facts:" << std::endl;
+	for (std::map<std::string, std::vector<std::set<const Object*> > >::const_iterator ci = relevance_analysis.relevant_terms_.begin(); ci != relevance_analysis.relevant_terms_.end(); ++ci)
+	{
+		os << "(" << (*ci).first;
+		for (std::vector<std::set<const Object*> >::const_iterator terms_ci = (*ci).second.begin(); terms_ci != (*ci).second.end(); ++terms_ci)
+		{
+			os << " {";
+			for (std::set<const Object*>::const_iterator object_ci = (*terms_ci).begin(); object_ci != (*terms_ci).end(); ++object_ci)
+			{
+				if (object_ci != (*terms_ci).begin())
+				{
+					os << ", ";
+				}
+				os << (*object_ci)->getName();
+			}
+			os << "}";
+		}
+		os << ")" << std::endl;
+	}
+
+	os << "Irrelevant objects:";
+	for (std::set<const Object*>::const_iterator ci = relevance_analysis.irrelevant_objects_.begin(); ci != relevance_analysis.irrelevant_objects_.end(); ++ci)
+	{
+		os << " " << (*ci)->getName();
+	}
+	return os;
+}
+
+};
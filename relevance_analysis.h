@@ -0,0 +1,89 @@
+#ifndef MYPOP_RELEVANCE_ANALYSIS_H
+#define MYPOP_RELEVANCE_ANALYSIS_H
+
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <iosfwd>
+
+namespace MyPOP
+{
+class Action;
+class ActionManager;
+class Atom;
+class Object;
+class TermManager;
+class TypeManager;
+
+/**
+ * Backward relevance analysis from the goals. For every predicate and every term of that predicate we store the set of
+ * objects which can be part of a relevant fact, the goals are relevant and so are the preconditions of every action which
+ * can achieve a relevant fact. An action achieves a relevant fact if one of its add effects can be unified with it, in
+ * which case the domains of the action variables of that effect are restricted to the relevant objects of those terms.
+ * This is repeated until no new relevant objects are found.
+ *
+ * Actions which cannot achieve any relevant fact, objects which do not appear in the domain of any relevant action, and
+ * facts which are not relevant can be removed without losing any plans. The analysis is only sound if none of the
+ * preconditions are negative, so if a negative precondition is found everything is considered relevant.
+ */
+class RelevanceAnalysis
+{
+public:
+	RelevanceAnalysis(const ActionManager& action_manager, const TypeManager& type_manager, const TermManager& term_manager, const std::vector<const Atom*>& goal_facts);
+
+	bool isRelevant(const Action& action) const;
+
+	bool isRelevant(const Object& object) const;
+
+	/**
+	 * @return True if the fact (grounded) can be a goal or a precondition of a relevant action.
+	 */
+	bool isRelevant(const Atom& fact) const;
+
+	/**
+	 * Remove all the facts which are not relevant.
+	 * @return The number of facts removed.
+	 */
+	unsigned int pruneFacts(std::vector<const Atom*>& facts) const;
+
+	/**
+	 * @return The objects which can be ignored.
+	 */
+	const std::set<const Object*>& getIrrelevantObjects() const { return irrelevant_objects_; }
+
+private:
+
+	/**
+	 * Find the domains of the action variables for which the action achieves a relevant fact.
+	 * @return True if the action achieves a relevant fact.
+	 */
+	bool getRelevantDomains(std::vector<std::set<const Object*> >& relevant_domains, const Action& action) const;
+
+	/**
+	 * Mark the terms of the atom as relevant, given the domains of the action variables.
+	 * @return True if a new object became relevant.
+	 */
+	bool addRelevantTerms(const Atom& atom, const Action* action, const std::vector<std::set<const Object*> >& domains);
+
+	const TypeManager* type_manager_;
+
+	bool is_enabled_;
+
+	// For every predicate, the objects which are relevant per term.
+	std::map<std::string, std::vector<std::set<const Object*> > > relevant_terms_;
+
+	std::vector<bool> relevant_actions_;
+
+	std::set<const Object*> relevant_objects_;
+
+	std::set<const Object*> irrelevant_objects_;
+
+	friend std::ostream& operator<<(std::ostream& os, const RelevanceAnalysis& relevance_analysis);
+};
+
+std::ostream& operator<<(std::ostream& os, const RelevanceAnalysis& relevance_analysis);
+
+};
+
+#endif
@@ -427,19 +427,18 @@ void MultiValuedTransition::migrateTransition(std::vector<MultiValuedTransition*
 			}
 			
 			
-			HEURISTICS::VariableDomain* vd = new HEURISTICS::VariableDomain();
-			split_action_variable->push_back(vd);
-			
 			// Find all objects equivalent to this:
+			std::vector<const Object*> equivalent_objects;
 			std::pair<std::multimap<const Object*, const Object*>::const_iterator, std::multimap<const Object*, const Object*>::const_iterator> eq_ob_ci = equivalent_relationships.equal_range(current_object);
 			for (std::multimap<const Object*, const Object*>::const_iterator ci = eq_ob_ci.first; ci != eq_ob_ci.second; ++ci)
 			{
 				if (current_variable_domain->contains(*(*ci).second))
 				{
-					vd->addObject(*(*ci).second);
+					equivalent_objects.push_back((*ci).second);
 					processed_objects.insert((*ci).second);
 				}
 			}
+			split_action_variable->push_back(new HEURISTICS::VariableDomain(equivalent_objects));
 		}
 		
 		split_action_variables.push_back(split_action_variable);
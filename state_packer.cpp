@@ -0,0 +1,276 @@
+#include "state_packer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <string>
+#include <assert.h>
+
+#include "VALfiles/TIM.h"
+
+#include "fc_planner.h"
+#include "predicate_manager.h"
+#include "term_manager.h"
+#include "type_manager.h"
+
+//#define MYPOP_STATE_PACKER_COMMENTS
+
+namespace MyPOP {
+
+namespace {
+
+const unsigned int NO_VARIABLE = std::numeric_limits<unsigned int>::max();
+const unsigned int BITS_PER_WORD = sizeof(unsigned int) * 8;
+
+};
+
+StatePacker::StatePacker(const PredicateManager& predicate_manager, const TypeManager& type_manager, const TermManager& term_manager)
+	: property_encodings_(predicate_manager.getManagableObjects().size()), nr_words_(0)
+{
+	unsigned int next_shift = BITS_PER_WORD;
+	for (std::vector<TIM::PropertySpace*>::const_iterator ci = TIM::TA->pbegin(); ci != TIM::TA->pend(); ++ci)
+	{
+		const TIM::PropertySpace* property_space = *ci;
+		if (!property_space->isState() || property_space->isStatic())
+		{
+			continue;
+		}
+
+		// The atoms are only mutually exclusive if no property state contains more than a single property.
+		bool is_mutex = true;
+		std::set<std::pair<std::string, unsigned int> > properties;
+		for (TIM::PropertySpace::SIterator ci = property_space->begin(); ci != property_space->end(); ++ci)
+		{
+			const TIM::PropertyState* property_state = *ci;
+			if (property_state->size() > 1)
+			{
+				is_mutex = false;
+				break;
+			}
+
+			for (TIM::PropertyState::PSIterator ci = property_state->begin(); ci != property_state->end(); ++ci)
+			{
+				const TIM::Property* property = *ci;
+				properties.insert(std::make_pair(property->root()->getName(), property->aPosn()));
+			}
+		}
+
+		if (!is_mutex || properties.empty())
+		{
+			continue;
+		}
+
+		// Every property covers all the atoms of its predicate, given the object at the position of the property.
+		unsigned int property_space_index = object_variables_.size();
+		unsigned long long domain_size = 0;
+		std::vector<PropertyEncoding> property_space_encodings;
+		std::vector<std::string> property_space_predicate_names;
+		for (std::set<std::pair<std::string, unsigned int> >::const_iterator ci = properties.begin(); ci != properties.end(); ++ci)
+		{
+			const Predicate* general_predicate = predicate_manager.getGeneralPredicate((*ci).first);
+			if (general_predicate == NULL)
+			{
+				continue;
+			}
+
+			PropertyEncoding property_encoding;
+			property_encoding.position_ = (*ci).second;
+			property_encoding.property_space_ = property_space_index;
+			property_encoding.value_offset_ = domain_size + 1;
+
+			unsigned long long nr_atoms = 1;
+			for (unsigned int i = 0; i < general_predicate->getArity(); ++i)
+			{
+				std::vector<const Object*>::const_iterator objects_begin, objects_end;
+				type_manager.getObjectsOfType(objects_begin, objects_end, *general_predicate->getTypes()[i]);
+				unsigned int first_object_id = objects_begin == objects_end ? 0 : (*objects_begin)->getId();
+				unsigned int nr_objects = std::distance(objects_begin, objects_end);
+				property_encoding.object_ranges_.push_back(std::make_pair(first_object_id, nr_objects));
+
+				if (i != property_encoding.position_)
+				{
+					nr_atoms *= nr_objects;
+				}
+			}
+
+			// Properties with too many atoms are not worth packing.
+			if (domain_size + nr_atoms >= (1u << (BITS_PER_WORD - 1)))
+			{
+				continue;
+			}
+
+			domain_size += nr_atoms;
+			property_space_encodings.push_back(property_encoding);
+			property_space_predicate_names.push_back(general_predicate->getName());
+		}
+
+		if (property_space_encodings.empty())
+		{
+			continue;
+		}
+
+		// Add the encodings to all the predicates which share the name of the property.
+		for (unsigned int i = 0; i < property_space_encodings.size(); ++i)
+		{
+			const PropertyEncoding& property_encoding = property_space_encodings[i];
+			for (std::vector<Predicate*>::const_iterator ci = predicate_manager.getManagableObjects().begin(); ci != predicate_manager.getManagableObjects().end(); ++ci)
+			{
+				const Predicate* predicate = *ci;
+				if (predicate->getName() == property_space_predicate_names[i] && predicate->getArity() == property_encoding.object_ranges_.size())
+				{
+					property_encodings_[predicate->getId()].push_back(property_encoding);
+				}
+			}
+		}
+
+		// Every object of the property space owns a variable.
+		unsigned int nr_bits = 1;
+		while (nr_bits < BITS_PER_WORD && (1ull << nr_bits) <= domain_size)
+		{
+			++nr_bits;
+		}
+
+		object_variables_.push_back(std::vector<unsigned int>());
+		std::vector<unsigned int>& object_variables = object_variables_.back();
+		for (TIM::PropertySpace::OIterator ci = property_space->obegin(); ci != property_space->oend(); ++ci)
+		{
+			const Object& object = term_manager.getObject((*ci)->getName());
+			if (object_variables.size() <= object.getId())
+			{
+				object_variables.resize(object.getId() + 1, NO_VARIABLE);
+			}
+
+			if (object_variables[object.getId()] != NO_VARIABLE)
+			{
+				continue;
+			}
+
+			if (next_shift + nr_bits > BITS_PER_WORD)
+			{
+				++nr_words_;
+				next_shift = 0;
+			}
+
+			Variable variable;
+			variable.word_ = nr_words_ - 1;
+			variable.shift_ = next_shift;
+			variable.mask_ = (1u << nr_bits) - 1;
+			next_shift += nr_bits;
+
+			object_variables[object.getId()] = variables_.size();
+			variables_.push_back(variable);
+		}
+	}
+
+	std::cerr << "State packer: " << variables_.size() << " variables packed in " << nr_words_ << " words." << std::endl;
+}
+
+bool StatePacker::getVariableValue(unsigned int& variable, unsigned int& value, const GroundedAtom& atom) const
+{
+	if (atom.getPredicate().getId() >= property_encodings_.size())
+	{
+		return false;
+	}
+
+	const std::vector<PropertyEncoding>& property_encodings = property_encodings_[atom.getPredicate().getId()];
+	for (std::vector<PropertyEncoding>::const_iterator ci = property_encodings.begin(); ci != property_encodings.end(); ++ci)
+	{
+		const PropertyEncoding& property_encoding = *ci;
+		if (property_encoding.object_ranges_.size() != atom.getPredicate().getArity())
+		{
+			continue;
+		}
+
+		const std::vector<unsigned int>& object_variables = object_variables_[property_encoding.property_space_];
+		unsigned int owner_id = atom.getObject(property_encoding.position_).getId();
+		if (owner_id >= object_variables.size() || object_variables[owner_id] == NO_VARIABLE)
+		{
+			continue;
+		}
+
+		// The index of the atom follows from the ids of the other objects.
+		unsigned int index = 0;
+		bool in_range = true;
+		for (unsigned int i = 0; i < property_encoding.object_ranges_.size(); ++i)
+		{
+			if (i == property_encoding.position_)
+			{
+				continue;
+			}
+
+			const std::pair<unsigned int, unsigned int>& object_range = property_encoding.object_ranges_[i];
+			unsigned int object_id = atom.getObject(i).getId();
+			if (object_id < object_range.first || object_id >= object_range.first + object_range.second)
+			{
+				in_range = false;
+				break;
+			}
+			index = index * object_range.second + object_id - object_range.first;
+		}
+
+		if (!in_range)
+		{
+			continue;
+		}
+
+		variable = object_variables[owner_id];
+		value = property_encoding.value_offset_ + index;
+		return true;
+	}
+	return false;
+}
+
+void StatePacker::pack(PackedState& packed_state, const std::vector<const GroundedAtom*>& facts) const
+{
+	packed_state.assign(nr_words_, 0);
+	std::vector<unsigned int> unpacked_atoms;
+
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		const GroundedAtom* fact = *ci;
+		if (fact->getPredicate().isStatic())
+		{
+			continue;
+		}
+
+		unsigned int variable_index, value;
+		if (!getVariableValue(variable_index, value, *fact))
+		{
+			unpacked_atoms.push_back(fact->getId());
+			continue;
+		}
+
+		const Variable& variable = variables_[variable_index];
+		unsigned int& word = packed_state[variable.word_];
+		unsigned int current_value = (word >> variable.shift_) & variable.mask_;
+		if (current_value == 0)
+		{
+			word |= value << variable.shift_;
+			continue;
+		}
+
+		// The invariant does not hold, the smallest value is kept in the variable.
+		if (current_value < value)
+		{
+			unpacked_atoms.push_back(fact->getId());
+			continue;
+		}
+
+		for (std::vector<const GroundedAtom*>::const_iterator ci2 = facts.begin(); ci2 != ci; ++ci2)
+		{
+			unsigned int other_variable_index, other_value;
+			if (!(*ci2)->getPredicate().isStatic() && getVariableValue(other_variable_index, other_value, **ci2) && other_variable_index == variable_index && other_value == current_value)
+			{
+				unpacked_atoms.push_back((*ci2)->getId());
+				break;
+			}
+		}
+		word = (word & ~(variable.mask_ << variable.shift_)) | (value << variable.shift_);
+	}
+
+	std::sort(unpacked_atoms.begin(), unpacked_atoms.end());
+	packed_state.insert(packed_state.end(), unpacked_atoms.begin(), unpacked_atoms.end());
+}
+
+};
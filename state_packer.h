@@ -0,0 +1,100 @@
+#ifndef MYPOP_STATE_PACKER_H
+#define MYPOP_STATE_PACKER_H
+
+#include <vector>
+
+namespace MyPOP
+{
+class GroundedAtom;
+class PredicateManager;
+class TermManager;
+class TypeManager;
+
+/**
+ * A state packed by the StatePacker, two states are equal iff their packed states are equal.
+ */
+typedef std::vector<unsigned int> PackedState;
+
+/**
+ * Packs the facts of a state into finite domain variables which are derived from the TIM property spaces.
+ *
+ * In a property space where every property state contains at most a single property, every object of that property space
+ * makes at most one of the atoms true in which it appears at the position of one of these properties. For every such
+ * object we create a variable whose values are these atoms (or none of them) and the values of all variables are packed
+ * into as few bits as possible. The value of an atom is calculated from the ids of its objects, which are consecutive for
+ * objects of the same type.
+ *
+ * Atoms of static predicates are the same in every state and are left out. Atoms which are not covered by any variable,
+ * or which would assign a second value to a variable, are stored by their id after the packed variables. Ties are broken
+ * by the value, so the packed state does not depend on the order of the facts.
+ */
+class StatePacker
+{
+public:
+	/**
+	 * Derive the variables from the property spaces found by TIM, the objects and types must have been processed.
+	 */
+	StatePacker(const PredicateManager& predicate_manager, const TypeManager& type_manager, const TermManager& term_manager);
+
+	/**
+	 * Pack the given facts, which must all be true in the same state.
+	 */
+	void pack(PackedState& packed_state, const std::vector<const GroundedAtom*>& facts) const;
+
+	unsigned int getNumberOfVariables() const { return variables_.size(); }
+
+	/**
+	 * @return The number of words every packed state uses for the variables.
+	 */
+	unsigned int getNumberOfWords() const { return nr_words_; }
+
+private:
+
+	/**
+	 * The atoms of a predicate which are covered by a property of a property space.
+	 */
+	struct PropertyEncoding
+	{
+		// The position of the object which owns the variable.
+		unsigned int position_;
+
+		// The index of the property space.
+		unsigned int property_space_;
+
+		// The value of the first atom of this property.
+		unsigned int value_offset_;
+
+		// For every position the id of the first object and the number of objects of the type of that position.
+		std::vector<std::pair<unsigned int, unsigned int> > object_ranges_;
+	};
+
+	/**
+	 * The location of a variable in the packed state.
+	 */
+	struct Variable
+	{
+		unsigned int word_;
+		unsigned int shift_;
+		unsigned int mask_;
+	};
+
+	/**
+	 * Get the variable and the value which represent the given atom.
+	 * @return False if the atom is not covered by any variable.
+	 */
+	bool getVariableValue(unsigned int& variable, unsigned int& value, const GroundedAtom& atom) const;
+
+	// The encodings of the atoms, indexed by the id of their predicate.
+	std::vector<std::vector<PropertyEncoding> > property_encodings_;
+
+	// For every property space, the variables indexed by the id of the object which owns them.
+	std::vector<std::vector<unsigned int> > object_variables_;
+
+	std::vector<Variable> variables_;
+
+	unsigned int nr_words_;
+};
+
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "transposition_table.h"
+
+#include <algorithm>
+#include <iostream>
+#include <assert.h>
+#include <boost/functional/hash.hpp>
+
+#include "fc_planner.h"
+
+//#define MYPOP_TRANSPOSITION_TABLE_COMMENTS
+
+namespace MyPOP {
+
+namespace {
+
+// The memory used by an entry and its index on top of the ids of its facts.
+const std::size_t ENTRY_OVERHEAD = 64;
+
+};
+
+TranspositionTable::TranspositionTable(std::size_t memory_budget)
+	: memory_budget_(memory_budget), memory_used_(0), clock_hand_(0), nr_hits_(0), nr_misses_(0)
+{
+
+}
+
+void TranspositionTable::getKey(std::vector<unsigned int>& key, const std::vector<const GroundedAtom*>& facts, bool allow_new_goals_to_be_added)
+{
+	key.clear();
+	key.reserve(facts.size() + 1);
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		key.push_back((*ci)->getId());
+	}
+	std::sort(key.begin(), key.end());
+	
+	// The ids are sorted, so the last element always holds the configuration.
+	key.push_back(allow_new_goals_to_be_added ? 1 : 0);
+}
+
+void TranspositionTable::setGoals(const std::vector<const GroundedAtom*>& goal_facts)
+{
+	std::vector<unsigned int> goals;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+	{
+		goals.push_back((*ci)->getId());
+	}
+	std::sort(goals.begin(), goals.end());
+	goals.erase(std::unique(goals.begin(), goals.end()), goals.end());
+	
+	if (goals != goals_)
+	{
+#ifdef MYPOP_TRANSPOSITION_TABLE_COMMENTS
+		std::cout << "The goals changed, clear the transposition table." << std::endl;
+#endif
+		clear();
+		goals_.swap(goals);
+	}
+}
+
+std::size_t TranspositionTable::getEntrySize(const std::vector<unsigned int>& key)
+{
+	return key.size() * sizeof(unsigned int) + ENTRY_OVERHEAD;
+}
+
+unsigned int TranspositionTable::findEntry(const std::vector<unsigned int>& key, std::size_t hash) const
+{
+	std::pair<boost::unordered_multimap<std::size_t, unsigned int>::const_iterator, boost::unordered_multimap<std::size_t, unsigned int>::const_iterator> range = entry_indexes_.equal_range(hash);
+	for (boost::unordered_multimap<std::size_t, unsigned int>::const_iterator ci = range.first; ci != range.second; ++ci)
+	{
+		if (entries_[(*ci).second].key_ == key)
+		{
+			return (*ci).second;
+		}
+	}
+	return entries_.size();
+}
+
+bool TranspositionTable::getHeuristic(unsigned int& heuristic, const std::vector<unsigned int>& key)
+{
+	unsigned int entry_index = findEntry(key, boost::hash_range(key.begin(), key.end()));
+	if (entry_index == entries_.size())
+	{
+		++nr_misses_;
+		return false;
+	}
+
+	Entry& entry = entries_[entry_index];
+	entry.referenced_ = true;
+	heuristic = entry.heuristic_;
+	++nr_hits_;
+	return true;
+}
+
+void TranspositionTable::setHeuristic(const std::vector<unsigned int>& key, unsigned int heuristic)
+{
+	std::size_t hash = boost::hash_range(key.begin(), key.end());
+	unsigned int entry_index = findEntry(key, hash);
+	if (entry_index != entries_.size())
+	{
+		entries_[entry_index].heuristic_ = heuristic;
+		return;
+	}
+
+	Entry new_entry;
+	new_entry.key_ = key;
+	new_entry.hash_ = hash;
+	new_entry.heuristic_ = heuristic;
+	new_entry.referenced_ = false;
+
+	if (entries_.empty() || memory_used_ + getEntrySize(key) <= memory_budget_)
+	{
+		entry_indexes_.insert(std::make_pair(hash, entries_.size()));
+		entries_.push_back(new_entry);
+		memory_used_ += getEntrySize(key);
+		return;
+	}
+
+	// Give every entry which has been used since the last time the clock hand passed it a second chance.
+	while (entries_[clock_hand_].referenced_)
+	{
+		entries_[clock_hand_].referenced_ = false;
+		clock_hand_ = (clock_hand_ + 1) % entries_.size();
+	}
+
+	Entry& evicted_entry = entries_[clock_hand_];
+#ifdef MYPOP_TRANSPOSITION_TABLE_COMMENTS
+	std::cout << "Evict " << evicted_entry.hash_ << " for " << hash << std::endl;
+#endif
+
+	std::pair<boost::unordered_multimap<std::size_t, unsigned int>::iterator, boost::unordered_multimap<std::size_t, unsigned int>::iterator> range = entry_indexes_.equal_range(evicted_entry.hash_);
+	for (boost::unordered_multimap<std::size_t, unsigned int>::iterator i = range.first; i != range.second; ++i)
+	{
+		if ((*i).second == clock_hand_)
+		{
+			entry_indexes_.erase(i);
+			break;
+		}
+	}
+
+	// Entries are replaced in place, so the memory used can exceed the budget by the difference in size between two keys.
+	memory_used_ = memory_used_ - getEntrySize(evicted_entry.key_) + getEntrySize(key);
+	evicted_entry = new_entry;
+	entry_indexes_.insert(std::make_pair(hash, clock_hand_));
+	clock_hand_ = (clock_hand_ + 1) % entries_.size();
+}
+
+void TranspositionTable::clear()
+{
+	entries_.clear();
+	entry_indexes_.clear();
+	memory_used_ = 0;
+	clock_hand_ = 0;
+}
+
+};
@@ -0,0 +1,98 @@
+#ifndef MYPOP_TRANSPOSITION_TABLE_H
+#define MYPOP_TRANSPOSITION_TABLE_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/unordered_map.hpp>
+
+namespace MyPOP
+{
+class GroundedAtom;
+
+/**
+ * Stores the heuristic values of the states evaluated so far, so states which are reached again after a restart or during a
+ * later search do not have to be evaluated again. States are identified by the sorted ids of their facts, which do not
+ * change when the grounded atoms are removed. The entries are indexed by the hash of these ids, but the ids themselves are
+ * stored and compared so a hash collision never returns the value of another state. A dead end is stored with the maximum
+ * heuristic value.
+ *
+ * The memory used by the entries is bounded by the memory budget, once the table is full entries are evicted using the clock
+ * algorithm: every entry has a bit which is set when it is used and the clock hand evicts the first entry whose bit is not
+ * set, clearing the bits it passes.
+ */
+class TranspositionTable
+{
+public:
+	/**
+	 * @param memory_budget The number of bytes the entries may use.
+	 */
+	TranspositionTable(std::size_t memory_budget);
+
+	/**
+	 * @param key The key of the state, independent of the order of the facts.
+	 * @param facts The facts which are true in a state.
+	 * @param allow_new_goals_to_be_added The heuristic value depends on whether new goals can be added, so it is part of the
+	 * key.
+	 */
+	static void getKey(std::vector<unsigned int>& key, const std::vector<const GroundedAtom*>& facts, bool allow_new_goals_to_be_added);
+
+	/**
+	 * Set the goals the heuristic values are calculated for, the table is cleared if they differ from the goals set before.
+	 */
+	void setGoals(const std::vector<const GroundedAtom*>& goal_facts);
+
+	/**
+	 * Look up the heuristic value of a state.
+	 * @return True if the state was found, in which case heuristic is set to its value.
+	 */
+	bool getHeuristic(unsigned int& heuristic, const std::vector<unsigned int>& key);
+
+	/**
+	 * Store the heuristic value of a state, if the table is full another entry is evicted.
+	 */
+	void setHeuristic(const std::vector<unsigned int>& key, unsigned int heuristic);
+
+	/**
+	 * Remove all entries.
+	 */
+	void clear();
+
+	unsigned int getNumberOfHits() const { return nr_hits_; }
+
+	unsigned int getNumberOfMisses() const { return nr_misses_; }
+
+private:
+
+	struct Entry
+	{
+		std::vector<unsigned int> key_;
+		std::size_t hash_;
+		unsigned int heuristic_;
+		bool referenced_;
+	};
+
+	/**
+	 * @return The index of the entry with the given key, or the number of entries if there is no such entry.
+	 */
+	unsigned int findEntry(const std::vector<unsigned int>& key, std::size_t hash) const;
+
+	/**
+	 * @return The memory used by an entry with the given key.
+	 */
+	static std::size_t getEntrySize(const std::vector<unsigned int>& key);
+
+	// The sorted ids of the goals the stored heuristic values were calculated for.
+	std::vector<unsigned int> goals_;
+
+	std::vector<Entry> entries_;
+	boost::unordered_multimap<std::size_t, unsigned int> entry_indexes_;
+	std::size_t memory_budget_;
+	std::size_t memory_used_;
+	unsigned int clock_hand_;
+
+	unsigned int nr_hits_, nr_misses_;
+};
+
+};
+
+#endif
@@ -1,5 +1,6 @@
 
 #include <map>
+#include <algorithm>
 #include <assert.h>
 
 #include "VALfiles/ptree.h"
@@ -15,55 +16,50 @@ namespace MyPOP {
  * The Type class
  *************************/
 Type::Type(const string& name, const Type* supertype)
-	: name_(name), supertype_(supertype), is_subtype_of_(NULL)
+	: name_(name), supertype_(supertype), pre_order_(0), last_subtype_pre_order_(0)
 {
 
 }
 
 Type::~Type()
 {
-	delete is_subtype_of_;
+
 }
 
-void Type::processSupertypes(int total_types)
+unsigned int Type::processSubtypes(unsigned int pre_order)
 {
-	// Create a bitset with a number of bits equal to the number of types.
-	is_subtype_of_ = new boost::dynamic_bitset<>(total_types);
-
-	// For every type ID this type is a subtype of, make the bit of the location equal to the
-	// type ID true.
-	const Type* parent = supertype_;
-	while(parent != NULL) {
-		is_subtype_of_->set(parent->id_, true);
-		parent = parent->supertype_;
+	pre_order_ = pre_order++;
+
+	// The subtypes are owned by the type manager, which only gives us const pointers.
+	for (std::vector<const Type*>::const_iterator ci = subtypes_.begin(); ci != subtypes_.end(); ci++)
+	{
+		pre_order = const_cast<Type*>(*ci)->processSubtypes(pre_order);
 	}
 
-	// Don't forget to add ourselves! :)
-	is_subtype_of_->set(id_, true);
+	last_subtype_pre_order_ = pre_order - 1;
+	return pre_order;
 }
 
 bool Type::isCompatible(const Type& type) const
 {
-	return isSubtypeOf(type) || isEqual(type);
+	return type.pre_order_ <= pre_order_ && pre_order_ <= type.last_subtype_pre_order_;
 }
 
 bool Type::isEqual(const Type& type) const
 {
-	return (*is_subtype_of_ == *type.is_subtype_of_);
+	return pre_order_ == type.pre_order_;
 }
 
 bool Type::isSubtypeOf(const Type& type) const
 {
-	// This type is a subtype if it shares all the subtypes of the given type.
-	return (*is_subtype_of_ & *type.is_subtype_of_) == *type.is_subtype_of_ &&
-	       !isEqual(type);
+	// This type is a subtype if it lies strictly within the interval of the given type.
+	return type.pre_order_ < pre_order_ && pre_order_ <= type.last_subtype_pre_order_;
 }
 
 bool Type::isSupertypeOf(const Type& type) const
 {
-	// This type is a supertype if the given type shares all the subtype of this type.
-	return (*is_subtype_of_ & *type.is_subtype_of_) == *is_subtype_of_ &&
-	       !isEqual(type);
+	// This type is a supertype if the given type lies strictly within the interval of this type.
+	return pre_order_ < type.pre_order_ && type.pre_order_ <= last_subtype_pre_order_;
 }
 
 void Type::addSubtype(const Type& subtype)
@@ -92,7 +88,7 @@ std::ostream& operator<<(std::ostream& os, const Type& type) {
 		os << (*ci)->name_ << ", ";
 	}	
 	
-	os << " {" << *type.is_subtype_of_ << "}";
+	os << " {" << type.pre_order_ << ", " << type.last_subtype_pre_order_ << "}";
 	return os;
 }
 
@@ -116,10 +112,6 @@ TypeManager::~TypeManager()
 	//{
 	//	delete (*ci).second;
 	//}
-	for (std::map<const Type*, std::vector<const Object*>*>::const_iterator ci = objects_per_type_.begin(); ci != objects_per_type_.end(); ci++)
-	{
-		delete (*ci).second;
-	}
 }
 
 void TypeManager::processTypes(const VAL::pddl_type_list& types)
@@ -131,14 +123,16 @@ void TypeManager::processTypes(const VAL::pddl_type_list& types)
 		processType(*type);
 	}
 
-	// For each type, determine its supertypes and store them for future use.
+	// Number the type hierarchy in pre-order, starting from every type without a supertype.
+	unsigned int pre_order = 0;
 	for (unsigned int i = 0; i < highest_id_; i++)
 	{
-		// For every type set the same bitset length to store the supertype information.
-		// This could be done in the constructor if we knew the number of types from the
-		// start (see above), but this will do for now.
-		objects_[i]->processSupertypes(highest_id_);
+		if (objects_[i]->getSupertype() == NULL)
+		{
+			pre_order = objects_[i]->processSubtypes(pre_order);
+		}
 	}
+	assert (pre_order == highest_id_);
 
 	// Show the results.
 #ifdef MYPOP_TYPE_COMMENTS
@@ -317,70 +311,95 @@ Type* TypeManager::processType(const VAL::pddl_type& type)
 	return new_type;
 }
 
-void TypeManager::processObjects(TermManager& term_manager, const VAL::const_symbol_list& objects)
+namespace {
+
+/**
+ * Order the objects by the pre-order of their types.
+ */
+struct ObjectTypeOrdering
 {
-	for (VAL::const_symbol_list::const_iterator ci = objects.begin(); ci != objects.end(); ci++)
+	ObjectTypeOrdering(const TypeManager& type_manager)
+		: type_manager_(&type_manager)
+	{
+
+	}
+
+	bool operator()(const VAL::const_symbol* lhs, const VAL::const_symbol* rhs) const
+	{
+		return type_manager_->getType(lhs->type->getName())->getPreOrder() < type_manager_->getType(rhs->type->getName())->getPreOrder();
+	}
+
+	const TypeManager* type_manager_;
+};
+
+};
+
+void TypeManager::processObjects(TermManager& term_manager, const VAL::const_symbol_list& objects, const VAL::const_symbol_list* constants)
+{
+	std::vector<const VAL::const_symbol*> pddl_objects(objects.begin(), objects.end());
+	if (constants != NULL)
+	{
+		pddl_objects.insert(pddl_objects.end(), constants->begin(), constants->end());
+	}
+
+	// Objects which share a type are numbered consecutively, this keeps the objects of every type
+	// and its subtypes in a single range of ids.
+	std::stable_sort(pddl_objects.begin(), pddl_objects.end(), ObjectTypeOrdering(*this));
+
+	std::vector<unsigned int> first_object_of_pre_order(highest_id_ + 1, pddl_objects.size());
+	for (std::vector<const VAL::const_symbol*>::const_iterator ci = pddl_objects.begin(); ci != pddl_objects.end(); ci++)
 	{
 		const VAL::const_symbol* pddl_object = *ci;
 		const Type* object_type = getType(pddl_object->type->getName());
 		Object* object = new Object(*object_type, pddl_object->getName());
 
-		// Process the objects type and store it.
-		while (object_type != NULL)
+		if (first_object_of_pre_order[object_type->getPreOrder()] == pddl_objects.size())
 		{
-			mapObjectToType(*object, *object_type);
-			object_type = object_type->getSupertype();
+			first_object_of_pre_order[object_type->getPreOrder()] = typed_objects_.size();
 		}
+		typed_objects_.push_back(object);
 
 		// Add the object as a term.
 		term_manager.addTerm(*pddl_object, *object);
+		assert (object->getId() == typed_objects_[0]->getId() + typed_objects_.size() - 1);
 
 #ifdef MYPOP_TYPE_COMMENTS
 		std::cout << *object << std::endl;
 #endif
 	}
-}
 
-void TypeManager::getObjectsOfType(std::vector<const Object*>& objects_of_type, const Type& type) const
-{
-	std::map<const Type*, std::vector<const Object*>*>::const_iterator ci = objects_per_type_.find(&type);
-	if (ci != objects_per_type_.end())
+	// Types without objects start where the next type starts.
+	for (unsigned int i = highest_id_; i > 0; i--)
 	{
-		std::vector<const Object*>* oot = (*ci).second;
-		objects_of_type.insert(objects_of_type.begin(), (*oot).begin(), (*oot).end());
-	}
-}
-
-void TypeManager::mapObjectToType(const Object& object, const Type& type)
-{
-	std::map<const Type*, std::vector<const Object*>*>::const_iterator ci = objects_per_type_.find(&type);
-	std::vector<const Object*>* objects = NULL;
-	if (ci == objects_per_type_.end())
-	{
-		objects = new std::vector<const Object*>();
-		objects_per_type_[&type] = objects;
-	}
-	else
-	{
-		objects = (*ci).second;
-	}
-
-	// Map the object to the other objects of the same type, if it isn't already there.
-	bool already_stored = false;
-	for (std::vector<const Object*>::const_iterator ci = objects->begin(); ci != objects->end(); ci++)
-	{
-		if (&object == *ci)
+		if (first_object_of_pre_order[i - 1] > first_object_of_pre_order[i])
 		{
-			already_stored = true;
-			break;
+			first_object_of_pre_order[i - 1] = first_object_of_pre_order[i];
 		}
 	}
-	if (!already_stored)
+
+	objects_per_type_.resize(highest_id_);
+	for (unsigned int i = 0; i < highest_id_; i++)
 	{
-		objects->push_back(&object);
+		const Type* type = objects_[i];
+		objects_per_type_[i] = std::make_pair(first_object_of_pre_order[type->getPreOrder()], first_object_of_pre_order[type->getLastSubtypePreOrder() + 1]);
 	}
 }
 
+void TypeManager::getObjectsOfType(std::vector<const Object*>& objects_of_type, const Type& type) const
+{
+	std::vector<const Object*>::const_iterator begin, end;
+	getObjectsOfType(begin, end, type);
+	objects_of_type.insert(objects_of_type.begin(), begin, end);
+}
+
+void TypeManager::getObjectsOfType(std::vector<const Object*>::const_iterator& begin, std::vector<const Object*>::const_iterator& end, const Type& type) const
+{
+	assert (type.getId() < objects_per_type_.size());
+	const std::pair<unsigned int, unsigned int>& range = objects_per_type_[type.getId()];
+	begin = typed_objects_.begin() + range.first;
+	end = typed_objects_.begin() + range.second;
+}
+
 const Type* TypeManager::getType(const std::string& type_name) const
 {
 	std::map<std::string, Type*>::const_iterator type = types_mapping_.find(type_name);
@@ -2,7 +2,6 @@
 #define MYPOP_TYPE_MANAGER
 
 #include <vector>
-#include <boost/dynamic_bitset.hpp>
 #include "VALfiles/ptree.h"
 #include "manager.h"
 
@@ -13,8 +12,9 @@ class TermManager;
 
 /**
  * PDDL Type.
- * Internally every type is assigned a bit in a bit array equal in length to the number
- * of the total number of types. Checks for super- / subtypes are done by bitcomparison,
+ * Internally the type hierarchy is numbered in pre-order, so all the subtypes of a type are
+ * numbered consecutively after the type itself. Every type stores its own number and the
+ * highest number of its subtypes, so checks for super- / subtypes are two integer comparisons,
  * check the relevant methods for a detailed explanation.
  */
 class Type : public ManageableObject {//<Type> {
@@ -26,9 +26,16 @@ public:
 	// Destructor.
 	~Type();
 
-	// Determine the supertypes of this type and store them in a bitset
-	// of length total_types.
-	void processSupertypes(int total_types);
+	// Number this type and all its subtypes in pre-order, starting with the given number. Returns
+	// the first number which has not been assigned.
+	unsigned int processSubtypes(unsigned int pre_order);
+
+	// The number of this type in the pre-order traversal of the type hierarchy.
+	unsigned int getPreOrder() const { return pre_order_; }
+
+	// The highest number of all the subtypes of this type in the pre-order traversal of the type
+	// hierarchy.
+	unsigned int getLastSubtypePreOrder() const { return last_subtype_pre_order_; }
 
 	// Check if the given type is equal to this type.
 	bool isEqual(const Type& type) const;
@@ -65,10 +72,11 @@ private:
 	// All the subtypes of this type.
 	std::vector<const Type*> subtypes_;
 
-	// A bitset which determines which types this type is a subtype of
-	// (including itself). The bitset is aligned with the type ids. I.e.
-	// if bit N is true then this type is a subtype of type with type ID N.
-	boost::dynamic_bitset<>* is_subtype_of_;
+	// The interval [pre_order_, last_subtype_pre_order_] contains the numbers of this type and
+	// all its subtypes. I.e. type T is a subtype of this type iff T's pre_order_ lies in this
+	// interval.
+	unsigned int pre_order_;
+	unsigned int last_subtype_pre_order_;
 
 	// Print the type in a human readable form.
 	friend std::ostream& operator<<(std::ostream& os, const Type& type);
@@ -90,12 +98,18 @@ public:
 	// to store them into our own structure.
 	void processTypes(const VAL::pddl_type_list& types);
 
-	// Process all the objects from the problem file by storing them internally.
-	void processObjects(TermManager& term_manager, const VAL::const_symbol_list& objects);
+	// Process all the objects from the problem file and the constants from the domain file (if
+	// any) by storing them internally. The objects are ordered by the pre-order of their types
+	// before they are added to the term manager, so the objects of a type and all its subtypes
+	// are assigned consecutive ids.
+	void processObjects(TermManager& term_manager, const VAL::const_symbol_list& objects, const VAL::const_symbol_list* constants);
 
 	// Return all objects of a certain type.
 	void getObjectsOfType(std::vector<const Object*>& objects_of_type, const Type& type) const;
 
+	// Return the objects of a certain type as a range [begin, end) of objects with consecutive ids.
+	void getObjectsOfType(std::vector<const Object*>::const_iterator& begin, std::vector<const Object*>::const_iterator& end, const Type& type) const;
+
 	// Get the type object with the given name.
 	const Type* getType(const std::string& type_name) const;
 
@@ -107,10 +121,6 @@ protected:
 	// types also the direct subtypes are processed and stored with every type.
 	Type* processType(const VAL::pddl_type& type);
 
-	// Map the given object to the given type and all supertypes. This allows the planner to get quick
-	// access of all objects related to a certain type.
-	void mapObjectToType(const Object& object, const Type& type);
-
 private:
 	
 	bool containsSuperTypes(const VAL::pddl_type& type, VAL::pddl_type_list& other_types, bool* closed_list) const;
@@ -121,9 +131,12 @@ private:
 
 	std::map<std::string, Type*> types_mapping_;
 
-	// Keep track of all the objects which are mapped to a similar type for
-	// easy access.
-	std::map<const Type*, std::vector<const Object*>*> objects_per_type_;
+	// All the objects, ordered by their ids.
+	std::vector<const Object*> typed_objects_;
+
+	// For every type (indexed by its id), the range [first, second) in typed_objects_ which
+	// contains all the objects of that type and its subtypes.
+	std::vector<std::pair<unsigned int, unsigned int> > objects_per_type_;
 };
 
 };
@@ -0,0 +1,372 @@
+#include "width_planner.h"
+
+#include <deque>
+#include <queue>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <assert.h>
+
+#include "action_manager.h"
+#include "predicate_manager.h"
+#include "type_manager.h"
+#include "term_manager.h"
+#include "heuristics/heuristic_interface.h"
+
+//#define MYPOP_WIDTH_PLANNER_COMMENTS
+
+namespace MyPOP {
+
+NoveltyTable::NoveltyTable(unsigned int width)
+	: width_(width)
+{
+	assert (width_ == 1 || width_ == 2);
+}
+
+unsigned int NoveltyTable::updateNovelty(const std::vector<const GroundedAtom*>& facts)
+{
+	// Static facts are part of every state, so they can never make a state novel.
+	std::vector<unsigned int> atom_ids;
+	for (std::vector<const GroundedAtom*>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		if ((*ci)->getPredicate().isStatic()) continue;
+		atom_ids.push_back((*ci)->getId());
+	}
+	std::sort(atom_ids.begin(), atom_ids.end());
+
+	std::size_t nr_atom_ids = GroundedAtom::numberOfGroundedAtomIds();
+	if (seen_atoms_.size() < nr_atom_ids)
+	{
+		seen_atoms_.resize(nr_atom_ids);
+		if (width_ > 1)
+		{
+			seen_atom_pairs_.resize((nr_atom_ids * (nr_atom_ids - 1)) / 2);
+		}
+	}
+
+	unsigned int novelty = width_ + 1;
+	for (std::vector<unsigned int>::const_iterator ci = atom_ids.begin(); ci != atom_ids.end(); ++ci)
+	{
+		if (!seen_atoms_[*ci])
+		{
+			seen_atoms_[*ci] = true;
+			novelty = 1;
+		}
+	}
+
+	if (width_ == 1)
+	{
+		return novelty;
+	}
+
+	// The pair (i, j) with i < j is stored at index j * (j - 1) / 2 + i.
+	for (unsigned int j = 1; j < atom_ids.size(); ++j)
+	{
+		std::size_t offset = ((std::size_t)atom_ids[j] * (atom_ids[j] - 1)) / 2;
+		for (unsigned int i = 0; i < j; ++i)
+		{
+			if (!seen_atom_pairs_[offset + atom_ids[i]])
+			{
+				seen_atom_pairs_[offset + atom_ids[i]] = true;
+				novelty = std::min(novelty, 2u);
+			}
+		}
+	}
+	return novelty;
+}
+
+/**
+ * Order the states by their novelty first and break ties using the heuristic.
+ */
+class CompareNoveltyStates {
+public:
+	bool operator()(const std::pair<unsigned int, State*>& lhs, const std::pair<unsigned int, State*>& rhs) const
+	{
+		if (lhs.first != rhs.first)
+		{
+			return lhs.first > rhs.first;
+		}
+		return lhs.second->getHeuristic() > rhs.second->getHeuristic();
+	}
+};
+
+WidthBasedPlanner::WidthBasedPlanner(const ActionManager& action_manager, const TypeManager& type_manager, HEURISTICS::HeuristicInterface& heuristic)
+	: action_manager_(&action_manager), type_manager_(&type_manager), heuristic_(&heuristic), state_packer_(NULL)
+{
+
+}
+
+WidthBasedPlanner::~WidthBasedPlanner()
+{
+
+}
+
+std::pair<int, int> WidthBasedPlanner::findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, WIDTH_SEARCH_MODE search_mode)
+{
+	std::vector<const GroundedAtom*> grounded_initial_facts;
+	GroundedAtom::getGroundedAtoms(grounded_initial_facts, initial_facts);
+
+	std::vector<const GroundedAtom*> grounded_goal_facts;
+	GroundedAtom::getGroundedAtoms(grounded_goal_facts, goal_facts);
+
+	// States are linked to their parents, so we keep all states alive until the search is over.
+	std::vector<State*> all_states;
+	State* initial_state = new State(true);
+	all_states.push_back(initial_state);
+
+	unsigned int states_visited = 0;
+	State* goal_state = NULL;
+	std::vector<const GroundedAtom*> no_required_goals;
+
+	switch (search_mode)
+	{
+		case IW_1:
+			goal_state = iteratedWidthSearch(*initial_state, 1, grounded_initial_facts, grounded_goal_facts, no_required_goals, grounded_goal_facts.size(), all_states, states_visited);
+			break;
+		case IW_2:
+			goal_state = iteratedWidthSearch(*initial_state, 2, grounded_initial_facts, grounded_goal_facts, no_required_goals, grounded_goal_facts.size(), all_states, states_visited);
+			break;
+		case SERIALISED_IW:
+		{
+			// Achieve the goals one at a time, every IW search must find a state which achieves one more goal than the
+			// current state without undoing the goals which have already been achieved.
+			State* current_state = initial_state;
+			while (current_state != NULL)
+			{
+				std::vector<const GroundedAtom*> state_facts;
+				current_state->getFacts(grounded_initial_facts, state_facts);
+
+				std::vector<const GroundedAtom*> achieved_goals;
+				getAchievedGoals(achieved_goals, state_facts, grounded_goal_facts);
+				if (achieved_goals.size() == grounded_goal_facts.size())
+				{
+					goal_state = current_state;
+					break;
+				}
+
+				std::cerr << "\t" << achieved_goals.size() << "/" << grounded_goal_facts.size() << " goals achieved; states = " << states_visited << std::endl;
+
+				State* next_state = NULL;
+				for (unsigned int width = 1; width <= 2 && next_state == NULL; ++width)
+				{
+					next_state = iteratedWidthSearch(*current_state, width, grounded_initial_facts, grounded_goal_facts, achieved_goals, achieved_goals.size() + 1, all_states, states_visited);
+				}
+				current_state = next_state;
+			}
+			break;
+		}
+		case BEST_FIRST_WIDTH_SEARCH:
+			goal_state = bestFirstWidthSearch(*initial_state, grounded_initial_facts, grounded_goal_facts, term_manager, all_states, states_visited);
+			break;
+	}
+
+	std::pair<int, int> result(-1, -1);
+	if (goal_state != NULL)
+	{
+		const State* parent = goal_state;
+		while (parent != NULL && parent->getAchievingAction() != NULL)
+		{
+			plan.insert(plan.begin(), parent->getAchievingAction());
+			parent = parent->getParent();
+		}
+		result = std::make_pair(states_visited, plan.size());
+	}
+	else
+	{
+		std::cerr << "Width based search failed!" << std::endl;
+	}
+
+	for (std::vector<State*>::const_iterator ci = all_states.begin(); ci != all_states.end(); ++ci)
+	{
+		delete *ci;
+	}
+	return result;
+}
+
+State* WidthBasedPlanner::iteratedWidthSearch(State& root, unsigned int width, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const std::vector<const GroundedAtom*>& required_goals, unsigned int min_goals_achieved, std::vector<State*>& all_states, unsigned int& states_visited) const
+{
+	NoveltyTable novelty_table(width);
+	std::multimap<const Object*, const Object*> no_symmetrical_groups;
+	std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > > no_helpful_actions;
+
+	std::vector<const GroundedAtom*> root_facts;
+	root.getFacts(initial_facts, root_facts);
+	novelty_table.updateNovelty(root_facts);
+	
+	std::vector<const GroundedAtom*> root_achieved_goals;
+	getAchievedGoals(root_achieved_goals, root_facts, goal_facts);
+	if (root_achieved_goals.size() >= min_goals_achieved)
+	{
+		return &root;
+	}
+
+	std::deque<State*> open_list;
+	open_list.push_back(&root);
+
+	while (!open_list.empty())
+	{
+		State* state = open_list.front();
+		open_list.pop_front();
+		++states_visited;
+
+		if (states_visited % 1000 == 0) std::cerr << "M" << "q=" << open_list.size() << ";g=" << GroundedAction::numberOfGroundedActions();
+		else if (states_visited % 100 == 0) std::cerr << ".";
+
+		std::vector<State*> successor_states;
+		StateStoreListener listener(successor_states);
+		state->getSuccessors(listener, no_symmetrical_groups, *action_manager_, *type_manager_, false, initial_facts, no_helpful_actions);
+
+		for (std::vector<State*>::const_iterator ci = successor_states.begin(); ci != successor_states.end(); ++ci)
+		{
+			State* successor_state = *ci;
+			all_states.push_back(successor_state);
+
+			std::vector<const GroundedAtom*> successor_facts;
+			successor_state->getFacts(initial_facts, successor_facts);
+
+			if (novelty_table.updateNovelty(successor_facts) > width)
+			{
+				continue;
+			}
+
+			std::vector<const GroundedAtom*> achieved_goals;
+			getAchievedGoals(achieved_goals, successor_facts, goal_facts);
+
+			bool satisfies_goal = achieved_goals.size() >= min_goals_achieved;
+			for (std::vector<const GroundedAtom*>::const_iterator ci = required_goals.begin(); ci != required_goals.end() && satisfies_goal; ++ci)
+			{
+				satisfies_goal = std::binary_search(successor_facts.begin(), successor_facts.end(), *ci);
+			}
+
+			if (satisfies_goal)
+			{
+#ifdef MYPOP_WIDTH_PLANNER_COMMENTS
+				std::cout << "IW(" << width << ") found a state which achieves " << achieved_goals.size() << " goals." << std::endl;
+#endif
+				return successor_state;
+			}
+			open_list.push_back(successor_state);
+		}
+	}
+	return NULL;
+}
+
+State* WidthBasedPlanner::bestFirstWidthSearch(State& root, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, std::vector<State*>& all_states, unsigned int& states_visited) const
+{
+	// All the grounded atoms that should never be removed.
+	std::vector<const GroundedAtom*> grounded_atoms_not_to_be_removed(initial_facts);
+	grounded_atoms_not_to_be_removed.insert(grounded_atoms_not_to_be_removed.end(), goal_facts.begin(), goal_facts.end());
+
+	std::multimap<const Object*, const Object*> no_symmetrical_groups;
+	std::vector<std::pair<const REACHABILITY::AchievingTransition*, const std::vector<HEURISTICS::VariableDomain*>* > > no_helpful_actions;
+
+	// The novelty of a state is measured against the states with the same heuristic value.
+	std::map<unsigned int, NoveltyTable*> novelty_tables;
+	// The packed states, or the sorted ids of the facts if no state packer has been set.
+	boost::unordered_set<PackedState> closed_list;
+
+	heuristic_->setHeuristicForState(root, initial_facts, goal_facts, term_manager, false, false);
+	GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+
+	std::priority_queue<std::pair<unsigned int, State*>, std::vector<std::pair<unsigned int, State*> >, CompareNoveltyStates> open_list;
+	open_list.push(std::make_pair(1, &root));
+
+	unsigned int best_heuristic_estimate = std::numeric_limits<unsigned int>::max();
+	State* goal_state = NULL;
+	while (!open_list.empty() && goal_state == NULL)
+	{
+		State* state = open_list.top().second;
+		open_list.pop();
+
+		std::vector<const GroundedAtom*> state_facts;
+		state->getFacts(initial_facts, state_facts);
+
+		PackedState packed_state;
+		if (state_packer_ != NULL)
+		{
+			state_packer_->pack(packed_state, state_facts);
+		}
+		else
+		{
+			for (std::vector<const GroundedAtom*>::const_iterator ci = state_facts.begin(); ci != state_facts.end(); ++ci)
+			{
+				packed_state.push_back((*ci)->getId());
+			}
+			std::sort(packed_state.begin(), packed_state.end());
+		}
+
+		if (!closed_list.insert(packed_state).second)
+		{
+			continue;
+		}
+		++states_visited;
+
+		if (state->getHeuristic() < best_heuristic_estimate)
+		{
+			best_heuristic_estimate = state->getHeuristic();
+			std::cerr << "\t" << best_heuristic_estimate << " state = " << states_visited << "; Grounded Actions = " << GroundedAction::numberOfGroundedActions() << "; Grounded atoms: " << GroundedAtom::numberOfGroundedAtoms() << std::endl;
+		}
+		else if (states_visited % 1000 == 0) std::cerr << "M" << "q=" << open_list.size() << ";g=" << GroundedAction::numberOfGroundedActions();
+		else if (states_visited % 100 == 0) std::cerr << ".";
+
+		std::vector<const GroundedAtom*> achieved_goals;
+		getAchievedGoals(achieved_goals, state_facts, goal_facts);
+		if (achieved_goals.size() == goal_facts.size())
+		{
+			goal_state = state;
+			break;
+		}
+
+		std::vector<State*> successor_states;
+		StateStoreListener listener(successor_states);
+		state->getSuccessors(listener, no_symmetrical_groups, *action_manager_, *type_manager_, false, initial_facts, no_helpful_actions);
+
+		for (std::vector<State*>::const_iterator ci = successor_states.begin(); ci != successor_states.end(); ++ci)
+		{
+			State* successor_state = *ci;
+			all_states.push_back(successor_state);
+
+			heuristic_->setHeuristicForState(*successor_state, initial_facts, goal_facts, term_manager, false, false);
+			GroundedAtom::removeInstantiatedGroundedAtom(grounded_atoms_not_to_be_removed);
+			if (successor_state->getHeuristic() == std::numeric_limits<unsigned int>::max())
+			{
+				continue;
+			}
+
+			NoveltyTable* novelty_table = NULL;
+			std::map<unsigned int, NoveltyTable*>::const_iterator table_ci = novelty_tables.find(successor_state->getHeuristic());
+			if (table_ci == novelty_tables.end())
+			{
+				novelty_table = new NoveltyTable(2);
+				novelty_tables[successor_state->getHeuristic()] = novelty_table;
+			}
+			else
+			{
+				novelty_table = (*table_ci).second;
+			}
+
+			std::vector<const GroundedAtom*> successor_facts;
+			successor_state->getFacts(initial_facts, successor_facts);
+			open_list.push(std::make_pair(novelty_table->updateNovelty(successor_facts), successor_state));
+		}
+	}
+
+	for (std::map<unsigned int, NoveltyTable*>::const_iterator ci = novelty_tables.begin(); ci != novelty_tables.end(); ++ci)
+	{
+		delete (*ci).second;
+	}
+	return goal_state;
+}
+
+void WidthBasedPlanner::getAchievedGoals(std::vector<const GroundedAtom*>& achieved_goals, const std::vector<const GroundedAtom*>& facts, const std::vector<const GroundedAtom*>& goal_facts) const
+{
+	for (std::vector<const GroundedAtom*>::const_iterator ci = goal_facts.begin(); ci != goal_facts.end(); ++ci)
+	{
+		if (std::binary_search(facts.begin(), facts.end(), *ci))
+		{
+			achieved_goals.push_back(*ci);
+		}
+	}
+}
+
+};
@@ -0,0 +1,104 @@
+#ifndef MYPOP_WIDTH_PLANNER
+#define MYPOP_WIDTH_PLANNER
+
+#include <vector>
+#include <map>
+#include <boost/dynamic_bitset.hpp>
+
+#include "fc_planner.h"
+
+namespace MyPOP
+{
+class ActionManager;
+class Atom;
+class GroundedAction;
+class GroundedAtom;
+class State;
+class TermManager;
+class TypeManager;
+
+namespace HEURISTICS
+{
+class HeuristicInterface;
+};
+
+/**
+ * The different width based searches we support.
+ */
+enum WIDTH_SEARCH_MODE { IW_1, IW_2, SERIALISED_IW, BEST_FIRST_WIDTH_SEARCH };
+
+/**
+ * Keeps track of the grounded atoms (and pairs of grounded atoms) which have been seen so far. The tables are indexed by
+ * the ids of the grounded atoms.
+ */
+class NoveltyTable
+{
+public:
+	/**
+	 * @param width The largest tuples of atoms we keep track of, either 1 or 2.
+	 */
+	NoveltyTable(unsigned int width);
+
+	/**
+	 * Calculate the novelty of the given facts and mark all atoms (and pairs of atoms) as seen.
+	 * @return The size of the smallest tuple of atoms that has not been seen before, or width + 1 if all tuples have been seen.
+	 */
+	unsigned int updateNovelty(const std::vector<const GroundedAtom*>& facts);
+
+private:
+	unsigned int width_;
+	boost::dynamic_bitset<> seen_atoms_;
+	boost::dynamic_bitset<> seen_atom_pairs_;
+};
+
+/**
+ * Planner which performs a width based search, states are pruned (or ordered) by the novelty of the atoms they contain.
+ */
+class WidthBasedPlanner
+{
+public:
+	WidthBasedPlanner(const ActionManager& action_manager, const TypeManager& type_manager, HEURISTICS::HeuristicInterface& heuristic);
+
+	virtual ~WidthBasedPlanner();
+
+	/**
+	 * Find a plan using the given search mode.
+	 * @return The number of states visited and the length of the plan, or (-1, -1) if no plan could be found.
+	 */
+	std::pair<int, int> findPlan(std::vector<const GroundedAction*>& plan, const std::vector<const Atom*>& initial_facts, const std::vector<const Atom*>& goal_facts, const TermManager& term_manager, WIDTH_SEARCH_MODE search_mode);
+
+	/**
+	 * Set the state packer used to detect duplicate states, if no state packer is set the ids of the facts are compared.
+	 */
+	void setStatePacker(const StatePacker* state_packer) { state_packer_ = state_packer; }
+
+private:
+
+	/**
+	 * Breadth first search from the given state which prunes every state that has a novelty larger than the given width.
+	 * @param required_goals The goals which must be true in the state we search for.
+	 * @param min_goals_achieved The minimal number of goals which must be true in the state we search for.
+	 * @return A state which satisfies the goal conditions or NULL if no such state was found.
+	 */
+	State* iteratedWidthSearch(State& root, unsigned int width, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const std::vector<const GroundedAtom*>& required_goals, unsigned int min_goals_achieved, std::vector<State*>& all_states, unsigned int& states_visited) const;
+
+	/**
+	 * Best first search which orders the states by their novelty first and by their heuristic value second. The novelty of a
+	 * state is measured against the states with the same heuristic value.
+	 */
+	State* bestFirstWidthSearch(State& root, const std::vector<const GroundedAtom*>& initial_facts, const std::vector<const GroundedAtom*>& goal_facts, const TermManager& term_manager, std::vector<State*>& all_states, unsigned int& states_visited) const;
+
+	/**
+	 * Get the goals which are satisfied by the given facts, the facts must be sorted.
+	 */
+	void getAchievedGoals(std::vector<const GroundedAtom*>& achieved_goals, const std::vector<const GroundedAtom*>& facts, const std::vector<const GroundedAtom*>& goal_facts) const;
+
+	const ActionManager* action_manager_;
+	const TypeManager* type_manager_;
+	HEURISTICS::HeuristicInterface* heuristic_;
+	const StatePacker* state_packer_;
+};
+
+};
+
+#endif